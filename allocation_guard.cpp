@@ -0,0 +1,113 @@
+#include "allocation_guard.h"
+
+#ifdef ALLOC_CHECK
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocations(0);
+std::atomic<bool> armed(false);
+thread_local bool guarded = false;
+
+void* allocate(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (guarded && armed.load(std::memory_order_relaxed)) {
+        // iostream may allocate itself; stdio to an unbuffered stream won't.
+        guarded = false;
+        fprintf(stderr, "Allocation of %lu bytes after warmup on a guarded thread\n",
+                static_cast<unsigned long>(size));
+        abort();
+    }
+    return malloc(size ? size : 1);
+}
+
+} // namespace
+
+void armAllocationGuard() {
+    guarded = true;
+    armed.store(true, std::memory_order_relaxed);
+}
+
+void disarmAllocationGuard() {
+    armed.store(false, std::memory_order_relaxed);
+}
+
+void guardThreadAllocations() {
+    guarded = true;
+}
+
+bool allocationGuardAvailable() {
+    return true;
+}
+
+uint64_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    void* p = allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+#else
+
+void armAllocationGuard() {
+}
+
+void disarmAllocationGuard() {
+}
+
+void guardThreadAllocations() {
+}
+
+bool allocationGuardAvailable() {
+    return false;
+}
+
+uint64_t allocationCount() {
+    return 0;
+}
+
+#endif // ALLOC_CHECK
@@ -0,0 +1,31 @@
+#ifndef ALLOCATION_GUARD_H
+#define ALLOCATION_GUARD_H
+
+#include <stdint.h>
+
+// Test mode for the zero-allocation render loop. Builds configured with
+// ALLOC_CHECK replace the global operator new and delete with versions that
+// count allocations and, while the guard is armed, print the offending size
+// and abort on a guarded thread: the render thread that armed it, and the
+// job system workers that run its per-frame jobs. Arm the guard once the
+// loop has warmed up; any heap use after that is a latency hazard on the
+// real-time target. Other builds keep the standard allocator, and arming
+// does nothing.
+//
+// Only C++ allocations are seen. malloc() called directly, e.g. inside the
+// GL driver, is outside what the guard can check.
+void armAllocationGuard();
+void disarmAllocationGuard();
+
+// Puts the calling thread under the guard whenever it is armed. Job system
+// workers call this when they start.
+void guardThreadAllocations();
+
+// Whether the replacement operator new is compiled in.
+bool allocationGuardAvailable();
+
+// Allocations made through operator new by all threads so far; always 0
+// without ALLOC_CHECK.
+uint64_t allocationCount();
+
+#endif // ALLOCATION_GUARD_H
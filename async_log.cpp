@@ -0,0 +1,236 @@
+#include "async_log.h"
+#include "platform_thread.h"
+#include "platform_timer.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Ring size in messages; a power of two.
+const size_t kRingSize = 512;
+
+// How long the drain thread sleeps when the ring is empty.
+const uint64_t kDrainIntervalNs = 2000000ull;
+
+struct Slot {
+    // Equal to the position a producer may claim, or position + 1 once
+    // the message at that position is ready to be read.
+    std::atomic<size_t> sequence;
+    LogLevel level;
+    size_t length;
+    char text[LogLine::kMaxLength + 1];
+};
+
+// Bounded multi-producer, single-consumer ring after Dmitry Vyukov's
+// bounded MPMC queue: producers claim a position with one CAS, so a full
+// ring is detected without waiting for the consumer.
+struct LogRing {
+    LogRing() : enqueuePos(0), dequeuePos(0) {
+        for (size_t i = 0; i < kRingSize; ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    Slot slots[kRingSize];
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos;  // drain thread only
+};
+
+LogRing ring;
+std::atomic<bool> running(false);
+std::atomic<bool> stopping(false);
+std::atomic<uint64_t> dropped(0);
+FILE* logFile = nullptr;
+PlatformThread drainThread;
+
+bool push(LogLevel level, const char* text, size_t length) {
+    size_t pos = ring.enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &ring.slots[pos & (kRingSize - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (ring.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;  // full
+        } else {
+            pos = ring.enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->level = level;
+    slot->length = length;
+    memcpy(slot->text, text, length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void writeMessage(LogLevel level, const char* text, size_t length) {
+    FILE* out = logFile ? logFile : (level == LogError ? stderr : stdout);
+    fwrite(text, 1, length, out);
+    fputc('\n', out);
+}
+
+// Writes out every message that is ready. Returns how many there were.
+size_t drain() {
+    size_t count = 0;
+    while (true) {
+        Slot& slot = ring.slots[ring.dequeuePos & (kRingSize - 1)];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != ring.dequeuePos + 1)
+            break;
+        writeMessage(slot.level, slot.text, slot.length);
+        slot.sequence.store(ring.dequeuePos + kRingSize, std::memory_order_release);
+        ++ring.dequeuePos;
+        ++count;
+    }
+    if (count) {
+        fflush(logFile ? logFile : stdout);
+        if (!logFile)
+            fflush(stderr);
+    }
+    return count;
+}
+
+void drainMain(void*) {
+    uint64_t reported = 0;
+    while (true) {
+        bool stop = stopping.load(std::memory_order_acquire);
+        size_t count = drain();
+        uint64_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost != reported) {
+            char text[64];
+            int length = snprintf(text, sizeof(text), "Log ring full: %llu messages dropped",
+                                  static_cast<unsigned long long>(lost - reported));
+            writeMessage(LogError, text, static_cast<size_t>(length));
+            fflush(logFile ? logFile : stderr);
+            reported = lost;
+        }
+        if (stop)
+            return;
+        if (!count)
+            sleepForNs(kDrainIntervalNs);
+    }
+}
+
+// Stops the drain thread on exit paths that skip stopAsyncLog(). Declared
+// after drainThread so that it is destroyed first.
+struct StopAtExit {
+    ~StopAtExit() { stopAsyncLog(); }
+} stopAtExit;
+
+} // namespace
+
+LogLine::LogLine(LogLevel level)
+    : level_(level), length_(0) {
+    text_[0] = '\0';
+}
+
+LogLine::~LogLine() {
+    if (!running.load(std::memory_order_acquire)) {
+        writeMessage(level_, text_, length_);
+        return;
+    }
+    if (!push(level_, text_, length_))
+        dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LogLine::format(const char* fmt, ...) {
+    if (length_ >= kMaxLength)
+        return;
+    va_list args;
+    va_start(args, fmt);
+    int written = vsnprintf(text_ + length_, kMaxLength + 1 - length_, fmt, args);
+    va_end(args);
+    if (written > 0)
+        length_ += static_cast<size_t>(written);
+    if (length_ > kMaxLength)
+        length_ = kMaxLength;
+}
+
+LogLine& LogLine::operator<<(const char* text) {
+    format("%s", text ? text : "(null)");
+    return *this;
+}
+
+LogLine& LogLine::operator<<(char c) {
+    format("%c", c);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(int value) {
+    format("%d", value);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(unsigned value) {
+    format("%u", value);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(long value) {
+    format("%ld", value);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(unsigned long value) {
+    format("%lu", value);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(long long value) {
+    format("%lld", value);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(unsigned long long value) {
+    format("%llu", value);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(double value) {
+    // Same as the default iostream formatting.
+    format("%g", value);
+    return *this;
+}
+
+bool startAsyncLog(const char* path) {
+    if (running.load())
+        return true;
+    if (path) {
+        logFile = fopen(path, "a");
+        if (!logFile) {
+            fprintf(stderr, "Failed to open log file %s\n", path);
+            return false;
+        }
+    }
+    stopping.store(false);
+    running.store(true, std::memory_order_release);
+    if (!drainThread.start("tLogDrain", drainMain, nullptr, -1, PlatformThread::LowPriority)) {
+        running.store(false);
+        fprintf(stderr, "Failed to start the log thread\n");
+        return false;
+    }
+    return true;
+}
+
+void stopAsyncLog() {
+    if (!running.load())
+        return;
+    running.store(false, std::memory_order_release);
+    stopping.store(true, std::memory_order_release);
+    drainThread.join();
+    // Catch messages that were being queued while the thread exited.
+    drain();
+    if (logFile) {
+        fclose(logFile);
+        logFile = nullptr;
+    }
+}
+
+uint64_t droppedLogMessages() {
+    return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,60 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum LogLevel {
+    LogInfo,   // stdout
+    LogError   // stderr
+};
+
+// One log message, formatted into a fixed buffer on the stack and queued
+// when the statement ends:
+//
+//     LogLine(LogInfo) << "Batching: " << draws << " draws";
+//
+// Queuing never blocks or allocates. Messages go into a bounded lock-free
+// ring drained by a low-priority thread; when the ring is full the message
+// is dropped and counted. Before startAsyncLog() and after stopAsyncLog()
+// messages are written directly instead. Text past kMaxLength is cut off.
+class LogLine {
+public:
+    static const size_t kMaxLength = 240;
+
+    explicit LogLine(LogLevel level);
+    ~LogLine();
+
+    LogLine& operator<<(const char* text);
+    LogLine& operator<<(char c);
+    LogLine& operator<<(int value);
+    LogLine& operator<<(unsigned value);
+    LogLine& operator<<(long value);
+    LogLine& operator<<(unsigned long value);
+    LogLine& operator<<(long long value);
+    LogLine& operator<<(unsigned long long value);
+    LogLine& operator<<(double value);
+
+private:
+    LogLine(const LogLine&);
+    LogLine& operator=(const LogLine&);
+
+    void format(const char* fmt, ...);
+
+    LogLevel level_;
+    size_t length_;
+    char text_[kMaxLength + 1];
+};
+
+// Starts the drain thread. Messages go to path, or to stdout and stderr
+// (the console on VxWorks) when path is null. Returns false if the file
+// cannot be opened or the thread cannot be started.
+bool startAsyncLog(const char* path);
+
+// Writes out everything queued so far and stops the drain thread.
+void stopAsyncLog();
+
+// Messages dropped because the ring was full, since startup.
+uint64_t droppedLogMessages();
+
+#endif // ASYNC_LOG_H
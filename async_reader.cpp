@@ -0,0 +1,228 @@
+#include "async_reader.h"
+#include "object_pool.h"
+
+#include <condition_variable>
+#include <errno.h>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace {
+
+#ifdef HAVE_LIBURING
+// Submissions and completions go through the shared rings; the kernel
+// performs the reads without any threads of ours.
+class IoUringReader : public AsyncReader {
+public:
+    IoUringReader() : initialized_(false), inFlight_(0), unsubmitted_(0) {}
+
+    // io_uring_queue_exit() does not wait for reads the kernel is still
+    // doing, and their buffers belong to the caller, so collect every
+    // outstanding completion first. Reads the kernel never took will not
+    // complete and are dropped with the ring.
+    ~IoUringReader() {
+        if (!initialized_)
+            return;
+        flushSubmissions();
+        struct io_uring_cqe* cqe;
+        while (inFlight_ > unsubmitted_ && io_uring_wait_cqe(&ring_, &cqe) == 0) {
+            io_uring_cqe_seen(&ring_, cqe);
+            --inFlight_;
+        }
+        io_uring_queue_exit(&ring_);
+    }
+
+    bool init(int queueDepth) {
+        initialized_ = io_uring_queue_init(queueDepth, &ring_, 0) == 0;
+        return initialized_;
+    }
+
+    const char* name() const { return "io_uring"; }
+
+    bool submit(int fd, uint64_t offset, void* buffer, size_t size, uint64_t tag) {
+        struct io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+        if (!sqe)
+            return false;
+        io_uring_prep_read(sqe, fd, buffer, static_cast<unsigned>(size), offset);
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(tag)));
+        // A prepared SQE goes to the kernel with the next successful
+        // io_uring_submit() whatever happens now, so from here on the read
+        // is the caller's, in flight. A failed submit is retried by poll().
+        ++inFlight_;
+        ++unsubmitted_;
+        flushSubmissions();
+        return true;
+    }
+
+    int poll(ReadCompletion* completions, int maxCompletions) {
+        flushSubmissions();
+        int count = 0;
+        struct io_uring_cqe* cqe;
+        while (count < maxCompletions && io_uring_peek_cqe(&ring_, &cqe) == 0) {
+            completions[count].tag = reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+            completions[count].result = cqe->res;
+            io_uring_cqe_seen(&ring_, cqe);
+            --inFlight_;
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    void flushSubmissions() {
+        if (unsubmitted_ == 0)
+            return;
+        int submitted = io_uring_submit(&ring_);
+        if (submitted > 0)
+            unsubmitted_ -= submitted < unsubmitted_ ? submitted : unsubmitted_;
+    }
+
+    struct io_uring ring_;
+    bool initialized_;
+    int inFlight_;     // prepared reads whose completion has not been seen
+    int unsubmitted_;  // prepared reads that io_uring_submit() has not taken yet
+};
+#endif
+
+// Portable fallback: worker threads doing blocking pread() calls. Requests
+// live in a pool sized to the queue depth and move between two intrusive
+// lists, so reads in steady state do not allocate.
+class ThreadPoolReader : public AsyncReader {
+public:
+    ThreadPoolReader(int threads, int queueDepth)
+        : pool_(queueDepth > 0 ? queueDepth : 1), stopping_(false) {
+        for (int i = 0; i < threads; ++i)
+            workers_.push_back(std::thread(&ThreadPoolReader::run, this));
+    }
+
+    ~ThreadPoolReader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (size_t i = 0; i < workers_.size(); ++i)
+            workers_[i].join();
+    }
+
+    const char* name() const { return "thread pool"; }
+
+    bool submit(int fd, uint64_t offset, void* buffer, size_t size, uint64_t tag) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Request* request = pool_.acquire();
+            if (!request)
+                return false;
+            request->fd = fd;
+            request->offset = offset;
+            request->buffer = buffer;
+            request->size = size;
+            request->tag = tag;
+            requests_.push(request);
+        }
+        wake_.notify_one();
+        return true;
+    }
+
+    int poll(ReadCompletion* completions, int maxCompletions) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int count = 0;
+        while (count < maxCompletions && !completed_.empty()) {
+            Request* request = completed_.pop();
+            completions[count].tag = request->tag;
+            completions[count].result = request->result;
+            ++count;
+            pool_.release(request);
+        }
+        return count;
+    }
+
+private:
+    struct Request {
+        int fd;
+        uint64_t offset;
+        void* buffer;
+        size_t size;
+        uint64_t tag;
+        long result;
+        Request* next;
+    };
+
+    // FIFO threaded through Request::next.
+    class RequestList {
+    public:
+        RequestList() : head_(nullptr), tail_(nullptr) {}
+
+        bool empty() const { return head_ == nullptr; }
+
+        void push(Request* request) {
+            request->next = nullptr;
+            if (tail_)
+                tail_->next = request;
+            else
+                head_ = request;
+            tail_ = request;
+        }
+
+        Request* pop() {
+            Request* request = head_;
+            head_ = request->next;
+            if (!head_)
+                tail_ = nullptr;
+            return request;
+        }
+
+    private:
+        Request* head_;
+        Request* tail_;
+    };
+
+    void run() {
+        while (true) {
+            Request* request;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this]() { return stopping_ || !requests_.empty(); });
+                if (stopping_)
+                    return;
+                request = requests_.pop();
+            }
+            ssize_t result;
+            do {
+                result = pread(request->fd, request->buffer, request->size, static_cast<off_t>(request->offset));
+            } while (result < 0 && errno == EINTR);
+
+            request->result = result < 0 ? -errno : static_cast<long>(result);
+            std::lock_guard<std::mutex> lock(mutex_);
+            completed_.push(request);
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    ObjectPool<Request> pool_;
+    RequestList requests_;
+    RequestList completed_;
+    std::vector<std::thread> workers_;
+    bool stopping_;
+};
+
+} // namespace
+
+AsyncReader* createAsyncReader(int queueDepth) {
+#ifdef HAVE_LIBURING
+    IoUringReader* uring = new IoUringReader();
+    if (uring->init(queueDepth))
+        return uring;
+    delete uring;
+    std::cerr << "io_uring unavailable, reading with a thread pool" << std::endl;
+#endif
+    int threads = queueDepth < 4 ? queueDepth : 4;
+    return new ThreadPoolReader(threads > 0 ? threads : 1, queueDepth);
+}
@@ -0,0 +1,33 @@
+#ifndef ASYNC_READER_H
+#define ASYNC_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Completion of an asynchronous read.
+struct ReadCompletion {
+    uint64_t tag;
+    long result;  // bytes read, or -errno
+};
+
+// Reads file ranges into caller-owned memory without blocking the caller.
+// submit() queues a read; poll() returns finished reads. Short reads are
+// reported as such; the caller decides whether to resubmit the rest.
+// Destruction waits for reads in flight, so their buffers can be freed
+// right after.
+class AsyncReader {
+public:
+    virtual ~AsyncReader() {}
+
+    virtual const char* name() const = 0;
+    virtual bool submit(int fd, uint64_t offset, void* buffer, size_t size, uint64_t tag) = 0;
+
+    // Fills up to maxCompletions entries and returns how many were filled.
+    virtual int poll(ReadCompletion* completions, int maxCompletions) = 0;
+};
+
+// Uses io_uring when the build found liburing and the kernel allows it,
+// and falls back to a small pool of pread() threads otherwise.
+AsyncReader* createAsyncReader(int queueDepth);
+
+#endif // ASYNC_READER_H
@@ -0,0 +1,392 @@
+#include "color_error.h"
+#include "async_log.h"
+#include "full_screen_pass.h"
+#include "shader_library.h"
+#include "shader_manager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Pixel errors larger than this many 8-bit steps are counted. Leaves room
+// for interpolation rounding and the DITHER variant.
+const double kToleranceSteps = 2.0;
+
+// Checks between periodic summaries in the log.
+const unsigned long kLogInterval = 100;
+
+#ifdef USE_GLES2
+// Without fences, a result is read back once this many frames have been
+// drawn after it, by when the GPU is normally done with it.
+const unsigned long kReadbackDelayFrames = 2;
+#endif
+
+// Cells and frame pixels are fetched one by one at their centres.
+void setNearestClamp() {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+} // namespace
+
+const int ColorErrorMonitor::kResults;
+
+ColorErrorMonitor::ColorErrorMonitor(ShaderManager& shaders, ShaderVariantCache& variants,
+                                     const SceneVertex* triangle, const GLfloat* background, int interval)
+    : shaders_(shaders),
+      errorProgramId_(variants.request(kColorErrorShader, ShaderHighPrecision, true)),
+      reduceProgramId_(variants.request(kColorReduceShader, ShaderHighPrecision, true)),
+      interval_(interval > 0 ? interval : 1),
+      width_(0), height_(0), blockPixels_(0.0), levelCount_(0), head_(0), pending_(0),
+      errorProgram_(0), reduceProgram_(0), invertLoc_(-1), errorTargetSizeLoc_(-1), sourceSizeLoc_(-1),
+      reduceTargetSizeLoc_(-1),
+#ifdef USE_GLES2
+      errorPositionLoc_(-1), reducePositionLoc_(-1),
+#endif
+      frames_(0), checked_(0), failed_(0), failing_(false), worstError_(0.0) {
+    memcpy(triangle_, triangle, sizeof(triangle_));
+    memcpy(background_, background, sizeof(background_));
+    memset(&last_, 0, sizeof(last_));
+    for (int i = 0; i < kResults; ++i)
+        results_[i].frame = 0;
+}
+
+ColorErrorMonitor::~ColorErrorMonitor() {
+    destroy();
+}
+
+bool ColorErrorMonitor::create(int width, int height) {
+    destroy();
+    if (width <= 0 || height <= 0 || !shaders_.ready(errorProgramId_) || !shaders_.ready(reduceProgramId_))
+        return false;
+#ifdef USE_GLES2
+    // Packing cells into RGBA8 needs integers up to 2^24 to be exact, the
+    // 23 mantissa bits of a full float.
+    GLint range[2];
+    GLint precision = 0;
+    glGetShaderPrecisionFormat(GL_FRAGMENT_SHADER, GL_HIGH_FLOAT, range, &precision);
+    if (precision < 23) {
+        LogLine(LogError) << "Color check: highp fragment precision unsupported";
+        return false;
+    }
+#endif
+    width_ = width;
+    height_ = height;
+
+    frame_ = GlTexture::generate();
+    glBindTexture(GL_TEXTURE_2D, frame_.get());
+    setNearestClamp();
+#ifdef USE_GLES2
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+#else
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+#endif
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Each level has a quarter of the cells of the one before in both
+    // directions, down to a single cell.
+    std::vector<int> sizes;
+    int cellsX = width;
+    int cellsY = height;
+    blockPixels_ = 1.0;
+    do {
+        cellsX = (cellsX + 3) / 4;
+        cellsY = (cellsY + 3) / 4;
+        blockPixels_ *= 16.0;
+        sizes.push_back(cellsX);
+        sizes.push_back(cellsY);
+    } while (cellsX > 1 || cellsY > 1);
+    levelCount_ = static_cast<int>(sizes.size() / 2);
+
+    bool complete = true;
+#ifdef USE_GLES2
+    levels_.resize(levelCount_ - 1);
+    for (int i = 0; i < kResults; ++i)
+        complete = complete && createLevel(results_[i].level, 1, 1);
+#else
+    levels_.resize(levelCount_);
+    GlNamePool<GlBufferTraits> buffers(kResults);
+    for (int i = 0; i < kResults; ++i) {
+        results_[i].buffer = buffers.acquire();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, results_[i].buffer.get());
+        glBufferData(GL_PIXEL_PACK_BUFFER, 4 * sizeof(GLfloat), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+    for (size_t i = 0; i < levels_.size(); ++i)
+        complete = complete && createLevel(levels_[i], sizes[2 * i], sizes[2 * i + 1]);
+    if (!complete) {
+        destroy();
+        return false;
+    }
+
+    // The expected image: barycentric weights of each vertex as planes
+    // over window coordinates, and the distance of each vertex from the
+    // opposite edge, which turns a weight into a distance in pixels.
+    double x[3], y[3];
+    GLfloat colors[9];
+    for (int i = 0; i < 3; ++i) {
+        x[i] = (triangle_[i].position[0] * 0.5 + 0.5) * width;
+        y[i] = (triangle_[i].position[1] * 0.5 + 0.5) * height;
+        memcpy(&colors[3 * i], triangle_[i].color, sizeof(triangle_[i].color));
+    }
+    GLfloat weights[9] = { 0.0f };
+    GLfloat heights[3] = { 0.0f };
+    for (int i = 0; i < 3; ++i) {
+        int a = (i + 1) % 3;
+        int b = (i + 2) % 3;
+        double nx = y[a] - y[b];
+        double ny = x[b] - x[a];
+        double c = -(nx * x[a] + ny * y[a]);
+        double atVertex = nx * x[i] + ny * y[i] + c;
+        double edgeLength = std::sqrt(nx * nx + ny * ny);
+        if (atVertex == 0.0)
+            continue;  // degenerate: no pixel is inside or outside
+        weights[3 * i] = static_cast<GLfloat>(nx / atVertex);
+        weights[3 * i + 1] = static_cast<GLfloat>(ny / atVertex);
+        weights[3 * i + 2] = static_cast<GLfloat>(c / atVertex);
+        heights[i] = static_cast<GLfloat>(std::fabs(atVertex) / edgeLength);
+    }
+
+    errorProgram_ = shaders_.program(errorProgramId_);
+    glUseProgram(errorProgram_);
+    glUniform1i(glGetUniformLocation(errorProgram_, "u_frame"), 0);
+    glUniform2f(glGetUniformLocation(errorProgram_, "u_frameSize"),
+                static_cast<GLfloat>(width), static_cast<GLfloat>(height));
+    glUniform3fv(glGetUniformLocation(errorProgram_, "u_weights"), 3, weights);
+    glUniform3fv(glGetUniformLocation(errorProgram_, "u_heights"), 1, heights);
+    glUniform3fv(glGetUniformLocation(errorProgram_, "u_colors"), 3, colors);
+    glUniform3fv(glGetUniformLocation(errorProgram_, "u_background"), 1, background_);
+    glUniform1f(glGetUniformLocation(errorProgram_, "u_tolerance"), static_cast<GLfloat>(kToleranceSteps / 255.0));
+    invertLoc_ = glGetUniformLocation(errorProgram_, "u_invert");
+    errorTargetSizeLoc_ = glGetUniformLocation(errorProgram_, "u_targetSize");
+
+    reduceProgram_ = shaders_.program(reduceProgramId_);
+    glUseProgram(reduceProgram_);
+    glUniform1i(glGetUniformLocation(reduceProgram_, "u_source"), 0);
+    sourceSizeLoc_ = glGetUniformLocation(reduceProgram_, "u_sourceSize");
+    reduceTargetSizeLoc_ = glGetUniformLocation(reduceProgram_, "u_targetSize");
+    glUseProgram(0);
+
+#ifdef USE_GLES2
+    errorPositionLoc_ = glGetAttribLocation(errorProgram_, "a_position");
+    reducePositionLoc_ = glGetAttribLocation(reduceProgram_, "a_position");
+#else
+    vertexArray_ = GlVertexArray::generate();
+    vertexBuffer_ = GlBuffer::generate();
+    glBindVertexArray(vertexArray_.get());
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer_.get());
+    glBufferData(GL_ARRAY_BUFFER, sizeof(fullScreenTriangle), fullScreenTriangle, GL_STATIC_DRAW);
+    PassVertexLayout::bind();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+
+    LogLine(LogInfo) << "Color check: " << width << "x" << height << " reduced in " << levelCount_
+                     << " passes, every " << interval_ << " frames";
+    return true;
+}
+
+void ColorErrorMonitor::destroy() {
+    frame_.reset();
+    levels_.clear();
+    for (int i = 0; i < kResults; ++i) {
+#ifdef USE_GLES2
+        results_[i].level.framebuffer.reset();
+        results_[i].level.texture.reset();
+#else
+        results_[i].fence.reset();
+        results_[i].buffer.reset();
+#endif
+    }
+#ifndef USE_GLES2
+    vertexArray_.reset();
+    vertexBuffer_.reset();
+#endif
+    levelCount_ = 0;
+    head_ = 0;
+    pending_ = 0;
+}
+
+bool ColorErrorMonitor::createLevel(Level& level, int width, int height) {
+    level.width = width;
+    level.height = height;
+    level.texture = GlTexture::generate();
+    glBindTexture(GL_TEXTURE_2D, level.texture.get());
+    setNearestClamp();
+#ifdef USE_GLES2
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2 * width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+#else
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+#endif
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    level.framebuffer = GlFramebuffer::generate();
+    glBindFramebuffer(GL_FRAMEBUFFER, level.framebuffer.get());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, level.texture.get(), 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        LogLine(LogError) << "Color check: reduction target incomplete, status " << static_cast<unsigned>(status);
+        return false;
+    }
+    return true;
+}
+
+const ColorErrorMonitor::Level& ColorErrorMonitor::level(int index, const Result& result) const {
+#ifdef USE_GLES2
+    // The final level is the result's own target.
+    if (index == levelCount_ - 1)
+        return result.level;
+#else
+    (void)result;
+#endif
+    return levels_[index];
+}
+
+// Renders into the level, telling the current program its size in texels.
+void ColorErrorMonitor::bindLevel(const Level& level, GLint targetSizeLoc) {
+#ifdef USE_GLES2
+    GLsizei width = 2 * level.width;
+#else
+    GLsizei width = level.width;
+#endif
+    glBindFramebuffer(GL_FRAMEBUFFER, level.framebuffer.get());
+    glViewport(0, 0, width, level.height);
+    glUniform2f(targetSizeLoc, static_cast<GLfloat>(width), static_cast<GLfloat>(level.height));
+}
+
+void ColorErrorMonitor::drawPass(GLint positionLoc) {
+#ifdef USE_GLES2
+    PassVertexLayout::bind(&positionLoc, fullScreenTriangle);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    PassVertexLayout::disable(&positionLoc);
+#else
+    (void)positionLoc;
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+#endif
+}
+
+void ColorErrorMonitor::frameDrawn(float invert) {
+    if (levelCount_ == 0 || frames_++ % interval_ != 0)
+        return;
+    // Skipped while the results of earlier checks are still outstanding
+    if (pending_ == kResults)
+        return;
+    Result& result = results_[(head_ + pending_) % kResults];
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, frame_.get());
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width_, height_);
+#ifdef USE_GLES2
+    GLint positionLoc = errorPositionLoc_;
+#else
+    GLint positionLoc = 0;
+    glBindVertexArray(vertexArray_.get());
+#endif
+
+    // Frame pixels against the expected image into the first level...
+    glUseProgram(errorProgram_);
+    glUniform1f(invertLoc_, invert);
+    bindLevel(level(0, result), errorTargetSizeLoc_);
+    drawPass(positionLoc);
+
+    // ...then each level into the next
+    glUseProgram(reduceProgram_);
+#ifdef USE_GLES2
+    positionLoc = reducePositionLoc_;
+#endif
+    for (int i = 1; i < levelCount_; ++i) {
+        const Level& source = level(i - 1, result);
+        glBindTexture(GL_TEXTURE_2D, source.texture.get());
+        glUniform2f(sourceSizeLoc_, static_cast<GLfloat>(source.width), static_cast<GLfloat>(source.height));
+        bindLevel(level(i, result), reduceTargetSizeLoc_);
+        drawPass(positionLoc);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+#ifndef USE_GLES2
+    // The final cell goes into this check's pixel buffer, fenced so that
+    // poll() maps it only once it has arrived.
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, result.buffer.get());
+    glReadPixels(0, 0, 1, 1, GL_RGBA, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    result.fence.reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    glBindVertexArray(0);
+#endif
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width_, height_);
+    result.frame = frames_;
+    ++pending_;
+}
+
+void ColorErrorMonitor::poll() {
+    while (pending_ > 0) {
+        Result& result = results_[head_];
+#ifdef USE_GLES2
+        if (frames_ - result.frame < kReadbackDelayFrames)
+            return;
+        unsigned char cell[8];
+        glBindFramebuffer(GL_FRAMEBUFFER, result.level.framebuffer.get());
+        glReadPixels(0, 0, 2, 1, GL_RGBA, GL_UNSIGNED_BYTE, cell);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        double maxError = cell[0] / 255.0;
+        double mean = (cell[1] * 256 + cell[2]) / 65535.0;
+        double fraction = (cell[4] * 65536.0 + cell[5] * 256.0 + cell[6]) / 16777215.0;
+#else
+        if (glClientWaitSync(result.fence.get(), 0, 0) == GL_TIMEOUT_EXPIRED)
+            return;
+        result.fence.reset();
+        GLfloat cell[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, result.buffer.get());
+        void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(cell), GL_MAP_READ_BIT);
+        if (mapped) {
+            memcpy(cell, mapped, sizeof(cell));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        double maxError = cell[0];
+        double mean = cell[1];
+        double fraction = cell[2];
+#endif
+        head_ = (head_ + 1) % kResults;
+        --pending_;
+
+        // Means and fractions are over the nominal block of the final
+        // cell, of which the frame is a part.
+        ColorErrorStats stats;
+        stats.maxError = maxError * 255.0;
+        stats.sumError = mean * blockPixels_ * 255.0;
+        stats.count = std::floor(fraction * blockPixels_ + 0.5);
+        stats.pixels = static_cast<double>(width_) * height_;
+        finish(stats);
+    }
+}
+
+void ColorErrorMonitor::finish(const ColorErrorStats& stats) {
+    last_ = stats;
+    ++checked_;
+    worstError_ = std::max(worstError_, stats.maxError);
+
+    bool failing = stats.count > 0.0 || stats.maxError > kToleranceSteps;
+    if (failing)
+        ++failed_;
+    if (failing && !failing_) {
+        LogLine(LogError) << "Color check: frame off by up to " << stats.maxError << " steps, "
+                          << stats.count << " pixels over " << kToleranceSteps << " steps";
+    } else if (!failing && failing_) {
+        LogLine(LogInfo) << "Color check: frames within tolerance again";
+    }
+    failing_ = failing;
+
+    if (checked_ % kLogInterval == 0) {
+        LogLine(LogInfo) << "Color check: " << checked_ << " frames checked, " << failed_
+                         << " over tolerance, worst error " << worstError_ << " steps, mean "
+                         << stats.sumError / stats.pixels << " steps";
+        worstError_ = 0.0;
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef COLOR_ERROR_H
+#define COLOR_ERROR_H
+
+#include "gl_handle.h"
+#include "gl_platform.h"
+#include "scene_file.h"
+
+#include <vector>
+
+class ShaderManager;
+class ShaderVariantCache;
+
+// Colour error of one checked frame. The error of a pixel is the largest
+// difference of any of its channels from the expected colour, in 8-bit
+// steps.
+struct ColorErrorStats {
+    double maxError;
+    double sumError;
+    double count;   // pixels with an error over the tolerance
+    double pixels;  // pixels in the frame
+};
+
+// Checks the colour accuracy of the built-in triangle on the GPU, so that
+// it can run on every frame of a fielded unit without reading the frame
+// back. The drawn frame is copied into a texture and compared against the
+// colour expected from barycentric interpolation of the vertex colours,
+// 4x4 pixels at a time; the resulting cells of maximum, mean and count
+// are then reduced 4x4 at a time down to a single cell. Only that cell is
+// read back: 16 bytes of RGBA32F on desktop GL, 8 bytes of RGBA8 on GLES2
+// (see shader_library.cpp for the encoding).
+//
+// Readbacks are collected a few frames later, through pixel buffers and
+// fences on desktop GL and from a small ring of result targets on GLES2,
+// so the render loop does not wait for them. On GLES2 the count has a
+// resolution of 1/2^24 of the area the final cell covers, single pixels
+// up to 4K frames, and the mean one of 1/65536.
+class ColorErrorMonitor {
+public:
+    // Queues the reduction programs as required. triangle holds three
+    // vertices in normalized device coordinates, drawn over background.
+    // Every interval-th drawn frame is checked.
+    ColorErrorMonitor(ShaderManager& shaders, ShaderVariantCache& variants, const SceneVertex* triangle,
+                      const GLfloat* background, int interval);
+    ~ColorErrorMonitor();
+
+    // Allocates the reduction chain for a framebuffer of the given size.
+    // Call once the required shaders are built, and again on resize.
+    bool create(int width, int height);
+    void destroy();
+
+    // Call after a frame has been drawn into the default framebuffer and
+    // before it is swapped, with the u_invert value it was drawn with.
+    // Leaves framebuffer 0 bound with the full viewport.
+    void frameDrawn(float invert);
+
+    // Collects finished results, logging failing frames as they are found
+    // and a summary periodically.
+    void poll();
+
+    const ColorErrorStats& lastResult() const { return last_; }
+    unsigned long framesChecked() const { return checked_; }
+    unsigned long framesFailed() const { return failed_; }
+
+private:
+    ColorErrorMonitor(const ColorErrorMonitor&);
+    ColorErrorMonitor& operator=(const ColorErrorMonitor&);
+
+    // A level of the reduction chain; width and height are in cells.
+    struct Level {
+        GlTexture texture;
+        GlFramebuffer framebuffer;
+        int width;
+        int height;
+    };
+
+    // Where the final cell of a check is read back from.
+    struct Result {
+#ifdef USE_GLES2
+        Level level;
+#else
+        GlBuffer buffer;
+        GlFence fence;
+#endif
+        unsigned long frame;
+    };
+
+    static const int kResults = 3;
+
+    bool createLevel(Level& level, int width, int height);
+    const Level& level(int index, const Result& result) const;
+    void bindLevel(const Level& level, GLint targetSizeLoc);
+    void drawPass(GLint positionLoc);
+    void finish(const ColorErrorStats& stats);
+
+    ShaderManager& shaders_;
+    int errorProgramId_;
+    int reduceProgramId_;
+    SceneVertex triangle_[3];
+    GLfloat background_[3];
+    int interval_;
+
+    int width_;
+    int height_;
+    double blockPixels_;  // nominal pixels per cell of the final level
+    GlTexture frame_;
+    std::vector<Level> levels_;  // all but the final level on GLES2
+    int levelCount_;
+    Result results_[kResults];
+    int head_;
+    int pending_;
+
+    GLuint errorProgram_;
+    GLuint reduceProgram_;
+    GLint invertLoc_;
+    GLint errorTargetSizeLoc_;
+    GLint sourceSizeLoc_;
+    GLint reduceTargetSizeLoc_;
+#ifdef USE_GLES2
+    GLint errorPositionLoc_;
+    GLint reducePositionLoc_;
+#else
+    GlVertexArray vertexArray_;
+    GlBuffer vertexBuffer_;
+#endif
+
+    unsigned long frames_;
+    unsigned long checked_;
+    unsigned long failed_;
+    bool failing_;
+    double worstError_;
+    ColorErrorStats last_;
+};
+
+#endif // COLOR_ERROR_H
@@ -0,0 +1,182 @@
+#include "command_buffer.h"
+#include "async_log.h"
+#include "draw_batcher.h"
+#include "frame_arena.h"
+#include "job_system.h"
+#include "platform_timer.h"
+#include "scene_file.h"
+
+
+namespace {
+
+const size_t kFloatsPerTriangle = 3 * kSceneVertexStride / sizeof(float);
+
+// How often recording time is logged, in frames.
+const unsigned long kLogInterval = 300;
+
+enum CommandType {
+    kSetState,
+    kTriangles
+};
+
+// Every command starts with a header; the payload follows it directly.
+// Sizes are multiples of 8 so that the next header stays aligned.
+struct CommandHeader {
+    uint32_t type;
+    uint32_t bytes;  // including the header
+};
+
+struct SetStateCommand {
+    CommandHeader header;
+    uint64_t stateKey;
+};
+
+struct TrianglesCommand {
+    CommandHeader header;
+    uint64_t count;
+    // count * kFloatsPerTriangle floats follow.
+};
+
+size_t alignCommand(size_t bytes) {
+    return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+} // namespace
+
+CommandBuffer::CommandBuffer(FrameArena* arena, size_t blockBytes)
+    : arena_(arena), current_(0), blockBytes_(blockBytes) {
+}
+
+CommandBuffer::~CommandBuffer() {
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        if (blocks_[i].owned)
+            delete[] reinterpret_cast<uint64_t*>(blocks_[i].data);
+    }
+}
+
+void CommandBuffer::reset() {
+    // Arena blocks went away with the last frame; heap blocks are reused.
+    size_t kept = 0;
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        if (blocks_[i].owned) {
+            blocks_[kept] = blocks_[i];
+            blocks_[kept].used = 0;
+            ++kept;
+        }
+    }
+    blocks_.resize(kept);
+    current_ = 0;
+}
+
+void* CommandBuffer::allocate(size_t bytes) {
+    while (current_ < blocks_.size()) {
+        Block& block = blocks_[current_];
+        if (block.size - block.used >= bytes) {
+            void* p = block.data + block.used;
+            block.used += bytes;
+            return p;
+        }
+        ++current_;
+    }
+    // Oversized commands get a block of their own.
+    Block block;
+    block.size = bytes > blockBytes_ ? bytes : blockBytes_;
+    block.data = arena_ ? static_cast<char*>(arena_->allocate(block.size, 8)) : nullptr;
+    block.owned = block.data == nullptr;
+    if (block.owned) {
+        // new[] of 8-byte elements keeps the block aligned for the headers.
+        block.data = reinterpret_cast<char*>(new uint64_t[block.size / 8]);
+    }
+    block.used = bytes;
+    blocks_.push_back(block);
+    current_ = blocks_.size() - 1;
+    return block.data;
+}
+
+void CommandBuffer::setState(uint64_t stateKey) {
+    SetStateCommand* command = static_cast<SetStateCommand*>(allocate(sizeof(SetStateCommand)));
+    command->header.type = kSetState;
+    command->header.bytes = sizeof(SetStateCommand);
+    command->stateKey = stateKey;
+}
+
+float* CommandBuffer::addTriangles(size_t count) {
+    size_t bytes = alignCommand(sizeof(TrianglesCommand) + count * kFloatsPerTriangle * sizeof(float));
+    TrianglesCommand* command = static_cast<TrianglesCommand*>(allocate(bytes));
+    command->header.type = kTriangles;
+    command->header.bytes = static_cast<uint32_t>(bytes);
+    command->count = count;
+    return reinterpret_cast<float*>(command + 1);
+}
+
+void CommandBuffer::replay(DrawBatcher& batcher) const {
+    uint64_t stateKey = 0;
+    for (size_t b = 0; b < blocks_.size(); ++b) {
+        const char* p = blocks_[b].data;
+        const char* end = p + blocks_[b].used;
+        while (p < end) {
+            const CommandHeader* header = reinterpret_cast<const CommandHeader*>(p);
+            if (header->type == kSetState) {
+                stateKey = reinterpret_cast<const SetStateCommand*>(p)->stateKey;
+            } else {
+                const TrianglesCommand* command = reinterpret_cast<const TrianglesCommand*>(p);
+                const float* triangle = reinterpret_cast<const float*>(command + 1);
+                for (uint64_t i = 0; i < command->count; ++i, triangle += kFloatsPerTriangle)
+                    batcher.submit(stateKey, triangle);
+            }
+            p += header->bytes;
+        }
+    }
+}
+
+size_t CommandBuffer::bytesUsed() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < blocks_.size(); ++i)
+        bytes += blocks_[i].used;
+    return bytes;
+}
+
+CommandRecorder::CommandRecorder(JobSystem& jobs, FrameArena* arena)
+    : jobs_(jobs), frames_(0), recordMs_(0.0) {
+    for (int i = 0; i < jobs_.threadCount(); ++i)
+        buffers_.push_back(new CommandBuffer(arena));
+}
+
+CommandRecorder::~CommandRecorder() {
+    for (size_t i = 0; i < buffers_.size(); ++i)
+        delete buffers_[i];
+}
+
+void CommandRecorder::record(size_t count, const RecordFn& fn) {
+    uint64_t start = monotonicNowNs();
+    size_t buffers = buffers_.size();
+    jobs_.parallelFor(buffers, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            CommandBuffer& buffer = *buffers_[i];
+            buffer.reset();
+            size_t first = count * i / buffers;
+            size_t last = count * (i + 1) / buffers;
+            if (first < last)
+                fn(buffer, first, last);
+        }
+    });
+
+    recordMs_ += nsToMs(monotonicNowNs() - start);
+    if (++frames_ % kLogInterval == 0)
+        logStats();
+}
+
+void CommandRecorder::replay(DrawBatcher& batcher) const {
+    for (size_t i = 0; i < buffers_.size(); ++i)
+        buffers_[i]->replay(batcher);
+}
+
+void CommandRecorder::logStats() {
+    size_t bytes = 0;
+    for (size_t i = 0; i < buffers_.size(); ++i)
+        bytes += buffers_[i]->bytesUsed();
+    LogLine(LogInfo) << "Command recording: " << recordMs_ / kLogInterval << " ms per frame on "
+                     << buffers_.size() << " threads, " << bytes / 1024 << " KB recorded";
+    recordMs_ = 0.0;
+    jobs_.logStats();
+}
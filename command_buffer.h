@@ -0,0 +1,93 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class DrawBatcher;
+class FrameArena;
+class JobSystem;
+
+// Draw commands recorded without a GL context, for replay on the thread
+// that owns it. Commands are packed back to back into large blocks taken
+// from the frame arena when one is given. If the arena runs out, blocks come
+// from the heap instead and are kept across reset(), so recording a frame
+// does not allocate once the blocks have grown to the frame's size.
+//
+// Arena blocks are only valid until the arena is reset at swap; replay
+// before that and reset() before recording the next frame.
+class CommandBuffer {
+public:
+    explicit CommandBuffer(FrameArena* arena = nullptr, size_t blockBytes = 256 * 1024);
+    ~CommandBuffer();
+
+    // Drops all commands, keeping the storage.
+    void reset();
+
+    // Sets the state key for the triangles recorded after it.
+    void setState(uint64_t stateKey);
+
+    // Reserves count triangles in the scene file vertex layout and returns
+    // where to write them.
+    float* addTriangles(size_t count);
+
+    // Submits the commands in recording order. GL thread only.
+    void replay(DrawBatcher& batcher) const;
+
+    size_t bytesUsed() const;
+
+private:
+    CommandBuffer(const CommandBuffer&);
+    CommandBuffer& operator=(const CommandBuffer&);
+
+    struct Block {
+        char* data;
+        size_t size;
+        size_t used;
+        bool owned;  // heap block, as opposed to arena memory
+    };
+
+    void* allocate(size_t bytes);
+
+    FrameArena* arena_;
+    std::vector<Block> blocks_;
+    size_t current_;
+    size_t blockBytes_;
+};
+
+// Records draw commands on the job system's threads, one command buffer
+// per thread. record() splits the work into contiguous ranges, one per
+// buffer; replaying the buffers in index order then gives the same command
+// order as recording everything on one thread.
+class CommandRecorder {
+public:
+    typedef std::function<void(CommandBuffer& buffer, size_t begin, size_t end)> RecordFn;
+
+    CommandRecorder(JobSystem& jobs, FrameArena* arena);
+    ~CommandRecorder();
+
+    // Resets the buffers and records [0, count) with fn. Blocks until every
+    // range is recorded. Call from a job system thread.
+    void record(size_t count, const RecordFn& fn);
+
+    // Replays all buffers in order. GL thread only.
+    void replay(DrawBatcher& batcher) const;
+
+    size_t bufferCount() const { return buffers_.size(); }
+
+private:
+    CommandRecorder(const CommandRecorder&);
+    CommandRecorder& operator=(const CommandRecorder&);
+
+    void logStats();
+
+    JobSystem& jobs_;
+    std::vector<CommandBuffer*> buffers_;
+
+    unsigned long frames_;
+    double recordMs_;
+};
+
+#endif // COMMAND_BUFFER_H
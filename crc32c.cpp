@@ -0,0 +1,89 @@
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+#if defined(__ARM_FEATURE_CRC32) || defined(__SSE4_2__)
+
+// Eight bytes at a time, loaded with memcpy as data need not be aligned.
+uint32_t update(uint32_t crc, const unsigned char* p, size_t size) {
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+#if defined(__ARM_FEATURE_CRC32)
+        crc = __crc32cd(crc, word);
+#elif defined(__x86_64__)
+        crc = static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+#else
+        crc = _mm_crc32_u32(crc, static_cast<uint32_t>(word));
+        crc = _mm_crc32_u32(crc, static_cast<uint32_t>(word >> 32));
+#endif
+    }
+    for (; size > 0; ++p, --size) {
+#if defined(__ARM_FEATURE_CRC32)
+        crc = __crc32cb(crc, *p);
+#else
+        crc = _mm_crc32_u8(crc, *p);
+#endif
+    }
+    return crc;
+}
+
+#else
+
+// Reflected CRC-32C polynomial
+const uint32_t kPolynomial = 0x82F63B78u;
+
+// table[k][b] is the CRC of byte b followed by k zero bytes, so eight
+// bytes are folded in with eight lookups instead of eight dependent ones.
+struct SliceTables {
+    uint32_t table[8][256];
+
+    SliceTables() {
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ (kPolynomial & (0u - (crc & 1u)));
+            table[0][b] = crc;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int b = 0; b < 256; ++b)
+                table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+        }
+    }
+};
+
+const SliceTables& sliceTables() {
+    static const SliceTables tables;
+    return tables;
+}
+
+// Bytes are assembled explicitly, so the result does not depend on the
+// byte order of the target.
+uint32_t update(uint32_t crc, const unsigned char* p, size_t size) {
+    const uint32_t (*t)[256] = sliceTables().table;
+    for (; size >= 8; p += 8, size -= 8) {
+        crc ^= static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+               static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+        crc = t[7][crc & 0xFF] ^ t[6][(crc >> 8) & 0xFF] ^ t[5][(crc >> 16) & 0xFF] ^ t[4][crc >> 24] ^
+              t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    for (; size > 0; ++p, --size)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+    return crc;
+}
+
+#endif
+
+} // namespace
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+    return ~update(~crc, static_cast<const unsigned char*>(data), size);
+}
@@ -0,0 +1,14 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32C (Castagnoli) of a byte range. Pass an earlier result as crc to
+// continue it over more data. Uses the CRC32 instructions when the
+// compiler targets ARMv8 or SSE4.2, and slicing-by-8 tables otherwise
+// (ARMv7 such as the Cortex-A9 of the i.MX6 has neither, and NEON has no
+// carry-less multiply there); every path gives the same result.
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+#endif // CRC32C_H
@@ -0,0 +1,135 @@
+#include "damage_tracker.h"
+#include "gl_platform.h"
+
+#include <algorithm>
+
+namespace {
+
+// Swap chains deeper than this are treated as having unknown contents.
+const size_t kMaxHistory = 4;
+
+bool intersects(const DamageRect& a, const DamageRect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+DamageRect unite(const DamageRect& a, const DamageRect& b) {
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.width, b.x + b.width);
+    int y1 = std::max(a.y + a.height, b.y + b.height);
+    DamageRect r = { x0, y0, x1 - x0, y1 - y0 };
+    return r;
+}
+
+} // namespace
+
+DamageTracker::DamageTracker(int maxRects)
+    : width_(0), height_(0), maxRects_(maxRects > 0 ? maxRects : 1),
+      history_(kMaxHistory), historyCount_(0) {
+    // merge() briefly holds one rect more than the limit.
+    current_.reserve(maxRects_ + 1);
+    repaint_.reserve(maxRects_ + 1);
+    for (size_t i = 0; i < history_.size(); ++i)
+        history_[i].reserve(maxRects_ + 1);
+}
+
+void DamageTracker::resize(int width, int height) {
+    width_ = width;
+    height_ = height;
+    historyCount_ = 0;
+    addFull();
+}
+
+void DamageTracker::addRect(int x, int y, int width, int height) {
+    DamageRect rect = { x, y, width, height };
+    clip(rect);
+    if (rect.width <= 0 || rect.height <= 0)
+        return;
+    merge(current_, rect, maxRects_);
+}
+
+void DamageTracker::addFull() {
+    current_.clear();
+    addRect(0, 0, width_, height_);
+}
+
+const std::vector<DamageRect>& DamageTracker::repaintRects(int bufferAge) {
+    repaint_.clear();
+    if (bufferAge <= 0 || static_cast<size_t>(bufferAge - 1) > historyCount_) {
+        DamageRect rect = { 0, 0, width_, height_ };
+        repaint_.push_back(rect);
+        return repaint_;
+    }
+
+    repaint_.assign(current_.begin(), current_.end());
+    for (int i = 0; i < bufferAge - 1; ++i) {
+        for (size_t j = 0; j < history_[i].size(); ++j)
+            merge(repaint_, history_[i][j], maxRects_);
+    }
+    return repaint_;
+}
+
+void DamageTracker::endFrame() {
+    // Rotate the oldest entry to the front and swap this frame into it.
+    std::rotate(history_.begin(), history_.end() - 1, history_.end());
+    history_[0].swap(current_);
+    current_.clear();
+    if (historyCount_ < history_.size())
+        ++historyCount_;
+}
+
+void DamageTracker::clip(DamageRect& rect) const {
+    int x0 = std::max(rect.x, 0);
+    int y0 = std::max(rect.y, 0);
+    int x1 = std::min(rect.x + rect.width, width_);
+    int y1 = std::min(rect.y + rect.height, height_);
+    rect.x = x0;
+    rect.y = y0;
+    rect.width = x1 - x0;
+    rect.height = y1 - y0;
+}
+
+// Adds a rect, folding it into any rect it overlaps. Once the list is full
+// the closest pair is collapsed into its bounding box, which overdraws a
+// little but keeps the number of scissored passes bounded.
+void DamageTracker::merge(std::vector<DamageRect>& rects, const DamageRect& rect, int maxRects) {
+    DamageRect merged = rect;
+    for (size_t i = 0; i < rects.size();) {
+        if (intersects(rects[i], merged)) {
+            merged = unite(rects[i], merged);
+            rects.erase(rects.begin() + i);
+            i = 0;
+        } else {
+            ++i;
+        }
+    }
+    rects.push_back(merged);
+
+    while (rects.size() > static_cast<size_t>(maxRects)) {
+        size_t bestA = 0, bestB = 1;
+        long bestArea = -1;
+        for (size_t a = 0; a < rects.size(); ++a) {
+            for (size_t b = a + 1; b < rects.size(); ++b) {
+                DamageRect u = unite(rects[a], rects[b]);
+                long area = static_cast<long>(u.width) * u.height;
+                if (bestArea < 0 || area < bestArea) {
+                    bestArea = area;
+                    bestA = a;
+                    bestB = b;
+                }
+            }
+        }
+        rects[bestA] = unite(rects[bestA], rects[bestB]);
+        rects.erase(rects.begin() + bestB);
+    }
+}
+
+void scissorToDamage(const DamageRect* rect) {
+    if (!rect) {
+        glDisable(GL_SCISSOR_TEST);
+        return;
+    }
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(rect->x, rect->y, rect->width, rect->height);
+}
@@ -0,0 +1,65 @@
+#ifndef DAMAGE_TRACKER_H
+#define DAMAGE_TRACKER_H
+
+#include <stddef.h>
+#include <vector>
+
+// A damaged region of the surface, in window coordinates with the origin at
+// the bottom left (the convention shared by glScissor and EGL damage rects).
+struct DamageRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Collects the rectangles that change during a frame and works out which
+// part of the back buffer has to be repainted before it can be presented.
+//
+// The repaint region depends on the age of the back buffer: a buffer that
+// was presented N frames ago is missing the damage of the last N - 1 frames
+// as well as this one. An age of 0 means the contents are undefined and the
+// whole surface must be redrawn.
+class DamageTracker {
+public:
+    explicit DamageTracker(int maxRects = 8);
+
+    // Sets the surface size. Resizing damages the whole surface.
+    void resize(int width, int height);
+
+    void addRect(int x, int y, int width, int height);
+    void addFull();
+
+    // True when nothing has been damaged since the last endFrame().
+    bool empty() const { return current_.empty(); }
+
+    // Damage submitted by this frame, suitable for eglSwapBuffersWithDamage.
+    const std::vector<DamageRect>& frameRects() const { return current_; }
+
+    // Region that has to be repainted into a back buffer of the given age.
+    // Valid until the next call.
+    const std::vector<DamageRect>& repaintRects(int bufferAge);
+
+    // Moves this frame's damage into the history and starts a new frame.
+    void endFrame();
+
+private:
+    void clip(DamageRect& rect) const;
+    static void merge(std::vector<DamageRect>& rects, const DamageRect& rect, int maxRects);
+
+    int width_;
+    int height_;
+    int maxRects_;
+    std::vector<DamageRect> current_;
+    std::vector<DamageRect> repaint_;
+    // history_[0] is the damage of the previous frame, history_[1] the one
+    // before that, and so on. Only the first historyCount_ are valid; the
+    // vectors are recycled so a frame does not allocate.
+    std::vector<std::vector<DamageRect> > history_;
+    size_t historyCount_;
+};
+
+// Restricts drawing to a single damage rect. Pass nullptr to disable.
+void scissorToDamage(const DamageRect* rect);
+
+#endif // DAMAGE_TRACKER_H
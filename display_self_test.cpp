@@ -0,0 +1,243 @@
+#include "display_self_test.h"
+#include "async_log.h"
+#include "crc32c.h"
+#include "full_screen_pass.h"
+#include "platform_timer.h"
+#include "shader_library.h"
+#include "shader_manager.h"
+#include "shader_variants.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Size of the square test pattern in pixels
+const int kPatternSize = 64;
+
+// A pattern the GPU has not finished this long after it was drawn is a
+// fault, well before a watchdog would notice a hung display.
+const uint64_t kGpuDeadlineNs = 100 * 1000 * 1000ull;
+
+// CPU time one test may take on the render thread: drawing the pattern,
+// reading it back and checksumming it.
+const uint64_t kCpuBudgetNs = 1000 * 1000ull;
+
+// Without fences, a pattern is read back once this many iterations have
+// passed since it was drawn, by when the GPU is normally done with it.
+const unsigned long kReadbackDelay = 2;
+
+// Tests between periodic summaries in the log.
+const unsigned long kLogInterval = 100;
+
+struct SignatureText {
+    char text[11];
+};
+
+SignatureText formatSignature(uint32_t signature) {
+    SignatureText s;
+    snprintf(s.text, sizeof(s.text), "0x%08X", static_cast<unsigned>(signature));
+    return s;
+}
+
+} // namespace
+
+DisplaySelfTest::DisplaySelfTest(ShaderManager& shaders, ShaderVariantCache& variants, int interval,
+                                 uint32_t signature, bool haveSignature)
+    : shaders_(shaders),
+      programId_(variants.request(kSelfTestShader, 0, true)),
+      interval_(interval > 0 ? interval : 1),
+      signature_(signature), haveSignature_(haveSignature),
+      width_(0), height_(0), program_(0), positionLoc_(-1),
+      display_(eglGetCurrentDisplay()), createSync_(nullptr), destroySync_(nullptr), clientWaitSync_(nullptr),
+      fence_(EGL_NO_SYNC_KHR),
+      pending_(false), overdue_(false), sinceDraw_(0), drawnNs_(0), testCpuNs_(0),
+      tests_(0), faults_(0), failing_(false), worstLatencyNs_(0), worstCpuNs_(0) {
+    const char* extensions = eglQueryString(display_, EGL_EXTENSIONS);
+    if (extensions && strstr(extensions, "EGL_KHR_fence_sync")) {
+        createSync_ = reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"));
+        destroySync_ = reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"));
+        clientWaitSync_ = reinterpret_cast<PFNEGLCLIENTWAITSYNCKHRPROC>(eglGetProcAddress("eglClientWaitSyncKHR"));
+    }
+    if (!createSync_ || !destroySync_ || !clientWaitSync_)
+        createSync_ = nullptr;
+}
+
+DisplaySelfTest::~DisplaySelfTest() {
+    destroy();
+}
+
+bool DisplaySelfTest::create(int width, int height) {
+    destroy();
+    if (!shaders_.ready(programId_))
+        return false;
+    width_ = width;
+    height_ = height;
+
+    texture_ = GlTexture::generate();
+    glBindTexture(GL_TEXTURE_2D, texture_.get());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kPatternSize, kPatternSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    framebuffer_ = GlFramebuffer::generate();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.get());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_.get(), 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        LogLine(LogError) << "Display self-test: pattern target incomplete, status " << static_cast<unsigned>(status);
+        destroy();
+        return false;
+    }
+
+    program_ = shaders_.program(programId_);
+    positionLoc_ = glGetAttribLocation(program_, "a_position");
+    pixels_.assign(kPatternSize * kPatternSize * 4, 0);
+
+    LogLine(LogInfo) << "Display self-test: every " << interval_ << " iterations, "
+                     << (createSync_ ? "fenced" : "delayed") << " readback, against "
+                     << (haveSignature_ ? formatSignature(signature_).text : "the first pattern");
+
+    // Some drivers compile the program on its first draw, so the first
+    // pattern is drawn and checked here, outside the CPU budget. Without
+    // a signature it becomes the reference.
+    draw();
+    glFinish();
+    deleteFence();
+    pending_ = false;
+    testCpuNs_ = 0;
+    finish(readBack(), monotonicNowNs() - drawnNs_);
+    return true;
+}
+
+void DisplaySelfTest::destroy() {
+    deleteFence();
+    framebuffer_.reset();
+    texture_.reset();
+    pending_ = false;
+    sinceDraw_ = 0;
+}
+
+void DisplaySelfTest::deleteFence() {
+    if (fence_ != EGL_NO_SYNC_KHR)
+        destroySync_(display_, fence_);
+    fence_ = EGL_NO_SYNC_KHR;
+}
+
+void DisplaySelfTest::update() {
+    if (!framebuffer_)
+        return;
+    ++sinceDraw_;
+    if (pending_)
+        check();
+    // A pattern still outstanding when the next is due delays it; the
+    // deadline reports a GPU that stays behind.
+    if (!pending_ && sinceDraw_ >= static_cast<unsigned long>(interval_))
+        draw();
+}
+
+void DisplaySelfTest::draw() {
+    uint64_t start = monotonicNowNs();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.get());
+    glViewport(0, 0, kPatternSize, kPatternSize);
+    glUseProgram(program_);
+    PassVertexLayout::bind(&positionLoc_, fullScreenTriangle);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    PassVertexLayout::disable(&positionLoc_);
+    if (createSync_)
+        fence_ = createSync_(display_, EGL_SYNC_FENCE_KHR, nullptr);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width_, height_);
+    // Starts the GPU on the pattern now rather than at the next swap or
+    // readback, which matters while the loop is idle.
+    glFlush();
+
+    pending_ = true;
+    overdue_ = false;
+    sinceDraw_ = 0;
+    drawnNs_ = monotonicNowNs();
+    testCpuNs_ = drawnNs_ - start;
+}
+
+void DisplaySelfTest::check() {
+    uint64_t start = monotonicNowNs();
+    if (fence_ != EGL_NO_SYNC_KHR) {
+        if (clientWaitSync_(display_, fence_, 0, 0) != EGL_CONDITION_SATISFIED_KHR) {
+            if (!overdue_ && start - drawnNs_ > kGpuDeadlineNs) {
+                overdue_ = true;
+                LogLine(LogError) << "Display self-test: GPU has not finished the pattern after "
+                                  << nsToMs(start - drawnNs_) << " ms";
+                fault();
+            }
+            return;
+        }
+        deleteFence();
+    } else if (sinceDraw_ < kReadbackDelay) {
+        return;
+    }
+
+    uint32_t signature = readBack();
+    uint64_t end = monotonicNowNs();
+    testCpuNs_ += end - start;
+    pending_ = false;
+    // Without a fence, the readback waits for the GPU, so the latency runs
+    // until it returns.
+    finish(signature, (createSync_ ? start : end) - drawnNs_);
+}
+
+uint32_t DisplaySelfTest::readBack() {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.get());
+    glReadPixels(0, 0, kPatternSize, kPatternSize, GL_RGBA, GL_UNSIGNED_BYTE, &pixels_[0]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return crc32c(&pixels_[0], pixels_.size());
+}
+
+void DisplaySelfTest::finish(uint32_t signature, uint64_t latencyNs) {
+    ++tests_;
+    if (latencyNs > worstLatencyNs_)
+        worstLatencyNs_ = latencyNs;
+    if (testCpuNs_ > worstCpuNs_)
+        worstCpuNs_ = testCpuNs_;
+
+    if (!haveSignature_) {
+        signature_ = signature;
+        haveSignature_ = true;
+        LogLine(LogInfo) << "Display self-test: reference signature " << formatSignature(signature).text
+                         << "; pass it as --self-test-signature to check from the first pattern";
+    }
+
+    bool passed = true;
+    if (signature != signature_) {
+        LogLine(LogError) << "Display self-test: pattern signature " << formatSignature(signature).text
+                          << ", expected " << formatSignature(signature_).text;
+        passed = false;
+    } else if (!createSync_ && latencyNs > kGpuDeadlineNs) {
+        LogLine(LogError) << "Display self-test: GPU took " << nsToMs(latencyNs) << " ms for the pattern";
+        passed = false;
+    }
+    if (testCpuNs_ > kCpuBudgetNs) {
+        LogLine(LogError) << "Display self-test: took " << nsToMs(testCpuNs_) << " ms of CPU, budget "
+                          << nsToMs(kCpuBudgetNs) << " ms";
+        passed = false;
+    }
+    if (!passed) {
+        fault();
+    } else if (failing_) {
+        LogLine(LogInfo) << "Display self-test: passing again";
+        failing_ = false;
+    }
+
+    if (tests_ % kLogInterval == 0) {
+        LogLine(LogInfo) << "Display self-test: " << tests_ << " tests, " << faults_ << " faults, worst GPU latency "
+                         << nsToMs(worstLatencyNs_) << " ms, worst CPU time " << nsToMs(worstCpuNs_) << " ms";
+        worstLatencyNs_ = 0;
+        worstCpuNs_ = 0;
+    }
+}
+
+void DisplaySelfTest::fault() {
+    ++faults_;
+    failing_ = true;
+}
@@ -0,0 +1,99 @@
+#ifndef DISPLAY_SELF_TEST_H
+#define DISPLAY_SELF_TEST_H
+
+#include "gl_handle.h"
+#include "gl_platform.h"
+
+#include <stdint.h>
+#include <vector>
+
+class ShaderManager;
+class ShaderVariantCache;
+
+// Periodic self-test of the GPU for the EGL build, so that a corrupting
+// display pipeline is detected at runtime. Every interval-th render loop
+// iteration a fixed pattern is drawn into a small offscreen framebuffer.
+// Once an EGL_KHR_fence_sync fence says the GPU is done with it (without
+// the extension, a few iterations later) the pattern is read back and its
+// CRC-32C compared against the expected signature.
+//
+// A fault is a signature mismatch, a pattern the GPU has not finished
+// within a deadline, or a test that took more than its CPU budget on the
+// render thread, so a fault is reported within interval iterations plus
+// the deadline. The pattern is 64x64 pixels, which keeps the GPU work and
+// the readback small.
+//
+// The signature depends on the GPU and driver, so it is given per target.
+// Without one, the first pattern drawn becomes the reference and its
+// signature is logged for use from then on.
+class DisplaySelfTest {
+public:
+    // Queues the pattern program as required. Every interval-th call of
+    // update() draws a pattern.
+    DisplaySelfTest(ShaderManager& shaders, ShaderVariantCache& variants, int interval, uint32_t signature,
+                    bool haveSignature);
+    ~DisplaySelfTest();
+
+    // Allocates the pattern target and runs the first test right away.
+    // Call once the required shaders are built, with the surface size,
+    // which update() restores the viewport to.
+    bool create(int width, int height);
+    void destroy();
+
+    // Call once per render loop iteration, idle ones included, outside of
+    // a frame. Checks the outstanding pattern and draws the next one when
+    // due. Leaves framebuffer 0 bound with the full viewport.
+    void update();
+
+    unsigned long testsRun() const { return tests_; }
+    unsigned long faults() const { return faults_; }
+
+    // The expected signature, once given or learned from the first pattern.
+    bool hasSignature() const { return haveSignature_; }
+    uint32_t signature() const { return signature_; }
+
+private:
+    DisplaySelfTest(const DisplaySelfTest&);
+    DisplaySelfTest& operator=(const DisplaySelfTest&);
+
+    void draw();
+    void check();
+    uint32_t readBack();
+    void finish(uint32_t signature, uint64_t latencyNs);
+    void fault();
+    void deleteFence();
+
+    ShaderManager& shaders_;
+    int programId_;
+    int interval_;
+    uint32_t signature_;
+    bool haveSignature_;
+
+    int width_;
+    int height_;
+    GlTexture texture_;
+    GlFramebuffer framebuffer_;
+    GLuint program_;
+    GLint positionLoc_;
+    std::vector<unsigned char> pixels_;
+
+    EGLDisplay display_;
+    PFNEGLCREATESYNCKHRPROC createSync_;
+    PFNEGLDESTROYSYNCKHRPROC destroySync_;
+    PFNEGLCLIENTWAITSYNCKHRPROC clientWaitSync_;
+    EGLSyncKHR fence_;
+
+    bool pending_;
+    bool overdue_;
+    unsigned long sinceDraw_;  // update() calls since the last pattern
+    uint64_t drawnNs_;
+    uint64_t testCpuNs_;
+
+    unsigned long tests_;
+    unsigned long faults_;
+    bool failing_;
+    uint64_t worstLatencyNs_;
+    uint64_t worstCpuNs_;
+};
+
+#endif // DISPLAY_SELF_TEST_H
@@ -0,0 +1,196 @@
+#include "draw_batcher.h"
+#include "async_log.h"
+#include "scene_file.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+const size_t kFloatsPerTriangle = 3 * kSceneVertexStride / sizeof(float);
+
+// How often the saved draw count is logged, in flushes.
+const unsigned long kLogInterval = 300;
+
+// Issues a DrawList with GL. Batched triangles share one program, bound by
+// the caller, and the scene vertex layout, so only blend state and the
+// vertex buffer are set here.
+class GlDrawSink : public DrawStateSink {
+public:
+    GlDrawSink(const DrawBatcher::BindBufferFn& bindBuffer, const DrawBatcher::ApplyStateFn& applyState)
+        : bindBuffer_(bindBuffer), applyState_(applyState), buffer_(0) {}
+
+    void setProgram(uint32_t) {}
+    void setLayout(uint32_t) {}
+    void setBlend(uint32_t blend) { applyState_(blend); }
+
+    void draw(const DrawCommand& command) {
+        if (command.buffer != buffer_) {
+            bindBuffer_(command.buffer);
+            buffer_ = command.buffer;
+        }
+        glDrawArrays(GL_TRIANGLES, command.first, command.count);
+    }
+
+private:
+    const DrawBatcher::BindBufferFn& bindBuffer_;
+    const DrawBatcher::ApplyStateFn& applyState_;
+    GLuint buffer_;
+};
+
+} // namespace
+
+DrawBatcher::DrawBatcher()
+    : bufferBytes_(0), flushes_(0), submittedDraws_(0), issuedDraws_(0) {
+}
+
+void DrawBatcher::submit(uint64_t stateKey, const float* triangle) {
+    KeyIndex submission = { stateKey, static_cast<uint32_t>(pending_.size()) };
+    submissions_.push_back(submission);
+    pending_.insert(pending_.end(), triangle, triangle + kFloatsPerTriangle);
+}
+
+void DrawBatcher::flush(const BindBufferFn& bindBuffer, const ApplyStateFn& applyState) {
+    if (submissions_.empty())
+        return;
+
+    // Stable, so triangles with the same state keep their submission order.
+    radixSortByKey(submissions_, sortScratch_);
+
+    sorted_.resize(pending_.size());
+    for (size_t i = 0; i < submissions_.size(); ++i) {
+        std::copy(pending_.begin() + submissions_[i].index,
+                  pending_.begin() + submissions_[i].index + kFloatsPerTriangle,
+                  sorted_.begin() + i * kFloatsPerTriangle);
+    }
+
+    if (!buffer_)
+        buffer_ = GlBuffer::generate();
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_.get());
+    size_t bytes = sorted_.size() * sizeof(float);
+    if (bytes > bufferBytes_) {
+        glBufferData(GL_ARRAY_BUFFER, bytes, &sorted_[0], GL_STREAM_DRAW);
+        bufferBytes_ = bytes;
+    } else {
+        // Orphan the old storage so we don't wait for last frame's draws.
+        glBufferData(GL_ARRAY_BUFFER, bufferBytes_, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, &sorted_[0]);
+    }
+
+    // Runs are added in key order, so the list needs no sorting of its own.
+    runs_.clear();
+    size_t runStart = 0;
+    for (size_t i = 1; i <= submissions_.size(); ++i) {
+        if (i < submissions_.size() && submissions_[i].key == submissions_[runStart].key)
+            continue;
+        DrawCommand run = { submissions_[runStart].key, buffer_.get(),
+                            static_cast<int32_t>(runStart * 3), static_cast<int32_t>((i - runStart) * 3) };
+        runs_.add(run);
+        runStart = i;
+    }
+    GlDrawSink sink(bindBuffer, applyState);
+    runs_.submit(sink);
+    issuedDraws_ += runs_.size();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    submittedDraws_ += submissions_.size();
+    submissions_.clear();
+    pending_.clear();
+    if (++flushes_ % kLogInterval == 0)
+        logStats();
+}
+
+void DrawBatcher::logStats() {
+    LogLine(LogInfo) << "Batching: " << submittedDraws_ / flushes_ << " draws submitted, "
+                     << issuedDraws_ / flushes_ << " issued per flush ("
+                     << (submittedDraws_ - issuedDraws_) / flushes_ << " saved)";
+}
+
+TriangleField::TriangleField(int count, bool batching, JobSystem* jobs, FrameArena* arena)
+    : count_(count > 0 ? count : 0), columns_(1), cell_(2.0f), batching_(batching) {
+    columns_ = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count_))));
+    if (columns_ < 1)
+        columns_ = 1;
+    cell_ = 2.0f / columns_;
+
+    if (batching_ && jobs) {
+        // Triangles are generated per frame by the recorder instead.
+        recorder_.reset(new CommandRecorder(*jobs, arena));
+    } else {
+        vertices_.resize(count_ * kFloatsPerTriangle);
+        for (size_t i = 0; i < count_; ++i)
+            writeTriangle(i, &vertices_[i * kFloatsPerTriangle]);
+    }
+
+    if (!batching_ && count_ > 0) {
+        staticBuffer_ = GlBuffer::generate();
+        glBindBuffer(GL_ARRAY_BUFFER, staticBuffer_.get());
+        glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(float), &vertices_[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    std::cout << "Triangle field: " << count_ << " triangles, batching "
+              << (batching_ ? "on" : "off") << std::endl;
+}
+
+void TriangleField::draw(const DrawBatcher::BindBufferFn& bindBuffer) {
+    if (recorder_) {
+        recorder_->record(count_, [this](CommandBuffer& buffer, size_t begin, size_t end) {
+            recordRange(buffer, begin, end);
+        });
+        recorder_->replay(batcher_);
+        batcher_.flush(bindBuffer, applyState);
+    } else if (batching_) {
+        for (size_t i = 0; i < count_; ++i)
+            batcher_.submit(stateKey(i), &vertices_[i * kFloatsPerTriangle]);
+        batcher_.flush(bindBuffer, applyState);
+    } else if (staticBuffer_) {
+        bindBuffer(staticBuffer_.get());
+        for (size_t i = 0; i < count_; ++i) {
+            applyState(DrawKey::blend(stateKey(i)));
+            glDrawArrays(GL_TRIANGLES, static_cast<GLint>(i * 3), 3);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glDisable(GL_BLEND);
+}
+
+void TriangleField::applyState(uint32_t blend) {
+    if (blend) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        glDisable(GL_BLEND);
+    }
+}
+
+uint64_t TriangleField::stateKey(size_t index) const {
+    return DrawKey::make(0, 0, static_cast<uint32_t>(index & 1), 0);
+}
+
+void TriangleField::writeTriangle(size_t index, float* out) const {
+    // Top red, bottom left green, bottom right blue, as in the main scene.
+    static const float shape[3][6] = {
+        {  0.0f,  0.5f, 0.0f,  1.0f, 0.0f, 0.0f },
+        { -0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 0.0f },
+        {  0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f }
+    };
+
+    float cx = -1.0f + cell_ * (index % columns_ + 0.5f);
+    float cy = 1.0f - cell_ * (index / columns_ + 0.5f);
+    for (int v = 0; v < 3; ++v) {
+        *out++ = cx + shape[v][0] * cell_;
+        *out++ = cy + shape[v][1] * cell_;
+        *out++ = shape[v][2];
+        *out++ = shape[v][3];
+        *out++ = shape[v][4];
+        *out++ = shape[v][5];
+    }
+}
+
+void TriangleField::recordRange(CommandBuffer& buffer, size_t begin, size_t end) const {
+    for (size_t i = begin; i < end; ++i) {
+        buffer.setState(stateKey(i));
+        writeTriangle(i, buffer.addTriangles(1));
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef DRAW_BATCHER_H
+#define DRAW_BATCHER_H
+
+#include "command_buffer.h"
+#include "draw_list.h"
+#include "gl_handle.h"
+#include "gl_platform.h"
+
+#include <functional>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Collects individually submitted triangles and draws them with as few
+// calls as possible. Each submission carries a packed DrawKey; at flush
+// time triangles are radix sorted by key, copied into one shared vertex buffer and
+// drawn with a single glDrawArrays per run of equal keys. The runs are
+// issued through a DrawList, so state is only set where it changes. GLES2
+// has no instancing or multi-draw, so this is how many small draws become
+// cheap.
+class DrawBatcher {
+public:
+    // Sets GL blend state for a DrawKey blend field; called only when the
+    // blend field changes from one run to the next.
+    typedef std::function<void(uint32_t blend)> ApplyStateFn;
+    // Points the vertex attributes at a buffer in the scene vertex layout.
+    typedef std::function<void(GLuint buffer)> BindBufferFn;
+
+    DrawBatcher();
+
+    // Queues one triangle: three vertices in the scene file layout.
+    void submit(uint64_t stateKey, const float* triangle);
+
+    // Uploads and draws everything submitted since the last flush.
+    void flush(const BindBufferFn& bindBuffer, const ApplyStateFn& applyState);
+
+private:
+    DrawBatcher(const DrawBatcher&);
+    DrawBatcher& operator=(const DrawBatcher&);
+
+    void logStats();
+
+    // Keys with the index of the triangle's first float in pending_.
+    std::vector<KeyIndex> submissions_;
+    std::vector<KeyIndex> sortScratch_;
+    std::vector<float> pending_;
+    std::vector<float> sorted_;
+    DrawList runs_;
+    GlBuffer buffer_;
+    size_t bufferBytes_;
+
+    unsigned long flushes_;
+    uint64_t submittedDraws_;
+    uint64_t issuedDraws_;
+};
+
+// Test scene of many small, independent copies of the gradient triangle in
+// a grid, each drawn as if it were its own object. Alternate triangles use
+// blended and opaque state (alpha is 1, so the image does not change) to
+// give the batcher runs to sort. Without batching every triangle sets its
+// state and issues its own glDrawArrays from a static buffer. Given a
+// job system, batched triangles are generated into command buffers on its
+// threads each frame, in memory from the frame arena if one is given, and
+// replayed on the GL thread.
+class TriangleField {
+public:
+    TriangleField(int count, bool batching, JobSystem* jobs = nullptr, FrameArena* arena = nullptr);
+
+    void draw(const DrawBatcher::BindBufferFn& bindBuffer);
+
+private:
+    TriangleField(const TriangleField&);
+    TriangleField& operator=(const TriangleField&);
+
+    static void applyState(uint32_t blend);
+
+    uint64_t stateKey(size_t index) const;
+    void writeTriangle(size_t index, float* out) const;
+    void recordRange(CommandBuffer& buffer, size_t begin, size_t end) const;
+
+    size_t count_;
+    int columns_;
+    float cell_;
+    std::vector<float> vertices_;
+    bool batching_;
+    DrawBatcher batcher_;
+    std::unique_ptr<CommandRecorder> recorder_;
+    GlBuffer staticBuffer_;
+};
+
+#endif // DRAW_BATCHER_H
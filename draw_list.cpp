@@ -0,0 +1,98 @@
+#include "draw_list.h"
+
+#include <cstring>
+
+void radixSortByKey(std::vector<KeyIndex>& entries, std::vector<KeyIndex>& scratch) {
+    size_t n = entries.size();
+    if (n < 2)
+        return;
+    scratch.resize(n);
+
+    // One pass over the data builds the histograms of all eight bytes.
+    size_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t key = entries[i].key;
+        for (int b = 0; b < 8; ++b)
+            ++counts[b][(key >> (b * 8)) & 0xff];
+    }
+
+    KeyIndex* src = &entries[0];
+    KeyIndex* dst = &scratch[0];
+    for (int b = 0; b < 8; ++b) {
+        size_t* count = counts[b];
+        // Every key has the same byte here; the pass would not move anything.
+        if (count[(src[0].key >> (b * 8)) & 0xff] == n)
+            continue;
+
+        size_t offset = 0;
+        for (int d = 0; d < 256; ++d) {
+            size_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i)
+            dst[count[(src[i].key >> (b * 8)) & 0xff]++] = src[i];
+
+        KeyIndex* t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != &entries[0])
+        entries.swap(scratch);
+}
+
+void DrawList::clear() {
+    commands_.clear();
+    order_.clear();
+}
+
+void DrawList::add(const DrawCommand& command) {
+    KeyIndex entry = { command.key, static_cast<uint32_t>(commands_.size()) };
+    commands_.push_back(command);
+    order_.push_back(entry);
+}
+
+void DrawList::sort() {
+    radixSortByKey(order_, scratch_);
+}
+
+StateChangeCount DrawList::submit(DrawStateSink& sink) const {
+    StateChangeCount changes = { 0, 0, 0 };
+    uint64_t previous = 0;
+    for (size_t i = 0; i < order_.size(); ++i) {
+        const DrawCommand& command = commands_[order_[i].index];
+        uint64_t key = command.key;
+        bool first = i == 0;
+        if (first || DrawKey::program(key) != DrawKey::program(previous)) {
+            sink.setProgram(DrawKey::program(key));
+            ++changes.program;
+        }
+        if (first || DrawKey::layout(key) != DrawKey::layout(previous)) {
+            sink.setLayout(DrawKey::layout(key));
+            ++changes.layout;
+        }
+        if (first || DrawKey::blend(key) != DrawKey::blend(previous)) {
+            sink.setBlend(DrawKey::blend(key));
+            ++changes.blend;
+        }
+        sink.draw(command);
+        previous = key;
+    }
+    return changes;
+}
+
+StateChangeCount countStateChanges(const std::vector<DrawCommand>& commands) {
+    StateChangeCount changes = { 0, 0, 0 };
+    for (size_t i = 0; i < commands.size(); ++i) {
+        uint64_t key = commands[i].key;
+        uint64_t previous = i ? commands[i - 1].key : 0;
+        if (!i || DrawKey::program(key) != DrawKey::program(previous))
+            ++changes.program;
+        if (!i || DrawKey::layout(key) != DrawKey::layout(previous))
+            ++changes.layout;
+        if (!i || DrawKey::blend(key) != DrawKey::blend(previous))
+            ++changes.blend;
+    }
+    return changes;
+}
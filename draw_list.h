@@ -0,0 +1,115 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Packed 64-bit sort key of a draw. Fields are ordered by how expensive
+// they are to change, most expensive in the high bits, so sorting by key
+// groups draws by program first, then vertex layout, then blend state, and
+// orders them by depth within a group.
+//
+//   63..52  program        (12 bits)
+//   51..40  vertex layout  (12 bits, VAO or client-array layout)
+//   39..36  blend state    (4 bits)
+//   35..12  depth          (24 bits, front to back)
+//   11..0   user bits      (12 bits)
+namespace DrawKey {
+
+const int kProgramShift = 52;
+const int kLayoutShift = 40;
+const int kBlendShift = 36;
+const int kDepthShift = 12;
+
+inline uint64_t make(uint32_t program, uint32_t layout, uint32_t blend, uint32_t depth, uint32_t user = 0) {
+    return (static_cast<uint64_t>(program & 0xfff) << kProgramShift) |
+           (static_cast<uint64_t>(layout & 0xfff) << kLayoutShift) |
+           (static_cast<uint64_t>(blend & 0xf) << kBlendShift) |
+           (static_cast<uint64_t>(depth & 0xffffff) << kDepthShift) |
+           (user & 0xfff);
+}
+
+inline uint32_t program(uint64_t key) { return static_cast<uint32_t>(key >> kProgramShift) & 0xfff; }
+inline uint32_t layout(uint64_t key) { return static_cast<uint32_t>(key >> kLayoutShift) & 0xfff; }
+inline uint32_t blend(uint64_t key) { return static_cast<uint32_t>(key >> kBlendShift) & 0xf; }
+inline uint32_t depth(uint64_t key) { return static_cast<uint32_t>(key >> kDepthShift) & 0xffffff; }
+
+// Quantizes a depth in [0, 1] to the key's depth field.
+inline uint32_t quantizeDepth(float z) {
+    if (z <= 0.0f)
+        return 0;
+    if (z >= 1.0f)
+        return 0xffffff;
+    return static_cast<uint32_t>(z * 16777215.0f);
+}
+
+} // namespace DrawKey
+
+// Sort entry: a key and the index of the item it belongs to.
+struct KeyIndex {
+    uint64_t key;
+    uint32_t index;
+};
+
+// Stable LSD radix sort by key, one byte per pass. Passes over bytes that
+// are identical in every key are skipped, so keys that only use a few
+// fields sort in a few passes. scratch is resized as needed and can be
+// reused between calls to avoid allocating.
+void radixSortByKey(std::vector<KeyIndex>& entries, std::vector<KeyIndex>& scratch);
+
+// One draw call and the state it needs.
+struct DrawCommand {
+    uint64_t key;
+    uint32_t buffer;  // vertex buffer to draw from
+    int32_t first;
+    int32_t count;
+};
+
+// Receives state changes and draws during DrawList::submit().
+class DrawStateSink {
+public:
+    virtual ~DrawStateSink() {}
+    virtual void setProgram(uint32_t program) = 0;
+    virtual void setLayout(uint32_t layout) = 0;
+    virtual void setBlend(uint32_t blend) = 0;
+    virtual void draw(const DrawCommand& command) = 0;
+};
+
+// Number of state changes that submitting commands in the given order
+// causes, counting the initial state of each field.
+struct StateChangeCount {
+    size_t program;
+    size_t layout;
+    size_t blend;
+
+    size_t total() const { return program + layout + blend; }
+};
+
+// Per-frame list of draw commands. Commands are recorded in any order,
+// sorted by key and submitted with redundant state changes filtered out.
+class DrawList {
+public:
+    void clear();
+    void add(const DrawCommand& command);
+    void sort();
+
+    // Forwards the commands in sorted order, only reporting state that
+    // differs from the previous command. Returns the changes it made.
+    StateChangeCount submit(DrawStateSink& sink) const;
+
+    size_t size() const { return commands_.size(); }
+    const DrawCommand& operator[](size_t i) const { return commands_[order_[i].index]; }
+    // Position in recording order of the command at sorted position i.
+    uint32_t recordedIndex(size_t i) const { return order_[i].index; }
+
+private:
+    std::vector<DrawCommand> commands_;
+    std::vector<KeyIndex> order_;
+    std::vector<KeyIndex> scratch_;
+};
+
+// State changes for commands submitted in recording order, for comparison.
+StateChangeCount countStateChanges(const std::vector<DrawCommand>& commands);
+
+#endif // DRAW_LIST_H
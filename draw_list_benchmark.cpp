@@ -0,0 +1,127 @@
+// Measures what sorting a draw list costs against the state changes it
+// saves. Draws are generated in random order over a fixed set of programs,
+// vertex layouts and blend states, then sorted with the radix sort and with
+// std::stable_sort for reference, which must produce the same order. No GL
+// context is needed.
+
+#include "draw_list.h"
+#include "platform_timer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+const uint32_t kPrograms = 16;
+const uint32_t kLayouts = 32;
+const uint32_t kBlendStates = 4;
+const int kRepeats = 5;
+
+// Counts what a GL backend would be asked to do, without doing it.
+class CountingSink : public DrawStateSink {
+public:
+    CountingSink() : draws(0) {}
+    void setProgram(uint32_t) {}
+    void setLayout(uint32_t) {}
+    void setBlend(uint32_t) {}
+    void draw(const DrawCommand&) { ++draws; }
+
+    size_t draws;
+};
+
+std::vector<DrawCommand> makeCommands(size_t count, std::mt19937& rng) {
+    std::uniform_int_distribution<uint32_t> program(0, kPrograms - 1);
+    std::uniform_int_distribution<uint32_t> layout(0, kLayouts - 1);
+    std::uniform_int_distribution<uint32_t> blend(0, kBlendStates - 1);
+    std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+    std::vector<DrawCommand> commands(count);
+    for (size_t i = 0; i < count; ++i) {
+        DrawCommand& command = commands[i];
+        command.key = DrawKey::make(program(rng), layout(rng), blend(rng), DrawKey::quantizeDepth(depth(rng)));
+        command.buffer = static_cast<uint32_t>(i % 64);
+        command.first = 0;
+        command.count = 3;
+    }
+    return commands;
+}
+
+void run(size_t count, std::mt19937& rng) {
+    std::vector<DrawCommand> commands = makeCommands(count, rng);
+    StateChangeCount unsorted = countStateChanges(commands);
+
+    double radixMs = 0.0;
+    double stdMs = 0.0;
+    double submitMs = 0.0;
+    StateChangeCount sorted = { 0, 0, 0 };
+    DrawList list;
+    std::vector<KeyIndex> reference;
+    for (int r = 0; r < kRepeats; ++r) {
+        list.clear();
+        for (size_t i = 0; i < count; ++i)
+            list.add(commands[i]);
+        uint64_t start = monotonicNowNs();
+        list.sort();
+        radixMs += nsToMs(monotonicNowNs() - start);
+
+        CountingSink sink;
+        start = monotonicNowNs();
+        sorted = list.submit(sink);
+        submitMs += nsToMs(monotonicNowNs() - start);
+
+        reference.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            reference[i].key = commands[i].key;
+            reference[i].index = static_cast<uint32_t>(i);
+        }
+        start = monotonicNowNs();
+        std::stable_sort(reference.begin(), reference.end(),
+                         [](const KeyIndex& a, const KeyIndex& b) { return a.key < b.key; });
+        stdMs += nsToMs(monotonicNowNs() - start);
+    }
+
+    for (size_t i = 1; i < list.size(); ++i) {
+        if (list[i - 1].key > list[i].key) {
+            std::cerr << "Draw list is not sorted at " << i << std::endl;
+            exit(1);
+        }
+    }
+    // Both sorts are stable, so they must agree on the order of equal keys.
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (list[i].key != reference[i].key || list.recordedIndex(i) != reference[i].index) {
+            std::cerr << "Radix sort order differs from std::stable_sort at " << i << std::endl;
+            exit(1);
+        }
+    }
+
+    std::cout << std::setw(9) << count
+              << std::setw(12) << unsorted.total()
+              << std::setw(10) << sorted.total()
+              << std::fixed << std::setprecision(3)
+              << std::setw(12) << radixMs / kRepeats
+              << std::setw(12) << stdMs / kRepeats
+              << std::setw(12) << submitMs / kRepeats
+              << std::setw(11) << radixMs * 1e6 / kRepeats / (unsorted.total() - sorted.total())
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::mt19937 rng(1234);
+    std::cout << std::setw(9) << "draws" << std::setw(12) << "unsorted" << std::setw(10) << "sorted"
+              << std::setw(12) << "radix ms" << std::setw(12) << "stable ms" << std::setw(12) << "submit ms"
+              << std::setw(11) << "ns/saved" << std::endl;
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i)
+            run(static_cast<size_t>(strtoul(argv[i], nullptr, 10)), rng);
+        return 0;
+    }
+    static const size_t counts[] = { 10000, 30000, 100000, 300000, 1000000 };
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+        run(counts[i], rng);
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "dynamic_resolution.h"
+#include "async_log.h"
+#include "full_screen_pass.h"
+#include "shader_program.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// Weight of the newest sample in the exponential moving average.
+const double kSmoothing = 0.1;
+// Fraction of the budget within which the scale is left alone.
+const double kDeadband = 0.05;
+// Fraction of the computed correction applied per frame.
+const double kGain = 0.25;
+// Scales are snapped to this step so that the viewport stays stable.
+const double kQuantum = 1.0 / 64.0;
+// How often the chosen scale is written to the log.
+const unsigned long kLogInterval = 120;
+
+#ifdef USE_GLES2
+const char* blitVertexSrc = R"(
+attribute vec2 a_position;
+uniform vec2 u_scale;
+varying vec2 v_texCoord;
+void main() {
+    gl_Position = vec4(a_position, 0.0, 1.0);
+    v_texCoord = (a_position * 0.5 + 0.5) * u_scale;
+}
+)";
+
+const char* blitFragmentSrc = R"(
+precision mediump float;
+uniform sampler2D u_texture;
+varying vec2 v_texCoord;
+void main() {
+    gl_FragColor = texture2D(u_texture, v_texCoord);
+}
+)";
+
+#endif
+
+} // namespace
+
+ResolutionController::ResolutionController(double budgetMs, double minScale, double maxScale)
+    : budgetMs_(budgetMs), minScale_(minScale), maxScale_(maxScale),
+      scale_(maxScale), smoothedMs_(0.0), frames_(0) {
+}
+
+double ResolutionController::update(double frameMs) {
+    if (frameMs <= 0.0)
+        return scale_;
+
+    smoothedMs_ = frames_ == 0 ? frameMs : smoothedMs_ + kSmoothing * (frameMs - smoothedMs_);
+    ++frames_;
+
+    double ratio = budgetMs_ / smoothedMs_;
+    if (std::fabs(1.0 - ratio) > kDeadband) {
+        double target = scale_ * std::sqrt(ratio);
+        double next = scale_ + kGain * (target - scale_);
+        next = std::floor(next / kQuantum + 0.5) * kQuantum;
+        scale_ = std::max(minScale_, std::min(maxScale_, next));
+    }
+
+    if (frames_ % kLogInterval == 0) {
+        LogLine(LogInfo) << "Dynamic resolution: scale " << scale_
+                         << ", frame " << smoothedMs_ << " ms (budget " << budgetMs_ << " ms)";
+    }
+    return scale_;
+}
+
+ScaledRenderTarget::ScaledRenderTarget()
+    : width_(0), height_(0), renderWidth_(0), renderHeight_(0)
+#ifdef USE_GLES2
+      , blitPositionLoc_(-1), blitScaleLoc_(-1), blitTextureLoc_(-1)
+#endif
+{
+}
+
+ScaledRenderTarget::~ScaledRenderTarget() {
+    destroy();
+}
+
+bool ScaledRenderTarget::create(int width, int height) {
+    destroy();
+    width_ = width;
+    height_ = height;
+    renderWidth_ = width;
+    renderHeight_ = height;
+
+    texture_ = GlTexture::generate();
+    glBindTexture(GL_TEXTURE_2D, texture_.get());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+#ifdef USE_GLES2
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+#else
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+#endif
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    framebuffer_ = GlFramebuffer::generate();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.get());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_.get(), 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        char code[16];
+        snprintf(code, sizeof(code), "0x%04X", status);
+        LogLine(LogError) << "Scaled render target incomplete: " << code;
+        destroy();
+        return false;
+    }
+
+#ifdef USE_GLES2
+    blitProgram_.reset(createProgram(blitVertexSrc, blitFragmentSrc));
+    if (!blitProgram_) {
+        destroy();
+        return false;
+    }
+    blitPositionLoc_ = glGetAttribLocation(blitProgram_.get(), "a_position");
+    blitScaleLoc_ = glGetUniformLocation(blitProgram_.get(), "u_scale");
+    blitTextureLoc_ = glGetUniformLocation(blitProgram_.get(), "u_texture");
+#endif
+    return true;
+}
+
+void ScaledRenderTarget::destroy() {
+    framebuffer_.reset();
+    texture_.reset();
+#ifdef USE_GLES2
+    blitProgram_.reset();
+#endif
+}
+
+void ScaledRenderTarget::begin(double scale) {
+    renderWidth_ = std::max(1, static_cast<int>(width_ * scale + 0.5));
+    renderHeight_ = std::max(1, static_cast<int>(height_ * scale + 0.5));
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.get());
+    glViewport(0, 0, renderWidth_, renderHeight_);
+}
+
+void ScaledRenderTarget::present() {
+#ifdef USE_GLES2
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width_, height_);
+
+    glUseProgram(blitProgram_.get());
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture_.get());
+    glUniform1i(blitTextureLoc_, 0);
+    glUniform2f(blitScaleLoc_,
+                static_cast<GLfloat>(renderWidth_) / width_,
+                static_cast<GLfloat>(renderHeight_) / height_);
+
+    PassVertexLayout::bind(&blitPositionLoc_, fullScreenTriangle);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    PassVertexLayout::disable(&blitPositionLoc_);
+    glBindTexture(GL_TEXTURE_2D, 0);
+#else
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_.get());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, renderWidth_, renderHeight_,
+                      0, 0, width_, height_,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width_, height_);
+#endif
+}
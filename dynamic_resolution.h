@@ -0,0 +1,72 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include "gl_handle.h"
+#include "gl_platform.h"
+
+// Feedback controller that picks a render scale so that the frame cost
+// stays within a time budget. Pixel cost grows with the square of the
+// scale, so corrections are made on the square root of the budget ratio.
+// Measurements are smoothed and small errors ignored so that the scale
+// does not oscillate from frame to frame.
+class ResolutionController {
+public:
+    ResolutionController(double budgetMs, double minScale = 0.5, double maxScale = 1.0);
+
+    // Feeds the cost of a finished frame and returns the scale to use next.
+    double update(double frameMs);
+
+    double scale() const { return scale_; }
+    double smoothedMs() const { return smoothedMs_; }
+    double budgetMs() const { return budgetMs_; }
+
+private:
+    double budgetMs_;
+    double minScale_;
+    double maxScale_;
+    double scale_;
+    double smoothedMs_;
+    unsigned long frames_;
+};
+
+// Offscreen colour target rendered at a fraction of the output size and
+// upscaled to the default framebuffer. The texture is allocated once at the
+// full output size and each frame only renders into its lower-left corner,
+// so changing the scale never reallocates. The upscale is a single
+// glBlitFramebuffer on desktop GL and a full-screen textured pass on GLES2.
+class ScaledRenderTarget {
+public:
+    ScaledRenderTarget();
+    ~ScaledRenderTarget();
+
+    bool create(int width, int height);
+    void destroy();
+
+    // Binds the offscreen target and sets the viewport to the scaled size.
+    void begin(double scale);
+
+    // Upscales the rendered region into the default framebuffer.
+    void present();
+
+    int renderWidth() const { return renderWidth_; }
+    int renderHeight() const { return renderHeight_; }
+
+private:
+    ScaledRenderTarget(const ScaledRenderTarget&);
+    ScaledRenderTarget& operator=(const ScaledRenderTarget&);
+
+    int width_;
+    int height_;
+    int renderWidth_;
+    int renderHeight_;
+    GlFramebuffer framebuffer_;
+    GlTexture texture_;
+#ifdef USE_GLES2
+    GlProgram blitProgram_;
+    GLint blitPositionLoc_;
+    GLint blitScaleLoc_;
+    GLint blitTextureLoc_;
+#endif
+};
+
+#endif // DYNAMIC_RESOLUTION_H
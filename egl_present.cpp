@@ -0,0 +1,87 @@
+#include "egl_present.h"
+
+#include <cstring>
+#include <iostream>
+
+#ifndef EGL_BUFFER_AGE_EXT
+#define EGL_BUFFER_AGE_EXT 0x313D
+#endif
+
+namespace {
+
+bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions)
+        return false;
+    size_t len = strlen(name);
+    const char* p = extensions;
+    while ((p = strstr(p, name)) != nullptr) {
+        bool startOk = p == extensions || p[-1] == ' ';
+        bool endOk = p[len] == ' ' || p[len] == '\0';
+        if (startOk && endOk)
+            return true;
+        p += len;
+    }
+    return false;
+}
+
+} // namespace
+
+EglPresenter::EglPresenter(EGLDisplay display, EGLSurface surface)
+    : display_(display), surface_(surface),
+      swapBuffersWithDamage_(nullptr), setDamageRegion_(nullptr), bufferAge_(false) {
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+
+    if (hasExtension(extensions, "EGL_KHR_swap_buffers_with_damage")) {
+        swapBuffersWithDamage_ = reinterpret_cast<SwapWithDamageProc>(
+            eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
+    } else if (hasExtension(extensions, "EGL_EXT_swap_buffers_with_damage")) {
+        swapBuffersWithDamage_ = reinterpret_cast<SwapWithDamageProc>(
+            eglGetProcAddress("eglSwapBuffersWithDamageEXT"));
+    }
+    if (hasExtension(extensions, "EGL_KHR_partial_update")) {
+        setDamageRegion_ = reinterpret_cast<SetDamageRegionProc>(
+            eglGetProcAddress("eglSetDamageRegionKHR"));
+    }
+    // EGL_KHR_partial_update also defines the buffer age query.
+    bufferAge_ = setDamageRegion_ != nullptr ||
+                 hasExtension(extensions, "EGL_EXT_buffer_age");
+
+    std::cout << "Damage presentation: swap_with_damage=" << (swapBuffersWithDamage_ ? "yes" : "no")
+              << " partial_update=" << (setDamageRegion_ ? "yes" : "no")
+              << " buffer_age=" << (bufferAge_ ? "yes" : "no") << std::endl;
+}
+
+int EglPresenter::bufferAge() const {
+    if (!bufferAge_)
+        return 0;
+    EGLint age = 0;
+    if (!eglQuerySurface(display_, surface_, EGL_BUFFER_AGE_EXT, &age))
+        return 0;
+    return age;
+}
+
+void EglPresenter::setDamageRegion(const std::vector<DamageRect>& rects) {
+    if (!setDamageRegion_)
+        return;
+    flatten(rects);
+    setDamageRegion_(display_, surface_, flat_.empty() ? nullptr : &flat_[0],
+                     static_cast<EGLint>(rects.size()));
+}
+
+bool EglPresenter::swap(const std::vector<DamageRect>& rects) {
+    if (!swapBuffersWithDamage_ || rects.empty())
+        return eglSwapBuffers(display_, surface_) == EGL_TRUE;
+    flatten(rects);
+    return swapBuffersWithDamage_(display_, surface_, &flat_[0],
+                                  static_cast<EGLint>(rects.size())) == EGL_TRUE;
+}
+
+void EglPresenter::flatten(const std::vector<DamageRect>& rects) {
+    flat_.resize(rects.size() * 4);
+    for (size_t i = 0; i < rects.size(); ++i) {
+        flat_[i * 4 + 0] = rects[i].x;
+        flat_[i * 4 + 1] = rects[i].y;
+        flat_[i * 4 + 2] = rects[i].width;
+        flat_[i * 4 + 3] = rects[i].height;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef EGL_PRESENT_H
+#define EGL_PRESENT_H
+
+#include "damage_tracker.h"
+#include "gl_platform.h"
+
+#include <vector>
+
+// Presents an EGL window surface using whatever damage extensions the
+// driver offers:
+//  - EGL_KHR_partial_update lets the driver skip resolving undamaged tiles,
+//    so the damage region has to be set before rendering starts.
+//  - EGL_KHR/EXT_swap_buffers_with_damage lets the compositor and display
+//    controller update only the damaged rectangles.
+//  - EGL_EXT_buffer_age tells us how stale the back buffer is, so only the
+//    damaged part has to be repainted.
+// Without any of them it falls back to a plain eglSwapBuffers.
+class EglPresenter {
+public:
+    EglPresenter(EGLDisplay display, EGLSurface surface);
+
+    // Age of the current back buffer, or 0 if its contents are unknown.
+    int bufferAge() const;
+
+    // Declares the region that this frame will repaint. Must be called
+    // before the first draw of the frame.
+    void setDamageRegion(const std::vector<DamageRect>& rects);
+
+    // Presents the frame, reporting the given rects as damaged.
+    bool swap(const std::vector<DamageRect>& rects);
+
+    bool hasSwapWithDamage() const { return swapBuffersWithDamage_ != nullptr; }
+    bool hasPartialUpdate() const { return setDamageRegion_ != nullptr; }
+    bool hasBufferAge() const { return bufferAge_; }
+
+private:
+    typedef EGLBoolean (EGLAPIENTRYP SwapWithDamageProc)(EGLDisplay, EGLSurface, EGLint*, EGLint);
+    typedef EGLBoolean (EGLAPIENTRYP SetDamageRegionProc)(EGLDisplay, EGLSurface, EGLint*, EGLint);
+
+    void flatten(const std::vector<DamageRect>& rects);
+
+    EGLDisplay display_;
+    EGLSurface surface_;
+    SwapWithDamageProc swapBuffersWithDamage_;
+    SetDamageRegionProc setDamageRegion_;
+    bool bufferAge_;
+    std::vector<EGLint> flat_;
+};
+
+#endif // EGL_PRESENT_H
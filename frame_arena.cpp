@@ -0,0 +1,54 @@
+#include "frame_arena.h"
+#include "async_log.h"
+
+#include <cstdlib>
+
+namespace {
+
+// How often the high-water mark is logged, in frames.
+const unsigned long kLogInterval = 300;
+
+} // namespace
+
+FrameArena::FrameArena(size_t capacityBytes)
+    : base_(nullptr), capacity_(capacityBytes), offset_(0), overflows_(0),
+      frames_(0), highWater_(0) {
+    void* storage = nullptr;
+    if (capacity_ > 0 && posix_memalign(&storage, 64, capacity_) == 0)
+        base_ = static_cast<char*>(storage);
+    else
+        capacity_ = 0;
+}
+
+FrameArena::~FrameArena() {
+    free(base_);
+}
+
+void* FrameArena::allocate(size_t bytes, size_t align) {
+    size_t offset = offset_.load(std::memory_order_relaxed);
+    while (true) {
+        size_t start = (offset + align - 1) & ~(align - 1);
+        if (start + bytes > capacity_ || start + bytes < start) {
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        if (offset_.compare_exchange_weak(offset, start + bytes, std::memory_order_relaxed))
+            return base_ + start;
+    }
+}
+
+void FrameArena::reset() {
+    size_t used = offset_.exchange(0, std::memory_order_relaxed);
+    if (used > highWater_)
+        highWater_ = used;
+    if (++frames_ % kLogInterval == 0)
+        logStats();
+}
+
+void FrameArena::logStats() {
+    unsigned long overflows = overflows_.exchange(0, std::memory_order_relaxed);
+    LogLine line(LogInfo);
+    line << "Frame arena: " << highWater_ / 1024 << " of " << capacity_ / 1024 << " KB used at peak";
+    if (overflows)
+        line << ", " << overflows << " allocations did not fit";
+}
@@ -0,0 +1,51 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Linear allocator for memory that only lives until the frame is
+// presented. Allocation bumps an offset into one block reserved up front,
+// so it never touches the heap and is safe from any thread. Nothing is
+// freed individually; reset() after the swap releases everything at once.
+//
+// When the block runs out, allocate() returns nullptr and the caller falls
+// back to its own storage. Overflows and the high-water mark are logged so
+// the capacity can be sized for the workload.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacityBytes);
+    ~FrameArena();
+
+    // Returns bytes of storage aligned to align (a power of two), or
+    // nullptr when the arena is full.
+    void* allocate(size_t bytes, size_t align = 16);
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Releases every allocation. Only call while no thread is allocating,
+    // i.e. after the frame's jobs have been waited on.
+    void reset();
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    FrameArena(const FrameArena&);
+    FrameArena& operator=(const FrameArena&);
+
+    void logStats();
+
+    char* base_;
+    size_t capacity_;
+    std::atomic<size_t> offset_;
+    std::atomic<unsigned long> overflows_;
+
+    unsigned long frames_;
+    size_t highWater_;
+};
+
+#endif // FRAME_ARENA_H
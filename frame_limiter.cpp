@@ -0,0 +1,123 @@
+#include "frame_limiter.h"
+#include "async_log.h"
+#include "platform_timer.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// How often the wait statistics are logged, in frames.
+const unsigned long kLogInterval = 300;
+
+} // namespace
+
+const int FrameLimiter::kMaxFramesInFlight;
+
+FrameLimiter::FrameLimiter(int maxFramesInFlight)
+    : maxFrames_(maxFramesInFlight), active_(false), head_(0), count_(0),
+#ifdef USE_GLES2
+      display_(eglGetCurrentDisplay()), createSync_(nullptr), destroySync_(nullptr),
+      clientWaitSync_(nullptr),
+#endif
+      frames_(0), stalledFrames_(0), totalWaitNs_(0), maxWaitNs_(0) {
+    if (maxFrames_ < 1)
+        return;
+    if (maxFrames_ > kMaxFramesInFlight)
+        maxFrames_ = kMaxFramesInFlight;
+
+#ifdef USE_GLES2
+    const char* extensions = eglQueryString(display_, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_fence_sync")) {
+        std::cerr << "EGL_KHR_fence_sync unavailable, frames in flight are not limited" << std::endl;
+        return;
+    }
+    createSync_ = reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"));
+    destroySync_ = reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"));
+    clientWaitSync_ = reinterpret_cast<PFNEGLCLIENTWAITSYNCKHRPROC>(eglGetProcAddress("eglClientWaitSyncKHR"));
+    if (!createSync_ || !destroySync_ || !clientWaitSync_)
+        return;
+#endif
+    active_ = true;
+    std::cout << "Limiting to " << maxFrames_ << " frame(s) in flight" << std::endl;
+}
+
+FrameLimiter::~FrameLimiter() {
+    while (count_ > 0) {
+        deleteFence(fences_[head_]);
+        head_ = (head_ + 1) % kMaxFramesInFlight;
+        --count_;
+    }
+}
+
+void FrameLimiter::waitForSlot() {
+    if (!active_)
+        return;
+
+    uint64_t waitedNs = 0;
+    while (count_ >= maxFrames_) {
+        uint64_t start = monotonicNowNs();
+        clientWait(fences_[head_]);
+        waitedNs += monotonicNowNs() - start;
+        deleteFence(fences_[head_]);
+        head_ = (head_ + 1) % kMaxFramesInFlight;
+        --count_;
+    }
+
+    ++frames_;
+    if (waitedNs > 0) {
+        ++stalledFrames_;
+        totalWaitNs_ += waitedNs;
+        if (waitedNs > maxWaitNs_)
+            maxWaitNs_ = waitedNs;
+    }
+    if (frames_ % kLogInterval == 0)
+        logStats();
+}
+
+void FrameLimiter::frameSubmitted() {
+    if (!active_ || count_ >= kMaxFramesInFlight)
+        return;
+    int slot = (head_ + count_) % kMaxFramesInFlight;
+#ifdef USE_GLES2
+    fences_[slot] = createSync_(display_, EGL_SYNC_FENCE_KHR, nullptr);
+    if (fences_[slot] == EGL_NO_SYNC_KHR)
+        return;
+#else
+    fences_[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (!fences_[slot])
+        return;
+#endif
+    ++count_;
+}
+
+void FrameLimiter::clientWait(Fence fence) {
+    // The first wait flushes so that the fence is guaranteed to signal.
+#ifdef USE_GLES2
+    clientWaitSync_(display_, fence, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, EGL_FOREVER_KHR);
+#else
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    const GLuint64 timeoutNs = 100000000ull;
+    while (true) {
+        GLenum result = glClientWaitSync(fence, flags, timeoutNs);
+        if (result != GL_TIMEOUT_EXPIRED)
+            break;
+        flags = 0;
+    }
+#endif
+}
+
+void FrameLimiter::deleteFence(Fence fence) {
+#ifdef USE_GLES2
+    destroySync_(display_, fence);
+#else
+    glDeleteSync(fence);
+#endif
+}
+
+void FrameLimiter::logStats() {
+    double meanMs = stalledFrames_ ? nsToMs(totalWaitNs_) / frames_ : 0.0;
+    LogLine(LogInfo) << "Frames in flight (max " << maxFrames_ << "): CPU waited on GPU in "
+                     << stalledFrames_ << "/" << frames_ << " frames, mean " << meanMs
+                     << " ms/frame, max " << nsToMs(maxWaitNs_) << " ms";
+}
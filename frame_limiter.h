@@ -0,0 +1,64 @@
+#ifndef FRAME_LIMITER_H
+#define FRAME_LIMITER_H
+
+#include "gl_platform.h"
+
+#include <stdint.h>
+
+// Bounds how many frames the CPU may queue ahead of the GPU. A fence is
+// inserted after each swap; before starting a new frame the CPU waits for
+// the fence of the frame submitted maxFramesInFlight frames ago. A limit of
+// 1 gives the lowest input latency, higher limits trade latency for
+// CPU/GPU overlap.
+//
+// Desktop GL uses core glFenceSync/glClientWaitSync. GLES2 has no fences in
+// core, so the EGL build uses EGL_KHR_fence_sync; without it the limiter
+// stays inactive.
+class FrameLimiter {
+public:
+    static const int kMaxFramesInFlight = 3;
+
+    explicit FrameLimiter(int maxFramesInFlight);
+    ~FrameLimiter();
+
+    bool active() const { return active_; }
+
+    // Blocks until fewer than maxFramesInFlight frames are queued.
+    void waitForSlot();
+
+    // Marks the end of a frame's commands; call right after the swap.
+    void frameSubmitted();
+
+private:
+    FrameLimiter(const FrameLimiter&);
+    FrameLimiter& operator=(const FrameLimiter&);
+
+#ifdef USE_GLES2
+    typedef EGLSyncKHR Fence;
+#else
+    typedef GLsync Fence;
+#endif
+
+    void clientWait(Fence fence);
+    void deleteFence(Fence fence);
+    void logStats();
+
+    int maxFrames_;
+    bool active_;
+    Fence fences_[kMaxFramesInFlight];
+    int head_;   // slot of the oldest fence
+    int count_;  // fences currently pending
+#ifdef USE_GLES2
+    EGLDisplay display_;
+    PFNEGLCREATESYNCKHRPROC createSync_;
+    PFNEGLDESTROYSYNCKHRPROC destroySync_;
+    PFNEGLCLIENTWAITSYNCKHRPROC clientWaitSync_;
+#endif
+
+    unsigned long frames_;
+    unsigned long stalledFrames_;
+    uint64_t totalWaitNs_;
+    uint64_t maxWaitNs_;
+};
+
+#endif // FRAME_LIMITER_H
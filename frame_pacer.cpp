@@ -0,0 +1,97 @@
+#include "frame_pacer.h"
+#include "async_log.h"
+#include "platform_timer.h"
+
+#include <cmath>
+
+namespace {
+
+// How often the statistics are logged, in seconds of paced frames.
+const double kLogSeconds = 5.0;
+
+} // namespace
+
+PacingStats::PacingStats() {
+    reset();
+}
+
+void PacingStats::reset() {
+    frames = 0;
+    missed = 0;
+    meanJitterMs = 0.0;
+    maxJitterMs = 0.0;
+    meanIntervalMs = 0.0;
+    intervalStdDevMs = 0.0;
+    intervals_ = 0;
+    intervalM2_ = 0.0;
+}
+
+void PacingStats::add(double jitterMs, double intervalMs, bool haveInterval) {
+    ++frames;
+    meanJitterMs += (jitterMs - meanJitterMs) / frames;
+    if (jitterMs > maxJitterMs)
+        maxJitterMs = jitterMs;
+
+    if (haveInterval) {
+        ++intervals_;
+        double delta = intervalMs - meanIntervalMs;
+        meanIntervalMs += delta / intervals_;
+        intervalM2_ += delta * (intervalMs - meanIntervalMs);
+        intervalStdDevMs = intervals_ > 1 ? std::sqrt(intervalM2_ / (intervals_ - 1)) : 0.0;
+    }
+}
+
+FramePacer::FramePacer(double targetHz)
+    : targetHz_(targetHz),
+      periodNs_(static_cast<uint64_t>(1.0e9 / targetHz)),
+      deadlineNs_(0), lastWakeNs_(0),
+      minMarginNs_(sleepGranularityNs()), marginNs_(minMarginNs_),
+      logInterval_(static_cast<unsigned long>(targetHz * kLogSeconds)) {
+    if (logInterval_ == 0)
+        logInterval_ = 1;
+}
+
+void FramePacer::wait() {
+    uint64_t now = monotonicNowNs();
+    if (deadlineNs_ == 0 || now > deadlineNs_ + periodNs_) {
+        if (deadlineNs_ != 0)
+            ++stats_.missed;
+        deadlineNs_ = now;
+    }
+
+    // Coarse sleep up to the margin, then spin the rest of the way.
+    if (deadlineNs_ > now + marginNs_) {
+        uint64_t sleepUntil = deadlineNs_ - marginNs_;
+        sleepForNs(sleepUntil - now);
+        now = monotonicNowNs();
+        uint64_t oversleep = now > sleepUntil ? now - sleepUntil : 0;
+        if (oversleep > marginNs_) {
+            // Woke up too late to spin; widen the margin quickly.
+            marginNs_ = oversleep + oversleep / 4;
+        } else if (marginNs_ > minMarginNs_) {
+            // Slowly reclaim CPU time when the sleeps are accurate.
+            marginNs_ -= (marginNs_ - minMarginNs_) / 64 + 1;
+        }
+    }
+    while (now < deadlineNs_) {
+        cpuRelax();
+        now = monotonicNowNs();
+    }
+
+    double jitterMs = nsToMs(now - deadlineNs_);
+    bool haveInterval = lastWakeNs_ != 0;
+    stats_.add(jitterMs, haveInterval ? nsToMs(now - lastWakeNs_) : 0.0, haveInterval);
+    lastWakeNs_ = now;
+    deadlineNs_ += periodNs_;
+
+    if (stats_.frames % logInterval_ == 0)
+        logStats();
+}
+
+void FramePacer::logStats() {
+    LogLine(LogInfo) << "Frame pacing @" << targetHz_ << " Hz: interval " << stats_.meanIntervalMs
+                     << " ms (stddev " << stats_.intervalStdDevMs << " ms), jitter mean "
+                     << stats_.meanJitterMs << " ms max " << stats_.maxJitterMs << " ms, missed "
+                     << stats_.missed << "/" << stats_.frames
+                     << ", spin margin " << nsToMs(marginNs_) << " ms";
+}
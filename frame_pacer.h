@@ -0,0 +1,55 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdint.h>
+
+// Deviation of frame wake-ups from their scheduled deadlines.
+struct PacingStats {
+    PacingStats();
+
+    unsigned long frames;
+    unsigned long missed;   // frames more than a full period late
+    double meanJitterMs;    // mean of |wake - deadline|
+    double maxJitterMs;
+    double meanIntervalMs;  // mean wake-to-wake interval
+    double intervalStdDevMs;
+
+    void reset();
+    void add(double jitterMs, double intervalMs, bool haveInterval);
+
+private:
+    unsigned long intervals_;
+    double intervalM2_;  // running sum of squared deviations (Welford)
+};
+
+// Paces frames to a fixed rate without relying on vsync. Each wait sleeps
+// until shortly before the deadline and spins on the monotonic clock for
+// the remainder, so accuracy is not limited by the sleep granularity. The
+// spin margin adapts to the oversleep actually observed.
+//
+// Deadlines advance by exactly one period, so short hiccups are absorbed;
+// after falling more than a period behind the schedule is restarted.
+class FramePacer {
+public:
+    explicit FramePacer(double targetHz);
+
+    // Blocks until the deadline of the next frame.
+    void wait();
+
+    double targetHz() const { return targetHz_; }
+    const PacingStats& stats() const { return stats_; }
+
+private:
+    void logStats();
+
+    double targetHz_;
+    uint64_t periodNs_;
+    uint64_t deadlineNs_;
+    uint64_t lastWakeNs_;
+    uint64_t minMarginNs_;
+    uint64_t marginNs_;
+    unsigned long logInterval_;
+    PacingStats stats_;
+};
+
+#endif // FRAME_PACER_H
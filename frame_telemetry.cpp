@@ -0,0 +1,237 @@
+#include "frame_telemetry.h"
+#include "async_log.h"
+#include "platform_timer.h"
+
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstring>
+#include <netdb.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Times are recorded in microseconds up to a minute, to 1% precision.
+const uint64_t kHighestUs = 60000000ull;
+const int kSignificantDigits = 2;
+
+// How often the exporter checks for a new snapshot.
+const uint64_t kExporterPollNs = 50000000ull;
+
+// A snapshot of three summaries is a few KB of text.
+const size_t kExportBytes = 8192;
+
+const double kQuantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+// Appends printf-style text to a fixed buffer, silently truncating.
+class TextBuffer {
+public:
+    TextBuffer() : length_(0) { text_[0] = '\0'; }
+
+    void append(const char* fmt, ...) {
+        if (length_ >= kExportBytes - 1)
+            return;
+        va_list args;
+        va_start(args, fmt);
+        int written = vsnprintf(text_ + length_, kExportBytes - length_, fmt, args);
+        va_end(args);
+        if (written > 0)
+            length_ += static_cast<size_t>(written);
+        if (length_ > kExportBytes - 1)
+            length_ = kExportBytes - 1;
+    }
+
+    const char* data() const { return text_; }
+    size_t size() const { return length_; }
+
+private:
+    char text_[kExportBytes];
+    size_t length_;
+};
+
+void appendSummary(TextBuffer& out, const char* name, const char* help,
+                   const HdrHistogram& interval, const HdrHistogram& total) {
+    out.append("# HELP %s %s\n# TYPE %s summary\n", name, help, name);
+    for (size_t i = 0; i < sizeof(kQuantiles) / sizeof(kQuantiles[0]); ++i) {
+        if (interval.count())
+            out.append("%s{quantile=\"%g\"} %.6f\n", name, kQuantiles[i],
+                       interval.valueAtPercentile(kQuantiles[i] * 100.0) / 1e6);
+        else
+            out.append("%s{quantile=\"%g\"} NaN\n", name, kQuantiles[i]);
+    }
+    out.append("%s_sum %.6f\n", name, total.mean() * total.count() / 1e6);
+    out.append("%s_count %llu\n", name, static_cast<unsigned long long>(total.count()));
+    out.append("# HELP %s_max Largest value in the last interval.\n# TYPE %s_max gauge\n", name, name);
+    out.append("%s_max %.6f\n", name, interval.max() / 1e6);
+}
+
+} // namespace
+
+FrameTelemetry::Snapshot::Snapshot()
+    : frame(kHighestUs, kSignificantDigits),
+      gpu(kHighestUs, kSignificantDigits),
+      swap(kHighestUs, kSignificantDigits),
+      startNs(0), endNs(0) {
+}
+
+FrameTelemetry::FrameTelemetry(const std::string& sink, double intervalSeconds)
+    : sinkType_(NoSink), socket_(-1), intervalNs_(static_cast<uint64_t>((intervalSeconds > 0.0 ? intervalSeconds : 10.0) * 1e9)),
+      active_(0), pending_(-1), stopping_(false) {
+    snapshots_[0].startNs = monotonicNowNs();
+    if (sink.empty())
+        return;
+    if (!openSink(sink)) {
+        LogLine(LogError) << "Telemetry sink unusable: " << sink.c_str();
+        return;
+    }
+    if (!exporter_.start("tTelemetry", exporterMain, this, -1, PlatformThread::LowPriority)) {
+        LogLine(LogError) << "Failed to start the telemetry exporter";
+        sinkType_ = NoSink;
+        return;
+    }
+    LogLine(LogInfo) << "Exporting frame telemetry to " << sink.c_str() << " every "
+                     << intervalNs_ / 1e9 << " s";
+}
+
+FrameTelemetry::~FrameTelemetry() {
+    stopping_.store(true);
+    exporter_.join();
+    if (sinkType_ != NoSink) {
+        // The exporter is gone; export what it left and the interval in
+        // progress from here.
+        int index = pending_.load(std::memory_order_acquire);
+        if (index >= 0)
+            exportSnapshot(snapshots_[index]);
+        Snapshot& last = snapshots_[active_];
+        last.endNs = monotonicNowNs();
+        exportSnapshot(last);
+    }
+    if (socket_ >= 0)
+        close(socket_);
+}
+
+bool FrameTelemetry::openSink(const std::string& sink) {
+    if (sink.compare(0, 5, "file:") == 0) {
+        filePath_ = sink.substr(5);
+        scratchPath_ = filePath_ + ".tmp";
+        sinkType_ = FileSink;
+        return !filePath_.empty();
+    }
+    if (sink.compare(0, 4, "udp:") == 0) {
+        std::string address = sink.substr(4);
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos)
+            return false;
+        std::string host = address.substr(0, colon);
+        std::string port = address.substr(colon + 1);
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo* result = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result)
+            return false;
+        socket_ = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+        // A connected datagram socket lets the exporter use plain send().
+        if (socket_ >= 0 && connect(socket_, result->ai_addr, result->ai_addrlen) != 0) {
+            close(socket_);
+            socket_ = -1;
+        }
+        freeaddrinfo(result);
+        sinkType_ = socket_ >= 0 ? SocketSink : NoSink;
+        return socket_ >= 0;
+    }
+    if (sink.compare(0, 5, "unix:") == 0) {
+        std::string path = sink.substr(5);
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path))
+            return false;
+        memcpy(address.sun_path, path.c_str(), path.size());
+        socket_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (socket_ >= 0 && connect(socket_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+            close(socket_);
+            socket_ = -1;
+        }
+        sinkType_ = socket_ >= 0 ? SocketSink : NoSink;
+        return socket_ >= 0;
+    }
+    return false;
+}
+
+void FrameTelemetry::recordGpuMs(double ms) {
+    snapshots_[active_].gpu.record(static_cast<uint64_t>(ms * 1000.0 + 0.5));
+}
+
+void FrameTelemetry::framePresented(uint64_t frameStartNs, uint64_t swapStartNs, uint64_t swapEndNs) {
+    Snapshot& snapshot = snapshots_[active_];
+    snapshot.frame.record((swapEndNs - frameStartNs) / 1000);
+    snapshot.swap.record((swapEndNs - swapStartNs) / 1000);
+    tick(swapEndNs);
+}
+
+void FrameTelemetry::tick(uint64_t nowNs) {
+    Snapshot& snapshot = snapshots_[active_];
+    if (sinkType_ == NoSink || nowNs - snapshot.startNs < intervalNs_)
+        return;
+    // If the exporter is still busy, keep extending this interval.
+    if (pending_.load(std::memory_order_acquire) != -1)
+        return;
+    snapshot.endNs = nowNs;
+    pending_.store(active_, std::memory_order_release);
+    active_ ^= 1;
+    Snapshot& next = snapshots_[active_];
+    next.frame.reset();
+    next.gpu.reset();
+    next.swap.reset();
+    next.startNs = nowNs;
+}
+
+void FrameTelemetry::exporterMain(void* self) {
+    FrameTelemetry& telemetry = *static_cast<FrameTelemetry*>(self);
+    while (!telemetry.stopping_.load()) {
+        int index = telemetry.pending_.load(std::memory_order_acquire);
+        if (index < 0) {
+            sleepForNs(kExporterPollNs);
+            continue;
+        }
+        telemetry.exportSnapshot(telemetry.snapshots_[index]);
+        telemetry.pending_.store(-1, std::memory_order_release);
+    }
+}
+
+void FrameTelemetry::exportSnapshot(const Snapshot& snapshot) {
+    totals_.frame.add(snapshot.frame);
+    totals_.gpu.add(snapshot.gpu);
+    totals_.swap.add(snapshot.swap);
+
+    TextBuffer text;
+    appendSummary(text, "render_frame_seconds",
+                  "CPU time from the start of a frame until its swap returned.",
+                  snapshot.frame, totals_.frame);
+    appendSummary(text, "render_gpu_seconds", "GPU execution time of a frame.",
+                  snapshot.gpu, totals_.gpu);
+    appendSummary(text, "render_swap_seconds", "Time spent in the buffer swap call.",
+                  snapshot.swap, totals_.swap);
+    text.append("# HELP render_telemetry_interval_seconds Length of the interval the quantiles cover.\n"
+                "# TYPE render_telemetry_interval_seconds gauge\n"
+                "render_telemetry_interval_seconds %.3f\n",
+                (snapshot.endNs - snapshot.startNs) / 1e9);
+
+    if (sinkType_ == FileSink) {
+        // Readers only ever see a complete snapshot.
+        FILE* file = fopen(scratchPath_.c_str(), "w");
+        if (!file)
+            return;
+        bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+        written = fclose(file) == 0 && written;
+        if (written)
+            rename(scratchPath_.c_str(), filePath_.c_str());
+        return;
+    }
+    // Nobody listening is not an error worth reporting every interval.
+    send(socket_, text.data(), text.size(), 0);
+}
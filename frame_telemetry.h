@@ -0,0 +1,86 @@
+#ifndef FRAME_TELEMETRY_H
+#define FRAME_TELEMETRY_H
+
+#include "hdr_histogram.h"
+#include "platform_thread.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+// Always-on frame health telemetry. The render loop records frame, GPU
+// and swap times into HDR histograms, which costs an increment per value
+// and never allocates. Every interval the histograms are handed to a
+// low-priority exporter thread, which writes them in Prometheus text
+// exposition format to the configured sink:
+//
+//   file:PATH        rewritten atomically, e.g. for node_exporter's
+//                    textfile collector
+//   udp:HOST:PORT    one datagram per snapshot
+//   unix:PATH        one datagram per snapshot to a Unix datagram socket
+//
+// Each metric is exported as a summary: quantiles and max over the last
+// interval, so short stutters stay visible, and cumulative _sum and _count.
+// The last, partial interval is exported on destruction.
+class FrameTelemetry {
+public:
+    // Without a sink the histograms are still recorded, but not exported.
+    FrameTelemetry(const std::string& sink, double intervalSeconds);
+    ~FrameTelemetry();
+
+    bool exporting() const { return sinkType_ != NoSink; }
+
+    // Render thread only.
+    void recordGpuMs(double ms);
+    // Records a presented frame that started at frameStartNs and whose
+    // swap call ran from swapStartNs to swapEndNs.
+    void framePresented(uint64_t frameStartNs, uint64_t swapStartNs, uint64_t swapEndNs);
+    // Hands the interval to the exporter once it is over. framePresented()
+    // does this too; call it from idle iterations so that a static display
+    // keeps exporting.
+    void tick(uint64_t nowNs);
+
+private:
+    FrameTelemetry(const FrameTelemetry&);
+    FrameTelemetry& operator=(const FrameTelemetry&);
+
+    struct Snapshot {
+        Snapshot();
+
+        HdrHistogram frame;
+        HdrHistogram gpu;
+        HdrHistogram swap;
+        uint64_t startNs;
+        uint64_t endNs;
+    };
+
+    enum SinkType {
+        NoSink,
+        FileSink,
+        SocketSink
+    };
+
+    bool openSink(const std::string& sink);
+    static void exporterMain(void* self);
+    void exportSnapshot(const Snapshot& snapshot);
+
+    SinkType sinkType_;
+    int socket_;
+    std::string filePath_;
+    std::string scratchPath_;  // written first, then renamed to filePath_
+    uint64_t intervalNs_;
+
+    // The render thread records into snapshots_[active_]. At the end of an
+    // interval it publishes that index in pending_ and switches to the
+    // other, as long as the exporter has released it (pending_ is -1).
+    Snapshot snapshots_[2];
+    int active_;
+    std::atomic<int> pending_;
+    std::atomic<bool> stopping_;
+    PlatformThread exporter_;
+
+    // Exporter thread only.
+    Snapshot totals_;
+};
+
+#endif // FRAME_TELEMETRY_H
@@ -0,0 +1,22 @@
+#ifndef FULL_SCREEN_PASS_H
+#define FULL_SCREEN_PASS_H
+
+#include "vertex_layout.h"
+
+// Geometry shared by the passes that shade every pixel of a viewport: the
+// dynamic resolution blit, the colour check and the display self-test.
+// Positions are in clip space.
+struct PassVertex {
+    GLfloat position[2];
+};
+
+typedef VertexLayout<PassVertex, VERTEX_ATTRIBUTE(PassVertex, position, false)> PassVertexLayout;
+
+// A single triangle that covers the whole viewport.
+const PassVertex fullScreenTriangle[] = {
+    { { -1.0f, -1.0f } },
+    { {  3.0f, -1.0f } },
+    { { -1.0f,  3.0f } }
+};
+
+#endif // FULL_SCREEN_PASS_H
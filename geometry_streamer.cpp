@@ -0,0 +1,238 @@
+#include "geometry_streamer.h"
+#include "async_log.h"
+#include "platform_timer.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t kChunkBytes = GeometryStreamer::kChunkVertices * kSceneVertexStride;
+
+// How often the cache statistics are logged, in frames.
+const unsigned long kLogInterval = 300;
+
+} // namespace
+
+const uint32_t GeometryStreamer::kChunkVertices;
+
+GeometryStreamer::GeometryStreamer(int gpuBuffers, int readsInFlight)
+    : fd_(-1), reader_(nullptr), frame_(0),
+      hits_(0), misses_(0), pendingDraws_(0), evictions_(0), bytesUploaded_(0), uploadNs_(0),
+      bytesRead_(0), intervalStartNs_(0) {
+    slots_.resize(gpuBuffers > 0 ? gpuBuffers : 1);
+    staging_.resize(readsInFlight > 0 ? readsInFlight : 1);
+}
+
+GeometryStreamer::~GeometryStreamer() {
+    // The reader waits for outstanding reads, which land in staging_.
+    delete reader_;
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+bool GeometryStreamer::open(const char* path) {
+    SceneHeader header;
+    {
+        SceneFile scene;
+        if (!scene.open(path))
+            return false;
+        header = scene.header();
+    }
+    if (header.indexCount) {
+        std::cerr << "Streaming needs a non-indexed scene" << std::endl;
+        return false;
+    }
+
+    fd_ = ::open(path, O_RDONLY);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open scene " << path << std::endl;
+        return false;
+    }
+
+    for (uint64_t first = 0; first < header.vertexCount; first += kChunkVertices) {
+        Chunk chunk;
+        chunk.fileOffset = header.vertexOffset + first * kSceneVertexStride;
+        chunk.vertexCount = static_cast<uint32_t>(std::min<uint64_t>(kChunkVertices, header.vertexCount - first));
+        chunk.slot = -1;
+        chunk.staging = -1;
+        chunk.boundsKnown = false;
+        chunk.minX = chunk.minY = chunk.maxX = chunk.maxY = 0.0f;
+        chunks_.push_back(chunk);
+    }
+
+    // All memory is allocated up front and stays fixed while streaming.
+    GlNamePool<GlBufferTraits> buffers(static_cast<GLsizei>(slots_.size()));
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        slots_[i].buffer = buffers.acquire();
+        glBindBuffer(GL_ARRAY_BUFFER, slots_[i].buffer.get());
+        glBufferData(GL_ARRAY_BUFFER, kChunkBytes, nullptr, GL_DYNAMIC_DRAW);
+        slots_[i].chunk = -1;
+        slots_[i].lastUsedFrame = 0;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    for (size_t i = 0; i < staging_.size(); ++i) {
+        staging_[i].data.resize(kChunkBytes);
+        staging_[i].chunk = -1;
+    }
+
+    reader_ = createAsyncReader(static_cast<int>(staging_.size()));
+    intervalStartNs_ = monotonicNowNs();
+    std::cout << "Streaming " << path << ": " << chunks_.size() << " chunks through "
+              << slots_.size() << " GPU buffers of " << kChunkBytes / 1024 << " KiB, reading with "
+              << reader_->name() << std::endl;
+    return true;
+}
+
+void GeometryStreamer::update() {
+    ++frame_;
+
+    ReadCompletion completions[8];
+    int count;
+    while ((count = reader_->poll(completions, 8)) > 0) {
+        for (int i = 0; i < count; ++i) {
+            Staging& staging = staging_[completions[i].tag];
+            Chunk& chunk = chunks_[staging.chunk];
+            if (completions[i].result <= 0) {
+                LogLine(LogError) << "Failed to read chunk at offset " << chunk.fileOffset
+                                  << " (" << -completions[i].result << ")";
+                chunk.staging = -1;
+                staging.chunk = -1;
+                continue;
+            }
+            staging.bytesRead += completions[i].result;
+            bytesRead_ += completions[i].result;
+            if (staging.bytesRead < staging.bytesWanted) {
+                // Short read; ask for the rest. If that cannot be queued,
+                // free the staging buffer and let draw() request the chunk
+                // again.
+                if (!reader_->submit(fd_, chunk.fileOffset + staging.bytesRead,
+                                     &staging.data[staging.bytesRead],
+                                     staging.bytesWanted - staging.bytesRead, completions[i].tag)) {
+                    LogLine(LogError) << "Failed to continue reading chunk at offset " << chunk.fileOffset;
+                    chunk.staging = -1;
+                    staging.chunk = -1;
+                }
+                continue;
+            }
+            complete(static_cast<int>(completions[i].tag));
+        }
+    }
+
+    if (frame_ % kLogInterval == 0)
+        logStats();
+}
+
+void GeometryStreamer::draw(const DrawChunkFn& drawChunk) {
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        Chunk& chunk = chunks_[i];
+        if (!visible(chunk))
+            continue;
+        if (chunk.slot >= 0) {
+            ++hits_;
+            slots_[chunk.slot].lastUsedFrame = frame_;
+            drawChunk(slots_[chunk.slot].buffer.get(), static_cast<GLsizei>(chunk.vertexCount));
+        } else if (chunk.staging >= 0) {
+            // Already missed; its read has not completed yet.
+            ++pendingDraws_;
+        } else if (request(static_cast<int>(i))) {
+            ++misses_;
+        }
+    }
+}
+
+bool GeometryStreamer::visible(const Chunk& chunk) const {
+    if (!chunk.boundsKnown)
+        return true;
+    return chunk.maxX >= -1.0f && chunk.minX <= 1.0f &&
+           chunk.maxY >= -1.0f && chunk.minY <= 1.0f;
+}
+
+bool GeometryStreamer::request(int chunkIndex) {
+    for (size_t i = 0; i < staging_.size(); ++i) {
+        Staging& staging = staging_[i];
+        if (staging.chunk >= 0)
+            continue;
+        Chunk& chunk = chunks_[chunkIndex];
+        staging.chunk = chunkIndex;
+        staging.bytesRead = 0;
+        staging.bytesWanted = chunk.vertexCount * kSceneVertexStride;
+        if (!reader_->submit(fd_, chunk.fileOffset, &staging.data[0], staging.bytesWanted, i)) {
+            staging.chunk = -1;
+            return false;
+        }
+        chunk.staging = static_cast<int>(i);
+        return true;
+    }
+    // All staging buffers are busy; the chunk is requested again next frame.
+    return false;
+}
+
+void GeometryStreamer::complete(int stagingIndex) {
+    Staging& staging = staging_[stagingIndex];
+    int chunkIndex = staging.chunk;
+    Chunk& chunk = chunks_[chunkIndex];
+    staging.chunk = -1;
+    chunk.staging = -1;
+
+    if (!chunk.boundsKnown) {
+        const float* v = reinterpret_cast<const float*>(&staging.data[0]);
+        const size_t floatsPerVertex = kSceneVertexStride / sizeof(float);
+        chunk.minX = chunk.maxX = v[0];
+        chunk.minY = chunk.maxY = v[1];
+        for (uint32_t i = 1; i < chunk.vertexCount; ++i) {
+            const float* p = v + i * floatsPerVertex;
+            chunk.minX = std::min(chunk.minX, p[0]);
+            chunk.maxX = std::max(chunk.maxX, p[0]);
+            chunk.minY = std::min(chunk.minY, p[1]);
+            chunk.maxY = std::max(chunk.maxY, p[1]);
+        }
+        chunk.boundsKnown = true;
+        if (!visible(chunk))
+            return;
+    }
+
+    int slot = acquireSlot();
+    slots_[slot].chunk = chunkIndex;
+    slots_[slot].lastUsedFrame = frame_;
+    chunk.slot = slot;
+
+    uint64_t start = monotonicNowNs();
+    glBindBuffer(GL_ARRAY_BUFFER, slots_[slot].buffer.get());
+    glBufferSubData(GL_ARRAY_BUFFER, 0, staging.bytesWanted, &staging.data[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    uploadNs_ += monotonicNowNs() - start;
+    bytesUploaded_ += staging.bytesWanted;
+}
+
+int GeometryStreamer::acquireSlot() {
+    int lru = 0;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].chunk < 0)
+            return static_cast<int>(i);
+        if (slots_[i].lastUsedFrame < slots_[lru].lastUsedFrame)
+            lru = static_cast<int>(i);
+    }
+    chunks_[slots_[lru].chunk].slot = -1;
+    slots_[lru].chunk = -1;
+    ++evictions_;
+    return lru;
+}
+
+void GeometryStreamer::logStats() {
+    uint64_t now = monotonicNowNs();
+    double seconds = (now - intervalStartNs_) / 1.0e9;
+    double mib = 1024.0 * 1024.0;
+    unsigned long lookups = hits_ + misses_;
+    LogLine(LogInfo) << "Streaming: hit rate " << (lookups ? 100.0 * hits_ / lookups : 100.0) << "% ("
+                     << hits_ << " hits, " << misses_ << " misses, " << pendingDraws_
+                     << " draws waiting on a read), " << evictions_ << " evictions, read "
+                     << bytesRead_ / mib / seconds << " MiB/s, uploaded " << bytesUploaded_ / mib << " MiB at "
+                     << (uploadNs_ ? bytesUploaded_ / mib / (uploadNs_ / 1.0e9) : 0.0) << " MiB/s";
+    hits_ = misses_ = pendingDraws_ = evictions_ = 0;
+    bytesUploaded_ = uploadNs_ = bytesRead_ = 0;
+    intervalStartNs_ = now;
+}
@@ -0,0 +1,92 @@
+#ifndef GEOMETRY_STREAMER_H
+#define GEOMETRY_STREAMER_H
+
+#include "async_reader.h"
+#include "gl_handle.h"
+#include "gl_platform.h"
+#include "scene_file.h"
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+// Streams a non-indexed scene file that may not fit in GPU memory. The
+// vertex section is split into fixed-size chunks that are read
+// asynchronously into a few staging buffers and uploaded into a fixed pool
+// of GPU buffers. When the pool is full the least recently drawn chunk is
+// evicted, so memory use is bounded no matter how large the scene is.
+//
+// Visibility decides what is requested: chunks whose bounds fall outside
+// the clip-space view are never loaded again once their bounds are known.
+// Until then a chunk is assumed visible.
+class GeometryStreamer {
+public:
+    // Multiple of 3 so that chunks hold whole triangles.
+    static const uint32_t kChunkVertices = 3 * 21845;
+
+    typedef std::function<void(GLuint buffer, GLsizei vertexCount)> DrawChunkFn;
+
+    GeometryStreamer(int gpuBuffers, int readsInFlight = 4);
+    ~GeometryStreamer();
+
+    bool open(const char* path);
+
+    // Starts a frame: uploads chunks whose reads have finished.
+    void update();
+
+    // Draws every resident visible chunk and requests the missing ones.
+    void draw(const DrawChunkFn& drawChunk);
+
+private:
+    GeometryStreamer(const GeometryStreamer&);
+    GeometryStreamer& operator=(const GeometryStreamer&);
+
+    struct Chunk {
+        uint64_t fileOffset;
+        uint32_t vertexCount;
+        int slot;     // GPU buffer holding the chunk, or -1
+        int staging;  // staging buffer being read into, or -1
+        bool boundsKnown;
+        float minX, minY, maxX, maxY;
+    };
+
+    struct Slot {
+        GlBuffer buffer;
+        int chunk;  // -1 when free
+        unsigned long lastUsedFrame;
+    };
+
+    struct Staging {
+        std::vector<unsigned char> data;
+        int chunk;  // -1 when free
+        size_t bytesRead;
+        size_t bytesWanted;
+    };
+
+    bool visible(const Chunk& chunk) const;
+    // Starts reading a chunk into a free staging buffer. Returns false if
+    // none is free or the read could not be submitted.
+    bool request(int chunkIndex);
+    void complete(int stagingIndex);
+    int acquireSlot();
+    void logStats();
+
+    int fd_;
+    AsyncReader* reader_;
+    std::vector<Chunk> chunks_;
+    std::vector<Slot> slots_;
+    std::vector<Staging> staging_;
+    unsigned long frame_;
+
+    // Statistics since the last log.
+    unsigned long hits_;
+    unsigned long misses_;        // reads issued for visible chunks
+    unsigned long pendingDraws_;  // visible chunks skipped while their read is in flight
+    unsigned long evictions_;
+    uint64_t bytesUploaded_;
+    uint64_t uploadNs_;
+    uint64_t bytesRead_;
+    uint64_t intervalStartNs_;
+};
+
+#endif // GEOMETRY_STREAMER_H
@@ -0,0 +1,283 @@
+#ifndef GL_HANDLE_H
+#define GL_HANDLE_H
+
+#include "gl_platform.h"
+
+#include <stddef.h>
+#include <vector>
+
+// Move-only owners of GL and EGL objects. A handle is the bare name (or
+// EGL display plus object) and its functions are inline, so creating,
+// passing and using one compiles to the same calls as the raw name; the
+// difference is that the object is deleted when the handle goes away,
+// on early returns included.
+//
+// GL handles must be destroyed while their context is current. Declaring
+// them after the EGL handles of that context, or as members of objects
+// that are, gets the order right.
+
+// Per-type create and delete calls. Traits with generate() support batched
+// name generation through generateHandles() and GlNamePool.
+struct GlBufferTraits {
+    typedef GLuint Name;
+    static Name null() { return 0; }
+    static void generate(GLsizei count, GLuint* names) { glGenBuffers(count, names); }
+    static void destroy(GLsizei count, const GLuint* names) { glDeleteBuffers(count, names); }
+};
+
+struct GlTextureTraits {
+    typedef GLuint Name;
+    static Name null() { return 0; }
+    static void generate(GLsizei count, GLuint* names) { glGenTextures(count, names); }
+    static void destroy(GLsizei count, const GLuint* names) { glDeleteTextures(count, names); }
+};
+
+struct GlFramebufferTraits {
+    typedef GLuint Name;
+    static Name null() { return 0; }
+    static void generate(GLsizei count, GLuint* names) { glGenFramebuffers(count, names); }
+    static void destroy(GLsizei count, const GLuint* names) { glDeleteFramebuffers(count, names); }
+};
+
+struct GlProgramTraits {
+    typedef GLuint Name;
+    static Name null() { return 0; }
+    static void destroy(GLsizei count, const GLuint* names) {
+        for (GLsizei i = 0; i < count; ++i)
+            glDeleteProgram(names[i]);
+    }
+};
+
+struct GlShaderTraits {
+    typedef GLuint Name;
+    static Name null() { return 0; }
+    static void destroy(GLsizei count, const GLuint* names) {
+        for (GLsizei i = 0; i < count; ++i)
+            glDeleteShader(names[i]);
+    }
+};
+
+#ifndef USE_GLES2
+struct GlVertexArrayTraits {
+    typedef GLuint Name;
+    static Name null() { return 0; }
+    static void generate(GLsizei count, GLuint* names) { glGenVertexArrays(count, names); }
+    static void destroy(GLsizei count, const GLuint* names) { glDeleteVertexArrays(count, names); }
+};
+
+struct GlQueryTraits {
+    typedef GLuint Name;
+    static Name null() { return 0; }
+    static void generate(GLsizei count, GLuint* names) { glGenQueries(count, names); }
+    static void destroy(GLsizei count, const GLuint* names) { glDeleteQueries(count, names); }
+};
+
+struct GlFenceTraits {
+    typedef GLsync Name;
+    static Name null() { return nullptr; }
+    static void destroy(GLsizei count, const GLsync* names) {
+        for (GLsizei i = 0; i < count; ++i)
+            glDeleteSync(names[i]);
+    }
+};
+#endif
+
+template <typename Traits>
+class GlHandle {
+public:
+    typedef typename Traits::Name Name;
+
+    GlHandle() : name_(Traits::null()) {}
+    explicit GlHandle(Name name) : name_(name) {}
+    GlHandle(GlHandle&& other) noexcept : name_(other.release()) {}
+    ~GlHandle() { reset(); }
+
+    GlHandle& operator=(GlHandle&& other) noexcept {
+        reset(other.release());
+        return *this;
+    }
+
+    // A new object, for types whose names come from glGen*.
+    static GlHandle generate() {
+        Name name;
+        Traits::generate(1, &name);
+        return GlHandle(name);
+    }
+
+    Name get() const { return name_; }
+    explicit operator bool() const { return name_ != Traits::null(); }
+
+    // Gives up ownership without deleting the object.
+    Name release() {
+        Name name = name_;
+        name_ = Traits::null();
+        return name;
+    }
+
+    // Deletes the current object, if any, and takes ownership of name.
+    void reset(Name name = Traits::null()) {
+        if (name_ != Traits::null())
+            Traits::destroy(1, &name_);
+        name_ = name;
+    }
+
+private:
+    GlHandle(const GlHandle&);
+    GlHandle& operator=(const GlHandle&);
+
+    Name name_;
+};
+
+typedef GlHandle<GlBufferTraits> GlBuffer;
+typedef GlHandle<GlTextureTraits> GlTexture;
+typedef GlHandle<GlFramebufferTraits> GlFramebuffer;
+typedef GlHandle<GlProgramTraits> GlProgram;
+typedef GlHandle<GlShaderTraits> GlShader;
+#ifndef USE_GLES2
+typedef GlHandle<GlVertexArrayTraits> GlVertexArray;
+typedef GlHandle<GlQueryTraits> GlQuery;
+typedef GlHandle<GlFenceTraits> GlFence;
+#endif
+
+// Fills handles[0..count) with new objects from a single glGen* call.
+template <typename Traits>
+void generateHandles(GlHandle<Traits>* handles, GLsizei count) {
+    const GLsizei kBatch = 64;
+    typename Traits::Name names[kBatch];
+    for (GLsizei first = 0; first < count; first += kBatch) {
+        GLsizei n = count - first < kBatch ? count - first : kBatch;
+        Traits::generate(n, names);
+        for (GLsizei i = 0; i < n; ++i)
+            handles[first + i].reset(names[i]);
+    }
+}
+
+// Hands out objects generated batchSize at a time, for code that creates
+// them one by one, e.g. per ring slot or per chunk. Names that were never
+// handed out are deleted together with the pool.
+template <typename Traits>
+class GlNamePool {
+public:
+    explicit GlNamePool(GLsizei batchSize)
+        : batchSize_(batchSize > 0 ? batchSize : 1) {
+        spare_.reserve(batchSize_);
+    }
+
+    ~GlNamePool() {
+        if (!spare_.empty())
+            Traits::destroy(static_cast<GLsizei>(spare_.size()), &spare_[0]);
+    }
+
+    GlHandle<Traits> acquire() {
+        if (spare_.empty()) {
+            spare_.resize(batchSize_);
+            Traits::generate(batchSize_, &spare_[0]);
+        }
+        typename Traits::Name name = spare_.back();
+        spare_.pop_back();
+        return GlHandle<Traits>(name);
+    }
+
+private:
+    GlNamePool(const GlNamePool&);
+    GlNamePool& operator=(const GlNamePool&);
+
+    GLsizei batchSize_;
+    std::vector<typename Traits::Name> spare_;
+};
+
+#ifdef USE_GLES2
+// EGL objects belong to a display, which the handle keeps alongside.
+struct EglSurfaceTraits {
+    typedef EGLSurface Object;
+    static Object null() { return EGL_NO_SURFACE; }
+    static void destroy(EGLDisplay display, EGLSurface surface) { eglDestroySurface(display, surface); }
+};
+
+struct EglContextTraits {
+    typedef EGLContext Object;
+    static Object null() { return EGL_NO_CONTEXT; }
+    static void destroy(EGLDisplay display, EGLContext context) {
+        // A current context would only be destroyed once released.
+        if (eglGetCurrentContext() == context)
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+    }
+};
+
+template <typename Traits>
+class EglHandle {
+public:
+    typedef typename Traits::Object Object;
+
+    EglHandle() : display_(EGL_NO_DISPLAY), object_(Traits::null()) {}
+    EglHandle(EGLDisplay display, Object object) : display_(display), object_(object) {}
+    EglHandle(EglHandle&& other) noexcept : display_(other.display_), object_(other.release()) {}
+    ~EglHandle() { reset(); }
+
+    EglHandle& operator=(EglHandle&& other) noexcept {
+        reset();
+        display_ = other.display_;
+        object_ = other.release();
+        return *this;
+    }
+
+    Object get() const { return object_; }
+    explicit operator bool() const { return object_ != Traits::null(); }
+
+    Object release() {
+        Object object = object_;
+        object_ = Traits::null();
+        return object;
+    }
+
+    void reset() {
+        if (object_ != Traits::null())
+            Traits::destroy(display_, object_);
+        object_ = Traits::null();
+    }
+
+private:
+    EglHandle(const EglHandle&);
+    EglHandle& operator=(const EglHandle&);
+
+    EGLDisplay display_;
+    Object object_;
+};
+
+typedef EglHandle<EglSurfaceTraits> EglSurface;
+typedef EglHandle<EglContextTraits> EglContext;
+
+// Terminates the display it was given, once initialized.
+class EglDisplay {
+public:
+    EglDisplay() : display_(EGL_NO_DISPLAY) {}
+    explicit EglDisplay(EGLDisplay display) : display_(display) {}
+    EglDisplay(EglDisplay&& other) noexcept : display_(other.display_) { other.display_ = EGL_NO_DISPLAY; }
+    ~EglDisplay() { reset(); }
+
+    EglDisplay& operator=(EglDisplay&& other) noexcept {
+        reset();
+        display_ = other.display_;
+        other.display_ = EGL_NO_DISPLAY;
+        return *this;
+    }
+
+    EGLDisplay get() const { return display_; }
+    explicit operator bool() const { return display_ != EGL_NO_DISPLAY; }
+
+    void reset() {
+        if (display_ != EGL_NO_DISPLAY)
+            eglTerminate(display_);
+        display_ = EGL_NO_DISPLAY;
+    }
+
+private:
+    EglDisplay(const EglDisplay&);
+    EglDisplay& operator=(const EglDisplay&);
+
+    EGLDisplay display_;
+};
+#endif // USE_GLES2
+
+#endif // GL_HANDLE_H
@@ -0,0 +1,22 @@
+#ifndef GL_PLATFORM_H
+#define GL_PLATFORM_H
+
+// Shared GL entry point for code built into both the desktop and the
+// VxWorks targets. The VxWorks build defines USE_GLES2 and talks to the
+// Vivante GLES2/EGL libraries; the desktop build goes through GLEW.
+#ifdef USE_GLES2
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#else
+#include <GL/glew.h>
+#endif
+
+// Trace builds route the GL calls of every file including this header
+// through the recorder.
+#ifdef GL_TRACE
+#include "gl_trace.h"
+#endif
+
+#endif // GL_PLATFORM_H
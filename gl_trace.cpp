@@ -0,0 +1,1037 @@
+#define GL_TRACE_IMPLEMENTATION
+#include "gl_trace.h"
+
+#include <iostream>
+
+#ifdef GL_TRACE
+
+#include "async_log.h"
+#include "gl_trace_format.h"
+#include "platform_timer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+// Records are collected here and written out at every swap, or earlier
+// when the buffer fills up.
+const size_t kBufferBytes = 1 << 20;
+
+// Hashes of blobs already in the trace. Open addressing with a short probe
+// sequence; when it runs full, blobs are simply written again.
+const size_t kSeenSlots = 1 << 16;
+const int kSeenProbes = 8;
+
+const int kMaxAttribs = 16;
+const int kMaxMappings = 4;
+
+// Room reserved for joining the strings of one glShaderSource call, well
+// above the largest generated shader. Only a longer source allocates.
+const size_t kShaderSourceBytes = 64 << 10;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// 64-bit hash of a byte range in the style of MurmurHash3, eight bytes
+// per step. Never returns 0, which the format reserves for null pointers.
+uint64_t hashBytes(const void* data, size_t size) {
+    const uint64_t kMul1 = 0x87c37b91114253d5ULL;
+    const uint64_t kMul2 = 0x4cf5ad432745937fULL;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ size;
+    size_t words = size / 8;
+    for (size_t i = 0; i < words; ++i, p += 8) {
+        uint64_t k;
+        memcpy(&k, p, 8);
+        h ^= rotl(k * kMul1, 31) * kMul2;
+        h = rotl(h, 27) * 5 + 0x52dce729;
+    }
+    uint64_t tail = 0;
+    for (size_t i = 0; i < size % 8; ++i)
+        tail |= static_cast<uint64_t>(p[i]) << (8 * i);
+    h ^= rotl(tail * kMul1, 31) * kMul2;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h ? h : 1;
+}
+
+#ifdef USE_GLES2
+size_t typeBytes(GLenum type) {
+    switch (type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+        return 2;
+    default:
+        return 4;
+    }
+}
+#endif
+
+class TraceRecorder {
+public:
+    TraceRecorder(FILE* file, int frames);
+    ~TraceRecorder();
+
+    // Appends the opcode and arguments of one record.
+    void op(TraceOp op) { put(static_cast<unsigned char>(op)); }
+    void u32(uint32_t value) { putBytes(&value, sizeof(value)); }
+    void i32(int32_t value) { putBytes(&value, sizeof(value)); }
+    void u64(uint64_t value) { putBytes(&value, sizeof(value)); }
+    void f32(float value) { putBytes(&value, sizeof(value)); }
+    void names(GLsizei n, const GLuint* values);
+
+    // Writes a Blob record unless the same data is already in the trace.
+    // Must be called before the record that refers to it is started.
+    uint64_t blob(const void* data, size_t size);
+
+    // Concatenates shader source strings as glShaderSource would.
+    uint64_t shaderSource(GLsizei count, const GLchar* const* strings, const GLint* lengths);
+
+    // Returns true when the frame limit has been reached.
+    bool swap();
+
+    // Bindings the recorder needs to interpret pointer arguments.
+    GLuint arrayBuffer;
+    GLuint elementBuffer;
+    GLuint packBuffer;
+
+#ifdef USE_GLES2
+    // Client-side vertex arrays, which desktop core profiles do not have.
+    // They are not recorded when specified but when drawn, as only then is
+    // the range of vertices read known.
+    struct ClientAttrib {
+        const void* pointer;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        GLsizei stride;
+        bool client;
+        bool enabled;
+    };
+    ClientAttrib attribs[kMaxAttribs];
+    void recordClientArrays(GLsizei vertexCount);
+    bool hasClientArrays() const;
+    bool warnedElementRange;
+#endif
+
+    // Buffers mapped for writing; their contents are recorded on unmap.
+    struct Mapping {
+        GLenum target;
+        void* pointer;
+        GLsizeiptr length;
+        GLbitfield access;
+    };
+    Mapping mappings[kMaxMappings];
+
+private:
+    TraceRecorder(const TraceRecorder&);
+    TraceRecorder& operator=(const TraceRecorder&);
+
+    void put(unsigned char byte) {
+        if (used_ == kBufferBytes)
+            flush();
+        buffer_[used_++] = byte;
+    }
+    void putBytes(const void* data, size_t size);
+    void flush();
+    bool seen(uint64_t hash);
+
+    FILE* file_;
+    unsigned char* buffer_;
+    size_t used_;
+    uint64_t* seen_;
+    std::vector<char> source_;
+
+    uint64_t startNs_;
+    int frameLimit_;
+    unsigned long frames_;
+    uint64_t bytesWritten_;
+    unsigned long blobsWritten_;
+    unsigned long blobsReused_;
+    uint64_t bytesReused_;
+};
+
+TraceRecorder* recorder = nullptr;
+
+TraceRecorder::TraceRecorder(FILE* file, int frames)
+    : arrayBuffer(0), elementBuffer(0), packBuffer(0),
+      file_(file), buffer_(new unsigned char[kBufferBytes]), used_(0),
+      seen_(new uint64_t[kSeenSlots]()), startNs_(monotonicNowNs()), frameLimit_(frames),
+      frames_(0), bytesWritten_(0), blobsWritten_(0), blobsReused_(0), bytesReused_(0) {
+#ifdef USE_GLES2
+    memset(attribs, 0, sizeof(attribs));
+    warnedElementRange = false;
+#endif
+    memset(mappings, 0, sizeof(mappings));
+    source_.reserve(kShaderSourceBytes);
+}
+
+TraceRecorder::~TraceRecorder() {
+    flush();
+    fclose(file_);
+    LogLine(LogInfo) << "GL trace: " << frames_ << " frames, " << bytesWritten_ / 1024 << " KiB, "
+                     << blobsWritten_ << " blobs written, " << blobsReused_ << " reused ("
+                     << bytesReused_ / 1024 << " KiB saved)";
+    delete[] seen_;
+    delete[] buffer_;
+}
+
+void TraceRecorder::putBytes(const void* data, size_t size) {
+    if (size > kBufferBytes - used_) {
+        flush();
+        if (size > kBufferBytes) {
+            fwrite(data, 1, size, file_);
+            bytesWritten_ += size;
+            return;
+        }
+    }
+    memcpy(buffer_ + used_, data, size);
+    used_ += size;
+}
+
+void TraceRecorder::flush() {
+    fwrite(buffer_, 1, used_, file_);
+    bytesWritten_ += used_;
+    used_ = 0;
+}
+
+void TraceRecorder::names(GLsizei n, const GLuint* values) {
+    u32(n);
+    for (GLsizei i = 0; i < n; ++i)
+        u32(values[i]);
+}
+
+bool TraceRecorder::seen(uint64_t hash) {
+    size_t slot = static_cast<size_t>(hash) & (kSeenSlots - 1);
+    for (int probe = 0; probe < kSeenProbes; ++probe) {
+        uint64_t& entry = seen_[(slot + probe) & (kSeenSlots - 1)];
+        if (entry == hash)
+            return true;
+        if (entry == 0) {
+            entry = hash;
+            return false;
+        }
+    }
+    return false;
+}
+
+uint64_t TraceRecorder::blob(const void* data, size_t size) {
+    if (!data)
+        return 0;
+    uint64_t hash = hashBytes(data, size);
+    if (seen(hash)) {
+        ++blobsReused_;
+        bytesReused_ += size;
+        return hash;
+    }
+    op(TraceBlob);
+    u64(hash);
+    u32(static_cast<uint32_t>(size));
+    putBytes(data, size);
+    ++blobsWritten_;
+    return hash;
+}
+
+uint64_t TraceRecorder::shaderSource(GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+    source_.clear();
+    for (GLsizei i = 0; i < count; ++i) {
+        size_t length = lengths && lengths[i] >= 0 ? lengths[i] : strlen(strings[i]);
+        source_.insert(source_.end(), strings[i], strings[i] + length);
+    }
+    return blob(source_.empty() ? "" : &source_[0], source_.size());
+}
+
+#ifdef USE_GLES2
+bool TraceRecorder::hasClientArrays() const {
+    for (int i = 0; i < kMaxAttribs; ++i) {
+        if (attribs[i].enabled && attribs[i].client)
+            return true;
+    }
+    return false;
+}
+
+void TraceRecorder::recordClientArrays(GLsizei vertexCount) {
+    if (vertexCount <= 0)
+        return;
+    for (int i = 0; i < kMaxAttribs; ++i) {
+        const ClientAttrib& a = attribs[i];
+        if (!a.enabled || !a.client)
+            continue;
+        size_t element = a.size * typeBytes(a.type);
+        size_t stride = a.stride ? a.stride : element;
+        uint64_t hash = blob(a.pointer, (vertexCount - 1) * stride + element);
+        op(TraceVertexAttribClientArray);
+        u32(i);
+        i32(a.size);
+        u32(a.type);
+        u32(a.normalized);
+        i32(a.stride);
+        u64(hash);
+    }
+}
+#endif
+
+bool TraceRecorder::swap() {
+    op(TraceSwap);
+    u64(monotonicNowNs() - startNs_);
+    flush();
+    fflush(file_);
+    ++frames_;
+    return frameLimit_ > 0 && frames_ >= static_cast<unsigned long>(frameLimit_);
+}
+
+#ifdef USE_GLES2
+// Number of vertices read through a client-side index array.
+GLsizei indexedVertexCount(GLsizei count, GLenum type, const void* indices) {
+    uint32_t highest = 0;
+    for (GLsizei i = 0; i < count; ++i) {
+        uint32_t index;
+        if (type == GL_UNSIGNED_BYTE)
+            index = static_cast<const GLubyte*>(indices)[i];
+        else if (type == GL_UNSIGNED_SHORT)
+            index = static_cast<const GLushort*>(indices)[i];
+        else
+            index = static_cast<const GLuint*>(indices)[i];
+        if (index > highest)
+            highest = index;
+    }
+    return count ? static_cast<GLsizei>(highest) + 1 : 0;
+}
+#endif
+
+} // namespace
+
+bool startGlTrace(const char* path, int frames) {
+    stopGlTrace();
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Failed to create GL trace " << path << std::endl;
+        return false;
+    }
+
+    GLint viewport[4] = { 0, 0, 0, 0 };
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "GLTRACE", 8);
+    header.version = kTraceVersion;
+#ifdef USE_GLES2
+    header.api = TraceGLES2;
+#else
+    header.api = TraceGL33;
+#endif
+    header.width = viewport[2];
+    header.height = viewport[3];
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        std::cerr << "Failed to write GL trace " << path << std::endl;
+        fclose(file);
+        return false;
+    }
+
+    recorder = new TraceRecorder(file, frames);
+    std::cout << "Recording GL trace to " << path;
+    if (frames > 0)
+        std::cout << " for " << frames << " frames";
+    std::cout << std::endl;
+    return true;
+}
+
+void stopGlTrace() {
+    delete recorder;
+    recorder = nullptr;
+}
+
+void traceSwap() {
+    if (recorder && recorder->swap())
+        stopGlTrace();
+}
+
+void tracedGlGenBuffers(GLsizei n, GLuint* buffers) {
+    glGenBuffers(n, buffers);
+    if (recorder) {
+        recorder->op(TraceGenBuffers);
+        recorder->names(n, buffers);
+    }
+}
+
+void tracedGlDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    if (recorder) {
+        recorder->op(TraceDeleteBuffers);
+        recorder->names(n, buffers);
+    }
+    glDeleteBuffers(n, buffers);
+}
+
+void tracedGlBindBuffer(GLenum target, GLuint buffer) {
+    glBindBuffer(target, buffer);
+    if (recorder) {
+        if (target == GL_ARRAY_BUFFER)
+            recorder->arrayBuffer = buffer;
+        else if (target == GL_ELEMENT_ARRAY_BUFFER)
+            recorder->elementBuffer = buffer;
+#ifndef USE_GLES2
+        else if (target == GL_PIXEL_PACK_BUFFER)
+            recorder->packBuffer = buffer;
+#endif
+        recorder->op(TraceBindBuffer);
+        recorder->u32(target);
+        recorder->u32(buffer);
+    }
+}
+
+void tracedGlBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    glBufferData(target, size, data, usage);
+    if (recorder) {
+        uint64_t hash = recorder->blob(data, size);
+        recorder->op(TraceBufferData);
+        recorder->u32(target);
+        recorder->u64(size);
+        recorder->u64(hash);
+        recorder->u32(usage);
+    }
+}
+
+void tracedGlBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    glBufferSubData(target, offset, size, data);
+    if (recorder) {
+        uint64_t hash = recorder->blob(data, size);
+        recorder->op(TraceBufferSubData);
+        recorder->u32(target);
+        recorder->u64(offset);
+        recorder->u64(size);
+        recorder->u64(hash);
+    }
+}
+
+void tracedGlEnableVertexAttribArray(GLuint index) {
+    glEnableVertexAttribArray(index);
+    if (recorder) {
+#ifdef USE_GLES2
+        if (index < static_cast<GLuint>(kMaxAttribs))
+            recorder->attribs[index].enabled = true;
+#endif
+        recorder->op(TraceEnableVertexAttribArray);
+        recorder->u32(index);
+    }
+}
+
+void tracedGlDisableVertexAttribArray(GLuint index) {
+    glDisableVertexAttribArray(index);
+    if (recorder) {
+#ifdef USE_GLES2
+        if (index < static_cast<GLuint>(kMaxAttribs))
+            recorder->attribs[index].enabled = false;
+#endif
+        recorder->op(TraceDisableVertexAttribArray);
+        recorder->u32(index);
+    }
+}
+
+void tracedGlVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                 GLsizei stride, const void* pointer) {
+    glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    if (!recorder)
+        return;
+#ifdef USE_GLES2
+    if (recorder->arrayBuffer == 0 && index < static_cast<GLuint>(kMaxAttribs)) {
+        TraceRecorder::ClientAttrib& a = recorder->attribs[index];
+        a.pointer = pointer;
+        a.size = size;
+        a.type = type;
+        a.normalized = normalized;
+        a.stride = stride;
+        a.client = true;
+        return;
+    }
+    if (index < static_cast<GLuint>(kMaxAttribs))
+        recorder->attribs[index].client = false;
+#endif
+    recorder->op(TraceVertexAttribPointer);
+    recorder->u32(index);
+    recorder->i32(size);
+    recorder->u32(type);
+    recorder->u32(normalized);
+    recorder->i32(stride);
+    recorder->u64(reinterpret_cast<uintptr_t>(pointer));
+}
+
+void tracedGlDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    glDrawArrays(mode, first, count);
+    if (recorder) {
+#ifdef USE_GLES2
+        recorder->recordClientArrays(first + count);
+#endif
+        recorder->op(TraceDrawArrays);
+        recorder->u32(mode);
+        recorder->i32(first);
+        recorder->i32(count);
+    }
+}
+
+void tracedGlDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    glDrawElements(mode, count, type, indices);
+    if (!recorder)
+        return;
+#ifdef USE_GLES2
+    // Desktop core profiles have no client-side arrays, and there the
+    // element buffer binding belongs to the vertex array object.
+    if (recorder->elementBuffer == 0) {
+        recorder->recordClientArrays(indexedVertexCount(count, type, indices));
+        uint64_t hash = recorder->blob(indices, count * typeBytes(type));
+        recorder->op(TraceDrawElementsClient);
+        recorder->u32(mode);
+        recorder->i32(count);
+        recorder->u32(type);
+        recorder->u64(hash);
+        return;
+    }
+    if (recorder->hasClientArrays() && !recorder->warnedElementRange) {
+        LogLine(LogError) << "GL trace: client-side arrays drawn with an element buffer are not recorded";
+        recorder->warnedElementRange = true;
+    }
+#endif
+    recorder->op(TraceDrawElements);
+    recorder->u32(mode);
+    recorder->i32(count);
+    recorder->u32(type);
+    recorder->u64(reinterpret_cast<uintptr_t>(indices));
+}
+
+void tracedGlClear(GLbitfield mask) {
+    glClear(mask);
+    if (recorder) {
+        recorder->op(TraceClear);
+        recorder->u32(mask);
+    }
+}
+
+void tracedGlClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+    glClearColor(red, green, blue, alpha);
+    if (recorder) {
+        recorder->op(TraceClearColor);
+        recorder->f32(red);
+        recorder->f32(green);
+        recorder->f32(blue);
+        recorder->f32(alpha);
+    }
+}
+
+void tracedGlViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    glViewport(x, y, width, height);
+    if (recorder) {
+        recorder->op(TraceViewport);
+        recorder->i32(x);
+        recorder->i32(y);
+        recorder->i32(width);
+        recorder->i32(height);
+    }
+}
+
+void tracedGlScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    glScissor(x, y, width, height);
+    if (recorder) {
+        recorder->op(TraceScissor);
+        recorder->i32(x);
+        recorder->i32(y);
+        recorder->i32(width);
+        recorder->i32(height);
+    }
+}
+
+void tracedGlEnable(GLenum cap) {
+    glEnable(cap);
+    if (recorder) {
+        recorder->op(TraceEnable);
+        recorder->u32(cap);
+    }
+}
+
+void tracedGlDisable(GLenum cap) {
+    glDisable(cap);
+    if (recorder) {
+        recorder->op(TraceDisable);
+        recorder->u32(cap);
+    }
+}
+
+void tracedGlBlendFunc(GLenum sfactor, GLenum dfactor) {
+    glBlendFunc(sfactor, dfactor);
+    if (recorder) {
+        recorder->op(TraceBlendFunc);
+        recorder->u32(sfactor);
+        recorder->u32(dfactor);
+    }
+}
+
+void tracedGlFinish() {
+    glFinish();
+    if (recorder)
+        recorder->op(TraceFinish);
+}
+
+GLuint tracedGlCreateShader(GLenum type) {
+    GLuint shader = glCreateShader(type);
+    if (recorder) {
+        recorder->op(TraceCreateShader);
+        recorder->u32(type);
+        recorder->u32(shader);
+    }
+    return shader;
+}
+
+void tracedGlShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) {
+    glShaderSource(shader, count, string, length);
+    if (recorder) {
+        uint64_t hash = recorder->shaderSource(count, string, length);
+        recorder->op(TraceShaderSource);
+        recorder->u32(shader);
+        recorder->u64(hash);
+    }
+}
+
+void tracedGlCompileShader(GLuint shader) {
+    glCompileShader(shader);
+    if (recorder) {
+        recorder->op(TraceCompileShader);
+        recorder->u32(shader);
+    }
+}
+
+void tracedGlDeleteShader(GLuint shader) {
+    glDeleteShader(shader);
+    if (recorder) {
+        recorder->op(TraceDeleteShader);
+        recorder->u32(shader);
+    }
+}
+
+GLuint tracedGlCreateProgram() {
+    GLuint program = glCreateProgram();
+    if (recorder) {
+        recorder->op(TraceCreateProgram);
+        recorder->u32(program);
+    }
+    return program;
+}
+
+void tracedGlAttachShader(GLuint program, GLuint shader) {
+    glAttachShader(program, shader);
+    if (recorder) {
+        recorder->op(TraceAttachShader);
+        recorder->u32(program);
+        recorder->u32(shader);
+    }
+}
+
+void tracedGlLinkProgram(GLuint program) {
+    glLinkProgram(program);
+    if (recorder) {
+        recorder->op(TraceLinkProgram);
+        recorder->u32(program);
+    }
+}
+
+void tracedGlDeleteProgram(GLuint program) {
+    glDeleteProgram(program);
+    if (recorder) {
+        recorder->op(TraceDeleteProgram);
+        recorder->u32(program);
+    }
+}
+
+void tracedGlUseProgram(GLuint program) {
+    glUseProgram(program);
+    if (recorder) {
+        recorder->op(TraceUseProgram);
+        recorder->u32(program);
+    }
+}
+
+GLint tracedGlGetUniformLocation(GLuint program, const GLchar* name) {
+    GLint location = glGetUniformLocation(program, name);
+    if (recorder) {
+        uint64_t hash = recorder->blob(name, strlen(name));
+        recorder->op(TraceGetUniformLocation);
+        recorder->u32(program);
+        recorder->u64(hash);
+        recorder->i32(location);
+    }
+    return location;
+}
+
+GLint tracedGlGetAttribLocation(GLuint program, const GLchar* name) {
+    GLint location = glGetAttribLocation(program, name);
+    if (recorder) {
+        uint64_t hash = recorder->blob(name, strlen(name));
+        recorder->op(TraceGetAttribLocation);
+        recorder->u32(program);
+        recorder->u64(hash);
+        recorder->i32(location);
+    }
+    return location;
+}
+
+void tracedGlUniform1f(GLint location, GLfloat v0) {
+    glUniform1f(location, v0);
+    if (recorder) {
+        recorder->op(TraceUniform1f);
+        recorder->i32(location);
+        recorder->f32(v0);
+    }
+}
+
+void tracedGlUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    glUniform2f(location, v0, v1);
+    if (recorder) {
+        recorder->op(TraceUniform2f);
+        recorder->i32(location);
+        recorder->f32(v0);
+        recorder->f32(v1);
+    }
+}
+
+void tracedGlUniform1i(GLint location, GLint v0) {
+    glUniform1i(location, v0);
+    if (recorder) {
+        recorder->op(TraceUniform1i);
+        recorder->i32(location);
+        recorder->i32(v0);
+    }
+}
+
+void tracedGlUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+    glUniform3fv(location, count, value);
+    if (recorder) {
+        recorder->op(TraceUniform3fv);
+        recorder->i32(location);
+        recorder->i32(count);
+        for (GLsizei i = 0; i < 3 * count; ++i)
+            recorder->f32(value[i]);
+    }
+}
+
+void tracedGlActiveTexture(GLenum texture) {
+    glActiveTexture(texture);
+    if (recorder) {
+        recorder->op(TraceActiveTexture);
+        recorder->u32(texture);
+    }
+}
+
+void tracedGlGenTextures(GLsizei n, GLuint* textures) {
+    glGenTextures(n, textures);
+    if (recorder) {
+        recorder->op(TraceGenTextures);
+        recorder->names(n, textures);
+    }
+}
+
+void tracedGlDeleteTextures(GLsizei n, const GLuint* textures) {
+    if (recorder) {
+        recorder->op(TraceDeleteTextures);
+        recorder->names(n, textures);
+    }
+    glDeleteTextures(n, textures);
+}
+
+void tracedGlBindTexture(GLenum target, GLuint texture) {
+    glBindTexture(target, texture);
+    if (recorder) {
+        recorder->op(TraceBindTexture);
+        recorder->u32(target);
+        recorder->u32(texture);
+    }
+}
+
+void tracedGlTexParameteri(GLenum target, GLenum pname, GLint param) {
+    glTexParameteri(target, pname, param);
+    if (recorder) {
+        recorder->op(TraceTexParameteri);
+        recorder->u32(target);
+        recorder->u32(pname);
+        recorder->i32(param);
+    }
+}
+
+void tracedGlTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                        GLint border, GLenum format, GLenum type, const void* pixels) {
+    glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+    if (recorder) {
+        size_t bytes = tracePixelBytes(width, height, format, type);
+        if (pixels && bytes == 0)
+            LogLine(LogError) << "GL trace: texture data in format " << format << "/" << type << " not recorded";
+        uint64_t hash = bytes ? recorder->blob(pixels, bytes) : 0;
+        recorder->op(TraceTexImage2D);
+        recorder->u32(target);
+        recorder->i32(level);
+        recorder->i32(internalformat);
+        recorder->i32(width);
+        recorder->i32(height);
+        recorder->i32(border);
+        recorder->u32(format);
+        recorder->u32(type);
+        recorder->u64(hash);
+    }
+}
+
+void tracedGlGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+    glGenFramebuffers(n, framebuffers);
+    if (recorder) {
+        recorder->op(TraceGenFramebuffers);
+        recorder->names(n, framebuffers);
+    }
+}
+
+void tracedGlDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+    if (recorder) {
+        recorder->op(TraceDeleteFramebuffers);
+        recorder->names(n, framebuffers);
+    }
+    glDeleteFramebuffers(n, framebuffers);
+}
+
+void tracedGlBindFramebuffer(GLenum target, GLuint framebuffer) {
+    glBindFramebuffer(target, framebuffer);
+    if (recorder) {
+        recorder->op(TraceBindFramebuffer);
+        recorder->u32(target);
+        recorder->u32(framebuffer);
+    }
+}
+
+void tracedGlFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture,
+                                  GLint level) {
+    glFramebufferTexture2D(target, attachment, textarget, texture, level);
+    if (recorder) {
+        recorder->op(TraceFramebufferTexture2D);
+        recorder->u32(target);
+        recorder->u32(attachment);
+        recorder->u32(textarget);
+        recorder->u32(texture);
+        recorder->i32(level);
+    }
+}
+
+void tracedGlReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type,
+                        void* pixels) {
+    glReadPixels(x, y, width, height, format, type, pixels);
+    if (recorder) {
+        recorder->op(TraceReadPixels);
+        recorder->i32(x);
+        recorder->i32(y);
+        recorder->i32(width);
+        recorder->i32(height);
+        recorder->u32(format);
+        recorder->u32(type);
+        recorder->u32(recorder->packBuffer != 0);
+        recorder->u64(recorder->packBuffer ? reinterpret_cast<uintptr_t>(pixels) : 0);
+    }
+}
+
+void tracedGlCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                               GLint x, GLint y, GLsizei width, GLsizei height) {
+    glCopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width, height);
+    if (recorder) {
+        recorder->op(TraceCopyTexSubImage2D);
+        recorder->u32(target);
+        recorder->i32(level);
+        recorder->i32(xoffset);
+        recorder->i32(yoffset);
+        recorder->i32(x);
+        recorder->i32(y);
+        recorder->i32(width);
+        recorder->i32(height);
+    }
+}
+
+#ifndef USE_GLES2
+void tracedGlGenVertexArrays(GLsizei n, GLuint* arrays) {
+    glGenVertexArrays(n, arrays);
+    if (recorder) {
+        recorder->op(TraceGenVertexArrays);
+        recorder->names(n, arrays);
+    }
+}
+
+void tracedGlDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+    if (recorder) {
+        recorder->op(TraceDeleteVertexArrays);
+        recorder->names(n, arrays);
+    }
+    glDeleteVertexArrays(n, arrays);
+}
+
+void tracedGlBindVertexArray(GLuint array) {
+    glBindVertexArray(array);
+    if (recorder) {
+        recorder->op(TraceBindVertexArray);
+        recorder->u32(array);
+    }
+}
+
+void* tracedGlMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    void* pointer = glMapBufferRange(target, offset, length, access);
+    if (recorder) {
+        if (pointer && (access & GL_MAP_WRITE_BIT)) {
+            for (int i = 0; i < kMaxMappings; ++i) {
+                TraceRecorder::Mapping& m = recorder->mappings[i];
+                if (!m.pointer) {
+                    m.target = target;
+                    m.pointer = pointer;
+                    m.length = length;
+                    m.access = access;
+                    break;
+                }
+            }
+        }
+        recorder->op(TraceMapBufferRange);
+        recorder->u32(target);
+        recorder->u64(offset);
+        recorder->u64(length);
+        recorder->u32(access);
+    }
+    return pointer;
+}
+
+GLboolean tracedGlUnmapBuffer(GLenum target) {
+    if (recorder) {
+        uint64_t hash = 0;
+        for (int i = 0; i < kMaxMappings; ++i) {
+            TraceRecorder::Mapping& m = recorder->mappings[i];
+            if (m.pointer && m.target == target) {
+                hash = recorder->blob(m.pointer, m.length);
+                m.pointer = nullptr;
+                break;
+            }
+        }
+        recorder->op(TraceUnmapBuffer);
+        recorder->u32(target);
+        recorder->u64(hash);
+    }
+    return glUnmapBuffer(target);
+}
+
+void tracedGlBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+                             GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
+                             GLbitfield mask, GLenum filter) {
+    glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+    if (recorder) {
+        recorder->op(TraceBlitFramebuffer);
+        recorder->i32(srcX0);
+        recorder->i32(srcY0);
+        recorder->i32(srcX1);
+        recorder->i32(srcY1);
+        recorder->i32(dstX0);
+        recorder->i32(dstY0);
+        recorder->i32(dstX1);
+        recorder->i32(dstY1);
+        recorder->u32(mask);
+        recorder->u32(filter);
+    }
+}
+
+void tracedGlReadBuffer(GLenum mode) {
+    glReadBuffer(mode);
+    if (recorder) {
+        recorder->op(TraceReadBuffer);
+        recorder->u32(mode);
+    }
+}
+
+void tracedGlGenQueries(GLsizei n, GLuint* ids) {
+    glGenQueries(n, ids);
+    if (recorder) {
+        recorder->op(TraceGenQueries);
+        recorder->names(n, ids);
+    }
+}
+
+void tracedGlDeleteQueries(GLsizei n, const GLuint* ids) {
+    if (recorder) {
+        recorder->op(TraceDeleteQueries);
+        recorder->names(n, ids);
+    }
+    glDeleteQueries(n, ids);
+}
+
+void tracedGlBeginQuery(GLenum target, GLuint id) {
+    glBeginQuery(target, id);
+    if (recorder) {
+        recorder->op(TraceBeginQuery);
+        recorder->u32(target);
+        recorder->u32(id);
+    }
+}
+
+void tracedGlEndQuery(GLenum target) {
+    glEndQuery(target);
+    if (recorder) {
+        recorder->op(TraceEndQuery);
+        recorder->u32(target);
+    }
+}
+
+void tracedGlQueryCounter(GLuint id, GLenum target) {
+    glQueryCounter(id, target);
+    if (recorder) {
+        recorder->op(TraceQueryCounter);
+        recorder->u32(id);
+        recorder->u32(target);
+    }
+}
+
+GLsync tracedGlFenceSync(GLenum condition, GLbitfield flags) {
+    GLsync sync = glFenceSync(condition, flags);
+    if (recorder) {
+        recorder->op(TraceFenceSync);
+        recorder->u32(condition);
+        recorder->u32(flags);
+        recorder->u64(reinterpret_cast<uintptr_t>(sync));
+    }
+    return sync;
+}
+
+GLenum tracedGlClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+    GLenum result = glClientWaitSync(sync, flags, timeout);
+    if (recorder) {
+        recorder->op(TraceClientWaitSync);
+        recorder->u64(reinterpret_cast<uintptr_t>(sync));
+        recorder->u32(flags);
+        recorder->u64(timeout);
+    }
+    return result;
+}
+
+void tracedGlDeleteSync(GLsync sync) {
+    if (recorder) {
+        recorder->op(TraceDeleteSync);
+        recorder->u64(reinterpret_cast<uintptr_t>(sync));
+    }
+    glDeleteSync(sync);
+}
+#endif // USE_GLES2
+
+#else
+
+bool startGlTrace(const char* path, int frames) {
+    (void)path;
+    (void)frames;
+    std::cerr << "GL tracing is not compiled in; configure with -DGL_TRACE=ON" << std::endl;
+    return false;
+}
+
+void stopGlTrace() {
+}
+
+#endif // GL_TRACE
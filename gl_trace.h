@@ -0,0 +1,247 @@
+#ifndef GL_TRACE_H
+#define GL_TRACE_H
+
+#include "gl_platform.h"
+
+// Records the GL calls made by the renderer into a binary trace (see
+// gl_trace_format.h) that gl_trace_replay plays back without the
+// application.
+//
+// Recording is compiled in only when the build defines GL_TRACE (the CMake
+// option of the same name). Every translation unit that includes
+// gl_platform.h then has its GL calls redirected through the wrappers
+// below by macro, which forward to the driver and, while a trace is
+// running, append a record. Builds without GL_TRACE call the driver
+// directly and pay nothing.
+//
+// Only calls that change GL state or draw are recorded; queries such as
+// glGetShaderiv go straight to the driver. So do glProgramParameteri and
+// glProgramBinary from program_binary_cache.cpp: the retrievable hint only
+// affects glGetProgramBinary, and programs are only loaded from binaries
+// after a GPU reset, in a later context than the one traced (recording
+// covers the first context only). All calls must come from the thread that
+// owns the context. Recording allocates nothing after startGlTrace(), short
+// of a shader source over 64 KiB, so it also works with the allocation
+// guard armed.
+
+// Starts recording into path, replacing it. Must be called with the
+// context current and before any GL object is created, so that the trace
+// holds everything the later frames use. Records until stopGlTrace(), or
+// for the given number of frames if that is positive. Returns false if the
+// build lacks GL_TRACE or the file cannot be created.
+bool startGlTrace(const char* path, int frames);
+
+// Writes out the rest of the trace and closes it. Safe to call when no
+// trace is running.
+void stopGlTrace();
+
+#ifdef GL_TRACE
+
+// Marks the end of a frame. Call right after the buffer swap.
+void traceSwap();
+
+void tracedGlGenBuffers(GLsizei n, GLuint* buffers);
+void tracedGlDeleteBuffers(GLsizei n, const GLuint* buffers);
+void tracedGlBindBuffer(GLenum target, GLuint buffer);
+void tracedGlBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+void tracedGlBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+void tracedGlEnableVertexAttribArray(GLuint index);
+void tracedGlDisableVertexAttribArray(GLuint index);
+void tracedGlVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                 GLsizei stride, const void* pointer);
+void tracedGlDrawArrays(GLenum mode, GLint first, GLsizei count);
+void tracedGlDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+void tracedGlClear(GLbitfield mask);
+void tracedGlClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void tracedGlViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void tracedGlScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+void tracedGlEnable(GLenum cap);
+void tracedGlDisable(GLenum cap);
+void tracedGlBlendFunc(GLenum sfactor, GLenum dfactor);
+void tracedGlFinish();
+GLuint tracedGlCreateShader(GLenum type);
+void tracedGlShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+void tracedGlCompileShader(GLuint shader);
+void tracedGlDeleteShader(GLuint shader);
+GLuint tracedGlCreateProgram();
+void tracedGlAttachShader(GLuint program, GLuint shader);
+void tracedGlLinkProgram(GLuint program);
+void tracedGlDeleteProgram(GLuint program);
+void tracedGlUseProgram(GLuint program);
+GLint tracedGlGetUniformLocation(GLuint program, const GLchar* name);
+GLint tracedGlGetAttribLocation(GLuint program, const GLchar* name);
+void tracedGlUniform1f(GLint location, GLfloat v0);
+void tracedGlUniform2f(GLint location, GLfloat v0, GLfloat v1);
+void tracedGlUniform1i(GLint location, GLint v0);
+void tracedGlUniform3fv(GLint location, GLsizei count, const GLfloat* value);
+void tracedGlActiveTexture(GLenum texture);
+void tracedGlGenTextures(GLsizei n, GLuint* textures);
+void tracedGlDeleteTextures(GLsizei n, const GLuint* textures);
+void tracedGlBindTexture(GLenum target, GLuint texture);
+void tracedGlTexParameteri(GLenum target, GLenum pname, GLint param);
+void tracedGlTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                        GLint border, GLenum format, GLenum type, const void* pixels);
+void tracedGlGenFramebuffers(GLsizei n, GLuint* framebuffers);
+void tracedGlDeleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+void tracedGlBindFramebuffer(GLenum target, GLuint framebuffer);
+void tracedGlFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture,
+                                  GLint level);
+void tracedGlReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type,
+                        void* pixels);
+void tracedGlCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                               GLint x, GLint y, GLsizei width, GLsizei height);
+
+#ifndef USE_GLES2
+void tracedGlGenVertexArrays(GLsizei n, GLuint* arrays);
+void tracedGlDeleteVertexArrays(GLsizei n, const GLuint* arrays);
+void tracedGlBindVertexArray(GLuint array);
+void* tracedGlMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+GLboolean tracedGlUnmapBuffer(GLenum target);
+void tracedGlBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+                             GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
+                             GLbitfield mask, GLenum filter);
+void tracedGlReadBuffer(GLenum mode);
+void tracedGlGenQueries(GLsizei n, GLuint* ids);
+void tracedGlDeleteQueries(GLsizei n, const GLuint* ids);
+void tracedGlBeginQuery(GLenum target, GLuint id);
+void tracedGlEndQuery(GLenum target);
+void tracedGlQueryCounter(GLuint id, GLenum target);
+GLsync tracedGlFenceSync(GLenum condition, GLbitfield flags);
+GLenum tracedGlClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+void tracedGlDeleteSync(GLsync sync);
+#endif
+
+// gl_trace.cpp defines GL_TRACE_IMPLEMENTATION to reach the driver.
+#ifndef GL_TRACE_IMPLEMENTATION
+#undef glGenBuffers
+#define glGenBuffers tracedGlGenBuffers
+#undef glDeleteBuffers
+#define glDeleteBuffers tracedGlDeleteBuffers
+#undef glBindBuffer
+#define glBindBuffer tracedGlBindBuffer
+#undef glBufferData
+#define glBufferData tracedGlBufferData
+#undef glBufferSubData
+#define glBufferSubData tracedGlBufferSubData
+#undef glEnableVertexAttribArray
+#define glEnableVertexAttribArray tracedGlEnableVertexAttribArray
+#undef glDisableVertexAttribArray
+#define glDisableVertexAttribArray tracedGlDisableVertexAttribArray
+#undef glVertexAttribPointer
+#define glVertexAttribPointer tracedGlVertexAttribPointer
+#undef glDrawArrays
+#define glDrawArrays tracedGlDrawArrays
+#undef glDrawElements
+#define glDrawElements tracedGlDrawElements
+#undef glClear
+#define glClear tracedGlClear
+#undef glClearColor
+#define glClearColor tracedGlClearColor
+#undef glViewport
+#define glViewport tracedGlViewport
+#undef glScissor
+#define glScissor tracedGlScissor
+#undef glEnable
+#define glEnable tracedGlEnable
+#undef glDisable
+#define glDisable tracedGlDisable
+#undef glBlendFunc
+#define glBlendFunc tracedGlBlendFunc
+#undef glFinish
+#define glFinish tracedGlFinish
+#undef glCreateShader
+#define glCreateShader tracedGlCreateShader
+#undef glShaderSource
+#define glShaderSource tracedGlShaderSource
+#undef glCompileShader
+#define glCompileShader tracedGlCompileShader
+#undef glDeleteShader
+#define glDeleteShader tracedGlDeleteShader
+#undef glCreateProgram
+#define glCreateProgram tracedGlCreateProgram
+#undef glAttachShader
+#define glAttachShader tracedGlAttachShader
+#undef glLinkProgram
+#define glLinkProgram tracedGlLinkProgram
+#undef glDeleteProgram
+#define glDeleteProgram tracedGlDeleteProgram
+#undef glUseProgram
+#define glUseProgram tracedGlUseProgram
+#undef glGetUniformLocation
+#define glGetUniformLocation tracedGlGetUniformLocation
+#undef glGetAttribLocation
+#define glGetAttribLocation tracedGlGetAttribLocation
+#undef glUniform1f
+#define glUniform1f tracedGlUniform1f
+#undef glUniform2f
+#define glUniform2f tracedGlUniform2f
+#undef glUniform1i
+#define glUniform1i tracedGlUniform1i
+#undef glUniform3fv
+#define glUniform3fv tracedGlUniform3fv
+#undef glActiveTexture
+#define glActiveTexture tracedGlActiveTexture
+#undef glGenTextures
+#define glGenTextures tracedGlGenTextures
+#undef glDeleteTextures
+#define glDeleteTextures tracedGlDeleteTextures
+#undef glBindTexture
+#define glBindTexture tracedGlBindTexture
+#undef glTexParameteri
+#define glTexParameteri tracedGlTexParameteri
+#undef glTexImage2D
+#define glTexImage2D tracedGlTexImage2D
+#undef glGenFramebuffers
+#define glGenFramebuffers tracedGlGenFramebuffers
+#undef glDeleteFramebuffers
+#define glDeleteFramebuffers tracedGlDeleteFramebuffers
+#undef glBindFramebuffer
+#define glBindFramebuffer tracedGlBindFramebuffer
+#undef glFramebufferTexture2D
+#define glFramebufferTexture2D tracedGlFramebufferTexture2D
+#undef glReadPixels
+#define glReadPixels tracedGlReadPixels
+#undef glCopyTexSubImage2D
+#define glCopyTexSubImage2D tracedGlCopyTexSubImage2D
+
+#ifndef USE_GLES2
+#undef glGenVertexArrays
+#define glGenVertexArrays tracedGlGenVertexArrays
+#undef glDeleteVertexArrays
+#define glDeleteVertexArrays tracedGlDeleteVertexArrays
+#undef glBindVertexArray
+#define glBindVertexArray tracedGlBindVertexArray
+#undef glMapBufferRange
+#define glMapBufferRange tracedGlMapBufferRange
+#undef glUnmapBuffer
+#define glUnmapBuffer tracedGlUnmapBuffer
+#undef glBlitFramebuffer
+#define glBlitFramebuffer tracedGlBlitFramebuffer
+#undef glReadBuffer
+#define glReadBuffer tracedGlReadBuffer
+#undef glGenQueries
+#define glGenQueries tracedGlGenQueries
+#undef glDeleteQueries
+#define glDeleteQueries tracedGlDeleteQueries
+#undef glBeginQuery
+#define glBeginQuery tracedGlBeginQuery
+#undef glEndQuery
+#define glEndQuery tracedGlEndQuery
+#undef glQueryCounter
+#define glQueryCounter tracedGlQueryCounter
+#undef glFenceSync
+#define glFenceSync tracedGlFenceSync
+#undef glClientWaitSync
+#define glClientWaitSync tracedGlClientWaitSync
+#undef glDeleteSync
+#define glDeleteSync tracedGlDeleteSync
+#endif // USE_GLES2
+#endif // GL_TRACE_IMPLEMENTATION
+
+#else
+
+inline void traceSwap() {}
+
+#endif // GL_TRACE
+
+#endif // GL_TRACE_H
@@ -0,0 +1,157 @@
+#ifndef GL_TRACE_FORMAT_H
+#define GL_TRACE_FORMAT_H
+
+#include "gl_platform.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary GL call trace, version 1, shared by the recorder in gl_trace.cpp
+// and the player in gl_trace_player.cpp. All fields are little-endian and
+// unaligned.
+//
+//   TraceHeader (24 bytes)
+//   records: one opcode byte followed by the arguments listed below
+//
+// Arguments are u32 unless noted; enums, names, GLint and GLsizei values
+// are all stored as 32 bits and floats by their bit pattern. Object names
+// are the ones the recording driver returned; the player maps them onto
+// its own. Data passed by pointer (buffer contents, shader sources,
+// pixels, client-side arrays) is stored once in a Blob record and then
+// referred to by its 64-bit hash, so data re-uploaded every frame with
+// unchanged contents is stored only once. Hash 0 stands for a null
+// pointer.
+struct TraceHeader {
+    char magic[8];     // "GLTRACE\0"
+    uint32_t version;
+    uint32_t api;      // TraceApi
+    uint32_t width;    // viewport when recording started
+    uint32_t height;
+};
+
+const uint32_t kTraceVersion = 1;
+
+enum TraceApi {
+    TraceGL33 = 1,    // desktop OpenGL 3.3 core
+    TraceGLES2 = 2    // OpenGL ES 2.0
+};
+
+enum TraceOp {
+    // u64 hash, u32 size, size bytes
+    TraceBlob = 1,
+    // u64 nanoseconds since recording started
+    TraceSwap,
+
+    // Object names: u32 n, n names
+    TraceGenBuffers,
+    TraceDeleteBuffers,
+    TraceGenTextures,
+    TraceDeleteTextures,
+    TraceGenFramebuffers,
+    TraceDeleteFramebuffers,
+    TraceGenVertexArrays,
+    TraceDeleteVertexArrays,
+    TraceGenQueries,
+    TraceDeleteQueries,
+
+    // Buffers
+    TraceBindBuffer,                // target, buffer
+    TraceBufferData,                // target, u64 size, u64 data hash, usage
+    TraceBufferSubData,             // target, u64 offset, u64 size, u64 data hash
+    TraceMapBufferRange,            // target, u64 offset, u64 length, access
+    TraceUnmapBuffer,               // target, u64 hash of the range written through the mapping
+
+    // Vertex input
+    TraceBindVertexArray,           // array
+    TraceEnableVertexAttribArray,   // index
+    TraceDisableVertexAttribArray,  // index
+    TraceVertexAttribPointer,       // index, size, type, normalized, stride, u64 buffer offset
+    TraceVertexAttribClientArray,   // index, size, type, normalized, stride, u64 data hash
+
+    // Drawing
+    TraceDrawArrays,                // mode, first, count
+    TraceDrawElements,              // mode, count, type, u64 element buffer offset
+    TraceDrawElementsClient,        // mode, count, type, u64 index data hash
+    TraceClear,                     // mask
+    TraceClearColor,                // r, g, b, a
+    TraceViewport,                  // x, y, width, height
+    TraceScissor,                   // x, y, width, height
+    TraceEnable,                    // cap
+    TraceDisable,                   // cap
+    TraceBlendFunc,                 // sfactor, dfactor
+    TraceFinish,
+
+    // Shaders
+    TraceCreateShader,              // type, result
+    TraceShaderSource,              // shader, u64 source hash (all strings concatenated)
+    TraceCompileShader,             // shader
+    TraceDeleteShader,              // shader
+    TraceCreateProgram,             // result
+    TraceAttachShader,              // program, shader
+    TraceLinkProgram,               // program
+    TraceDeleteProgram,             // program
+    TraceUseProgram,                // program
+    TraceGetUniformLocation,        // program, u64 name hash, result
+    TraceGetAttribLocation,         // program, u64 name hash, result
+    TraceUniform1f,                 // location, x
+    TraceUniform2f,                 // location, x, y
+    TraceUniform1i,                 // location, x
+
+    // Textures and framebuffers
+    TraceActiveTexture,             // texture unit
+    TraceBindTexture,               // target, texture
+    TraceTexParameteri,             // target, pname, param
+    TraceTexImage2D,                // target, level, internal format, width, height, border,
+                                    // format, type, u64 pixel hash
+    TraceBindFramebuffer,           // target, framebuffer
+    TraceFramebufferTexture2D,      // target, attachment, texture target, texture, level
+    TraceBlitFramebuffer,           // 8 coordinates, mask, filter
+    TraceReadBuffer,                // mode
+    TraceReadPixels,                // x, y, width, height, format, type,
+                                    // into pack buffer (0/1), u64 pack buffer offset
+
+    // Queries and sync
+    TraceBeginQuery,                // target, query
+    TraceEndQuery,                  // target
+    TraceQueryCounter,              // query, target
+    TraceFenceSync,                 // condition, flags, u64 result
+    TraceClientWaitSync,            // u64 sync, flags, u64 timeout
+    TraceDeleteSync,                // u64 sync
+
+    // Appended, so that existing traces keep their opcodes
+    TraceUniform3fv,                // location, count, 3 * count floats
+    TraceCopyTexSubImage2D,         // target, level, xoffset, yoffset, x, y, width, height
+
+    kTraceOpCount
+};
+
+// Size of the client memory read by glTexImage2D, assuming the default
+// unpack alignment of 4, which the renderer never changes. 0 for formats
+// the trace does not know. The recorder stores this much; the player checks
+// that the blob holds it.
+inline size_t tracePixelBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+    size_t components;
+    switch (format) {
+    case GL_RGBA:            components = 4; break;
+    case GL_RGB:             components = 3; break;
+    case GL_LUMINANCE_ALPHA: components = 2; break;
+    case GL_LUMINANCE:
+    case GL_ALPHA:           components = 1; break;
+    default:                 return 0;
+    }
+    size_t pixel;
+    switch (type) {
+    case GL_UNSIGNED_BYTE:          pixel = components; break;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_5_5_5_1: pixel = 2; break;
+    case GL_FLOAT:                  pixel = 4 * components; break;
+    default:                        return 0;
+    }
+    if (width <= 0 || height <= 0)
+        return 0;
+    size_t row = (width * pixel + 3) & ~static_cast<size_t>(3);
+    return row * (height - 1) + width * pixel;
+}
+
+#endif // GL_TRACE_FORMAT_H
@@ -0,0 +1,697 @@
+#include "gl_trace_player.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Prints the info log of a shader or program that failed on this driver
+// but presumably not on the recording one.
+void reportShader(GLuint shader) {
+    GLint compiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled)
+        return;
+    char log[1024] = "";
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    std::cerr << "Trace shader failed to compile:\n" << log << std::endl;
+}
+
+void reportProgram(GLuint program) {
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked)
+        return;
+    char log[1024] = "";
+    glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+    std::cerr << "Trace program failed to link:\n" << log << std::endl;
+}
+
+} // namespace
+
+TracePlayer::TracePlayer()
+    : pos_(0), failed_(false), calls_(0), program_(0), arrayBuffer_(0) {
+    memset(&header_, 0, sizeof(header_));
+}
+
+TracePlayer::~TracePlayer() {
+}
+
+bool TracePlayer::open(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        std::cerr << "Failed to open trace " << path << std::endl;
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < static_cast<long>(sizeof(TraceHeader))) {
+        std::cerr << "Trace " << path << " is too short" << std::endl;
+        fclose(file);
+        return false;
+    }
+    data_.resize(size);
+    bool read = fread(&data_[0], 1, size, file) == static_cast<size_t>(size);
+    fclose(file);
+    if (!read) {
+        std::cerr << "Failed to read trace " << path << std::endl;
+        return false;
+    }
+
+    memcpy(&header_, &data_[0], sizeof(header_));
+    if (memcmp(header_.magic, "GLTRACE", 8) != 0 || header_.version != kTraceVersion) {
+        std::cerr << path << " is not a version " << kTraceVersion << " GL trace" << std::endl;
+        return false;
+    }
+    pos_ = sizeof(header_);
+    return true;
+}
+
+bool TracePlayer::need(size_t bytes) {
+    if (data_.size() - pos_ < bytes) {
+        if (!failed_)
+            std::cerr << "Trace truncated at byte " << pos_ << std::endl;
+        failed_ = true;
+        pos_ = data_.size();
+        return false;
+    }
+    return true;
+}
+
+uint32_t TracePlayer::u32() {
+    uint32_t value = 0;
+    if (need(sizeof(value))) {
+        memcpy(&value, &data_[pos_], sizeof(value));
+        pos_ += sizeof(value);
+    }
+    return value;
+}
+
+uint64_t TracePlayer::u64() {
+    uint64_t value = 0;
+    if (need(sizeof(value))) {
+        memcpy(&value, &data_[pos_], sizeof(value));
+        pos_ += sizeof(value);
+    }
+    return value;
+}
+
+float TracePlayer::f32() {
+    uint32_t bits = u32();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+const TracePlayer::Blob* TracePlayer::blob(uint64_t hash) {
+    if (hash == 0)
+        return nullptr;
+    std::unordered_map<uint64_t, Blob>::const_iterator it = blobs_.find(hash);
+    if (it == blobs_.end()) {
+        if (!failed_)
+            std::cerr << "Trace refers to missing data at byte " << pos_ << std::endl;
+        failed_ = true;
+        return nullptr;
+    }
+    return &it->second;
+}
+
+const void* TracePlayer::blobData(uint64_t hash) {
+    const Blob* b = blob(hash);
+    return b ? b->data : nullptr;
+}
+
+const void* TracePlayer::blobData(uint64_t hash, uint64_t size) {
+    const Blob* b = blob(hash);
+    if (b && b->size < size) {
+        if (!failed_)
+            std::cerr << "Trace data at byte " << pos_ << " is smaller than the call reads" << std::endl;
+        failed_ = true;
+        return nullptr;
+    }
+    return b ? b->data : nullptr;
+}
+
+GLsizei TracePlayer::readNames() {
+    uint32_t n = u32();
+    if (!need(static_cast<size_t>(n) * sizeof(uint32_t)))
+        return 0;
+    names_.resize(n);
+    objects_.resize(n);
+    for (uint32_t i = 0; i < n; ++i)
+        names_[i] = u32();
+    return static_cast<GLsizei>(n);
+}
+
+void TracePlayer::mapNames(NameMap& map) {
+    for (size_t i = 0; i < names_.size(); ++i)
+        map[names_[i]] = objects_[i];
+}
+
+void TracePlayer::unmapNames(NameMap& map) {
+    for (size_t i = 0; i < names_.size(); ++i) {
+        objects_[i] = lookup(map, names_[i]);
+        map.erase(names_[i]);
+    }
+}
+
+GLuint TracePlayer::lookup(const NameMap& map, GLuint name) {
+    if (name == 0)
+        return 0;
+    NameMap::const_iterator it = map.find(name);
+    return it == map.end() ? 0 : it->second;
+}
+
+GLuint TracePlayer::attrib(GLuint index) const {
+    std::map<std::pair<GLuint, GLint>, GLint>::const_iterator it =
+        attribs_.find(std::make_pair(program_, static_cast<GLint>(index)));
+    return it == attribs_.end() ? index : static_cast<GLuint>(it->second);
+}
+
+GLint TracePlayer::uniform(GLint location) const {
+    std::map<std::pair<GLuint, GLint>, GLint>::const_iterator it =
+        uniforms_.find(std::make_pair(program_, location));
+    return it == uniforms_.end() ? -1 : it->second;
+}
+
+bool TracePlayer::playFrame(uint64_t& swapNs) {
+    bool swapped = false;
+    while (!failed_ && !swapped && pos_ < data_.size()) {
+        unsigned char op = data_[pos_++];
+        if (!playRecord(op, swapNs, swapped))
+            failed_ = true;
+    }
+    return swapped && !failed_;
+}
+
+bool TracePlayer::playRecord(unsigned char op, uint64_t& swapNs, bool& swapped) {
+    ++calls_;
+    switch (op) {
+    case TraceBlob: {
+        uint64_t hash = u64();
+        uint32_t size = u32();
+        if (!need(size))
+            return false;
+        Blob b = { &data_[pos_], size };
+        blobs_[hash] = b;
+        pos_ += size;
+        --calls_;
+        return true;
+    }
+    case TraceSwap:
+        swapNs = u64();
+        swapped = true;
+        --calls_;
+        return true;
+
+    case TraceGenBuffers: {
+        GLsizei n = readNames();
+        if (n) {
+            glGenBuffers(n, &objects_[0]);
+            mapNames(buffers_);
+        }
+        return true;
+    }
+    case TraceDeleteBuffers: {
+        GLsizei n = readNames();
+        if (n) {
+            unmapNames(buffers_);
+            glDeleteBuffers(n, &objects_[0]);
+        }
+        return true;
+    }
+    case TraceGenTextures: {
+        GLsizei n = readNames();
+        if (n) {
+            glGenTextures(n, &objects_[0]);
+            mapNames(textures_);
+        }
+        return true;
+    }
+    case TraceDeleteTextures: {
+        GLsizei n = readNames();
+        if (n) {
+            unmapNames(textures_);
+            glDeleteTextures(n, &objects_[0]);
+        }
+        return true;
+    }
+    case TraceGenFramebuffers: {
+        GLsizei n = readNames();
+        if (n) {
+            glGenFramebuffers(n, &objects_[0]);
+            mapNames(framebuffers_);
+        }
+        return true;
+    }
+    case TraceDeleteFramebuffers: {
+        GLsizei n = readNames();
+        if (n) {
+            unmapNames(framebuffers_);
+            glDeleteFramebuffers(n, &objects_[0]);
+        }
+        return true;
+    }
+
+    case TraceBindBuffer: {
+        GLenum target = u32();
+        GLuint buffer = lookup(buffers_, u32());
+        if (target == GL_ARRAY_BUFFER)
+            arrayBuffer_ = buffer;
+        glBindBuffer(target, buffer);
+        return true;
+    }
+    case TraceBufferData: {
+        GLenum target = u32();
+        uint64_t size = u64();
+        uint64_t hash = u64();
+        const void* data = blobData(hash, size);
+        GLenum usage = u32();
+        if (hash && !data)
+            return false;
+        glBufferData(target, static_cast<GLsizeiptr>(size), data, usage);
+        return true;
+    }
+    case TraceBufferSubData: {
+        GLenum target = u32();
+        uint64_t offset = u64();
+        uint64_t size = u64();
+        uint64_t hash = u64();
+        const void* data = blobData(hash, size);
+        if (hash && !data)
+            return false;
+        if (data)
+            glBufferSubData(target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+        return true;
+    }
+
+    case TraceEnableVertexAttribArray:
+        glEnableVertexAttribArray(attrib(u32()));
+        return true;
+    case TraceDisableVertexAttribArray:
+        glDisableVertexAttribArray(attrib(u32()));
+        return true;
+    case TraceVertexAttribPointer: {
+        GLuint index = attrib(u32());
+        GLint size = i32();
+        GLenum type = u32();
+        GLboolean normalized = static_cast<GLboolean>(u32());
+        GLsizei stride = i32();
+        uint64_t offset = u64();
+        glVertexAttribPointer(index, size, type, normalized, stride,
+                              reinterpret_cast<const void*>(static_cast<uintptr_t>(offset)));
+        return true;
+    }
+    case TraceVertexAttribClientArray: {
+        GLuint index = attrib(u32());
+        GLint size = i32();
+        GLenum type = u32();
+        GLboolean normalized = static_cast<GLboolean>(u32());
+        GLsizei stride = i32();
+        const void* data = blobData(u64());
+        if (!data)
+            return false;
+        // Client pointers are only taken while no buffer is bound.
+        if (arrayBuffer_)
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glVertexAttribPointer(index, size, type, normalized, stride, data);
+        if (arrayBuffer_)
+            glBindBuffer(GL_ARRAY_BUFFER, arrayBuffer_);
+        return true;
+    }
+
+    case TraceDrawArrays: {
+        GLenum mode = u32();
+        GLint first = i32();
+        GLsizei count = i32();
+        glDrawArrays(mode, first, count);
+        return true;
+    }
+    case TraceDrawElements: {
+        GLenum mode = u32();
+        GLsizei count = i32();
+        GLenum type = u32();
+        uint64_t offset = u64();
+        glDrawElements(mode, count, type, reinterpret_cast<const void*>(static_cast<uintptr_t>(offset)));
+        return true;
+    }
+    case TraceDrawElementsClient: {
+        GLenum mode = u32();
+        GLsizei count = i32();
+        GLenum type = u32();
+        const void* indices = blobData(u64());
+        if (!indices)
+            return false;
+        glDrawElements(mode, count, type, indices);
+        return true;
+    }
+    case TraceClear:
+        glClear(u32());
+        return true;
+    case TraceClearColor: {
+        GLfloat r = f32();
+        GLfloat g = f32();
+        GLfloat b = f32();
+        GLfloat a = f32();
+        glClearColor(r, g, b, a);
+        return true;
+    }
+    case TraceViewport: {
+        GLint x = i32();
+        GLint y = i32();
+        GLsizei width = i32();
+        GLsizei height = i32();
+        glViewport(x, y, width, height);
+        return true;
+    }
+    case TraceScissor: {
+        GLint x = i32();
+        GLint y = i32();
+        GLsizei width = i32();
+        GLsizei height = i32();
+        glScissor(x, y, width, height);
+        return true;
+    }
+    case TraceEnable:
+        glEnable(u32());
+        return true;
+    case TraceDisable:
+        glDisable(u32());
+        return true;
+    case TraceBlendFunc: {
+        GLenum sfactor = u32();
+        GLenum dfactor = u32();
+        glBlendFunc(sfactor, dfactor);
+        return true;
+    }
+    case TraceFinish:
+        glFinish();
+        return true;
+
+    case TraceCreateShader: {
+        GLenum type = u32();
+        GLuint name = u32();
+        shaders_[name] = glCreateShader(type);
+        return true;
+    }
+    case TraceShaderSource: {
+        GLuint shader = lookup(shaders_, u32());
+        const Blob* source = blob(u64());
+        if (!source)
+            return false;
+        const GLchar* text = reinterpret_cast<const GLchar*>(source->data);
+        GLint length = static_cast<GLint>(source->size);
+        glShaderSource(shader, 1, &text, &length);
+        return true;
+    }
+    case TraceCompileShader: {
+        GLuint shader = lookup(shaders_, u32());
+        glCompileShader(shader);
+        reportShader(shader);
+        return true;
+    }
+    case TraceDeleteShader: {
+        GLuint name = u32();
+        glDeleteShader(lookup(shaders_, name));
+        shaders_.erase(name);
+        return true;
+    }
+    case TraceCreateProgram:
+        programs_[u32()] = glCreateProgram();
+        return true;
+    case TraceAttachShader: {
+        GLuint program = lookup(programs_, u32());
+        GLuint shader = lookup(shaders_, u32());
+        glAttachShader(program, shader);
+        return true;
+    }
+    case TraceLinkProgram: {
+        GLuint program = lookup(programs_, u32());
+        glLinkProgram(program);
+        reportProgram(program);
+        return true;
+    }
+    case TraceDeleteProgram: {
+        GLuint name = u32();
+        glDeleteProgram(lookup(programs_, name));
+        programs_.erase(name);
+        return true;
+    }
+    case TraceUseProgram:
+        program_ = u32();
+        glUseProgram(lookup(programs_, program_));
+        return true;
+    case TraceGetUniformLocation:
+    case TraceGetAttribLocation: {
+        GLuint program = u32();
+        const Blob* name = blob(u64());
+        GLint recorded = i32();
+        if (!name)
+            return false;
+        std::string text(reinterpret_cast<const char*>(name->data), name->size);
+        if (op == TraceGetUniformLocation)
+            uniforms_[std::make_pair(program, recorded)] = glGetUniformLocation(lookup(programs_, program), text.c_str());
+        else if (recorded >= 0)
+            attribs_[std::make_pair(program, recorded)] = glGetAttribLocation(lookup(programs_, program), text.c_str());
+        return true;
+    }
+    case TraceUniform1f: {
+        GLint location = uniform(i32());
+        GLfloat x = f32();
+        glUniform1f(location, x);
+        return true;
+    }
+    case TraceUniform2f: {
+        GLint location = uniform(i32());
+        GLfloat x = f32();
+        GLfloat y = f32();
+        glUniform2f(location, x, y);
+        return true;
+    }
+    case TraceUniform1i: {
+        GLint location = uniform(i32());
+        GLint x = i32();
+        glUniform1i(location, x);
+        return true;
+    }
+    case TraceUniform3fv: {
+        GLint location = uniform(i32());
+        GLsizei count = i32();
+        if (count < 0 || !need(static_cast<size_t>(count) * 3 * sizeof(GLfloat)))
+            return false;
+        uniformValues_.resize(static_cast<size_t>(count) * 3);
+        for (size_t i = 0; i < uniformValues_.size(); ++i)
+            uniformValues_[i] = f32();
+        if (count)
+            glUniform3fv(location, count, &uniformValues_[0]);
+        return true;
+    }
+
+    case TraceActiveTexture:
+        glActiveTexture(u32());
+        return true;
+    case TraceBindTexture: {
+        GLenum target = u32();
+        GLuint texture = lookup(textures_, u32());
+        glBindTexture(target, texture);
+        return true;
+    }
+    case TraceTexParameteri: {
+        GLenum target = u32();
+        GLenum pname = u32();
+        GLint param = i32();
+        glTexParameteri(target, pname, param);
+        return true;
+    }
+    case TraceTexImage2D: {
+        GLenum target = u32();
+        GLint level = i32();
+        GLint internalFormat = i32();
+        GLsizei width = i32();
+        GLsizei height = i32();
+        GLint border = i32();
+        GLenum format = u32();
+        GLenum type = u32();
+        uint64_t hash = u64();
+        // The recorder only stores pixels in formats whose size it knows.
+        size_t bytes = tracePixelBytes(width, height, format, type);
+        const void* pixels = blobData(hash, bytes);
+        if (hash && (!pixels || !bytes))
+            return false;
+        glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+        return true;
+    }
+    case TraceBindFramebuffer: {
+        GLenum target = u32();
+        GLuint framebuffer = lookup(framebuffers_, u32());
+        glBindFramebuffer(target, framebuffer);
+        return true;
+    }
+    case TraceFramebufferTexture2D: {
+        GLenum target = u32();
+        GLenum attachment = u32();
+        GLenum textarget = u32();
+        GLuint texture = lookup(textures_, u32());
+        GLint level = i32();
+        glFramebufferTexture2D(target, attachment, textarget, texture, level);
+        return true;
+    }
+    case TraceReadPixels: {
+        GLint x = i32();
+        GLint y = i32();
+        GLsizei width = i32();
+        GLsizei height = i32();
+        GLenum format = u32();
+        GLenum type = u32();
+        bool intoBuffer = u32() != 0;
+        uint64_t offset = u64();
+        void* pixels = reinterpret_cast<void*>(static_cast<uintptr_t>(offset));
+        if (!intoBuffer) {
+            // Room for four floats per pixel, the largest readable format.
+            readback_.resize(static_cast<size_t>(width) * height * 16 + 16);
+            pixels = &readback_[0];
+        }
+        glReadPixels(x, y, width, height, format, type, pixels);
+        return true;
+    }
+    case TraceCopyTexSubImage2D: {
+        GLenum target = u32();
+        GLint level = i32();
+        GLint xoffset = i32();
+        GLint yoffset = i32();
+        GLint x = i32();
+        GLint y = i32();
+        GLsizei width = i32();
+        GLsizei height = i32();
+        glCopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width, height);
+        return true;
+    }
+
+#ifndef USE_GLES2
+    case TraceGenVertexArrays: {
+        GLsizei n = readNames();
+        if (n) {
+            glGenVertexArrays(n, &objects_[0]);
+            mapNames(vertexArrays_);
+        }
+        return true;
+    }
+    case TraceDeleteVertexArrays: {
+        GLsizei n = readNames();
+        if (n) {
+            unmapNames(vertexArrays_);
+            glDeleteVertexArrays(n, &objects_[0]);
+        }
+        return true;
+    }
+    case TraceGenQueries: {
+        GLsizei n = readNames();
+        if (n) {
+            glGenQueries(n, &objects_[0]);
+            mapNames(queries_);
+        }
+        return true;
+    }
+    case TraceDeleteQueries: {
+        GLsizei n = readNames();
+        if (n) {
+            unmapNames(queries_);
+            glDeleteQueries(n, &objects_[0]);
+        }
+        return true;
+    }
+    case TraceMapBufferRange: {
+        GLenum target = u32();
+        uint64_t offset = u64();
+        uint64_t length = u64();
+        GLbitfield access = u32();
+        Mapping& mapping = mappings_[target];
+        mapping.pointer = glMapBufferRange(target, static_cast<GLintptr>(offset),
+                                           static_cast<GLsizeiptr>(length), access);
+        mapping.length = length;
+        return true;
+    }
+    case TraceUnmapBuffer: {
+        GLenum target = u32();
+        uint64_t hash = u64();
+        const Blob* written = blob(hash);
+        Mapping mapping = mappings_[target];
+        mappings_.erase(target);
+        // The recorder stores the whole mapped range, so anything else is
+        // a corrupt trace and must not be copied into the mapping.
+        bool ok = !hash || written;
+        if (written && written->size != mapping.length) {
+            std::cerr << "Trace data at byte " << pos_ << " does not match the mapped range" << std::endl;
+            ok = false;
+        }
+        if (ok && written && mapping.pointer)
+            memcpy(mapping.pointer, written->data, written->size);
+        glUnmapBuffer(target);
+        return ok;
+    }
+    case TraceBindVertexArray:
+        glBindVertexArray(lookup(vertexArrays_, u32()));
+        return true;
+    case TraceBlitFramebuffer: {
+        GLint coords[8];
+        for (int i = 0; i < 8; ++i)
+            coords[i] = i32();
+        GLbitfield mask = u32();
+        GLenum filter = u32();
+        glBlitFramebuffer(coords[0], coords[1], coords[2], coords[3],
+                          coords[4], coords[5], coords[6], coords[7], mask, filter);
+        return true;
+    }
+    case TraceReadBuffer:
+        glReadBuffer(u32());
+        return true;
+    case TraceBeginQuery: {
+        GLenum target = u32();
+        GLuint query = lookup(queries_, u32());
+        glBeginQuery(target, query);
+        return true;
+    }
+    case TraceEndQuery:
+        glEndQuery(u32());
+        return true;
+    case TraceQueryCounter: {
+        GLuint query = lookup(queries_, u32());
+        GLenum target = u32();
+        glQueryCounter(query, target);
+        return true;
+    }
+    case TraceFenceSync: {
+        GLenum condition = u32();
+        GLbitfield flags = u32();
+        uint64_t name = u64();
+        syncs_[name] = glFenceSync(condition, flags);
+        return true;
+    }
+    case TraceClientWaitSync: {
+        uint64_t name = u64();
+        GLbitfield flags = u32();
+        GLuint64 timeout = u64();
+        std::unordered_map<uint64_t, void*>::const_iterator it = syncs_.find(name);
+        if (it != syncs_.end())
+            glClientWaitSync(static_cast<GLsync>(it->second), flags, timeout);
+        return true;
+    }
+    case TraceDeleteSync: {
+        uint64_t name = u64();
+        std::unordered_map<uint64_t, void*>::iterator it = syncs_.find(name);
+        if (it != syncs_.end()) {
+            glDeleteSync(static_cast<GLsync>(it->second));
+            syncs_.erase(it);
+        }
+        return true;
+    }
+#endif
+
+    default:
+        std::cerr << "Trace record " << static_cast<int>(op) << " at byte " << pos_ - 1
+                  << " is not supported by this player" << std::endl;
+        return false;
+    }
+}
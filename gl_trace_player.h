@@ -0,0 +1,111 @@
+#ifndef GL_TRACE_PLAYER_H
+#define GL_TRACE_PLAYER_H
+
+#include "gl_platform.h"
+#include "gl_trace_format.h"
+
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Plays back a trace written by the recorder in gl_trace.cpp against the
+// current context, one frame at a time. The whole trace is read into
+// memory first, so playback measures the driver and not the disk.
+//
+// Object names, uniform and attribute locations and sync objects of the
+// recording are mapped onto the ones the current driver hands out. Blob
+// data is passed to GL straight from the loaded trace.
+class TracePlayer {
+public:
+    TracePlayer();
+    ~TracePlayer();
+
+    // Loads and validates the trace. The context does not have to be
+    // current yet.
+    bool open(const char* path);
+
+    const TraceHeader& header() const { return header_; }
+
+    // Issues the calls of the next frame, up to its swap, and returns the
+    // time of that swap relative to the start of the recording. Returns
+    // false at the end of the trace or on a malformed record; calls after
+    // the last swap are played before returning false.
+    bool playFrame(uint64_t& swapNs);
+
+    bool failed() const { return failed_; }
+    unsigned long callsPlayed() const { return calls_; }
+
+private:
+    TracePlayer(const TracePlayer&);
+    TracePlayer& operator=(const TracePlayer&);
+
+    struct Blob {
+        const unsigned char* data;
+        uint32_t size;
+    };
+
+    // A buffer range mapped by a recorded glMapBufferRange.
+    struct Mapping {
+        Mapping() : pointer(nullptr), length(0) {}
+        void* pointer;
+        uint64_t length;
+    };
+
+    typedef std::unordered_map<GLuint, GLuint> NameMap;
+
+    bool playRecord(unsigned char op, uint64_t& swapNs, bool& swapped);
+
+    bool need(size_t bytes);
+    uint32_t u32();
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    uint64_t u64();
+    float f32();
+    const Blob* blob(uint64_t hash);
+    const void* blobData(uint64_t hash);
+    // Also fails if the blob is smaller than size, the bytes GL will read.
+    const void* blobData(uint64_t hash, uint64_t size);
+
+    // Object name lists: readNames() loads the recorded names and sizes
+    // objects_ for them; after a glGen*, mapNames() pairs them with the new
+    // names in objects_. unmapNames() translates them into objects_ for a
+    // glDelete* and forgets them.
+    GLsizei readNames();
+    void mapNames(NameMap& map);
+    void unmapNames(NameMap& map);
+    static GLuint lookup(const NameMap& map, GLuint name);
+    GLuint attrib(GLuint index) const;
+    GLint uniform(GLint location) const;
+
+    TraceHeader header_;
+    std::vector<unsigned char> data_;
+    size_t pos_;
+    bool failed_;
+    unsigned long calls_;
+
+    std::unordered_map<uint64_t, Blob> blobs_;
+    NameMap buffers_;
+    NameMap textures_;
+    NameMap framebuffers_;
+    NameMap vertexArrays_;
+    NameMap queries_;
+    NameMap shaders_;
+    NameMap programs_;
+    // Recorded program and location to the location in this context.
+    // Attribute lookups use the program current at the call.
+    std::map<std::pair<GLuint, GLint>, GLint> attribs_;
+    std::map<std::pair<GLuint, GLint>, GLint> uniforms_;
+    std::unordered_map<uint64_t, void*> syncs_;
+    std::unordered_map<GLenum, Mapping> mappings_;
+
+    GLuint program_;      // current program, as named in the recording
+    GLuint arrayBuffer_;  // current GL_ARRAY_BUFFER binding of this context
+    std::vector<GLuint> names_;
+    std::vector<GLuint> objects_;
+    std::vector<unsigned char> readback_;
+    std::vector<GLfloat> uniformValues_;
+};
+
+#endif // GL_TRACE_PLAYER_H
@@ -0,0 +1,258 @@
+// Replays a GL trace recorded with --gl-trace and reports frame times.
+//
+//   gl_trace_replay [--timing=fast|original] [--headless] TRACE
+//
+// The desktop build replays GL 3.3 traces in a GLFW window, or a hidden
+// one with --headless. Built with USE_GLES2 it replays GLES2 traces, such
+// as those from the VxWorks target, into an EGL pbuffer; that needs no
+// window system at all (e.g. EGL_PLATFORM=surfaceless with Mesa).
+//
+// With --timing=fast (the default) frames are issued back to back with
+// vsync off, which benchmarks the driver. With --timing=original each
+// frame waits for its recorded swap time, reproducing the original load.
+#include "gl_platform.h"
+#include "gl_trace_player.h"
+#include "platform_timer.h"
+
+#ifndef USE_GLES2
+#include <GLFW/glfw3.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct ReplayOptions {
+    ReplayOptions() : originalTiming(false), headless(false), path(nullptr) {}
+
+    bool originalTiming;
+    bool headless;
+    const char* path;
+};
+
+bool parseArguments(int argc, char* argv[], ReplayOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--timing=fast") == 0) {
+            options.originalTiming = false;
+        } else if (strcmp(arg, "--timing=original") == 0) {
+            options.originalTiming = true;
+        } else if (strcmp(arg, "--headless") == 0) {
+            options.headless = true;
+        } else if (arg[0] != '-' && !options.path) {
+            options.path = arg;
+        } else {
+            options.path = nullptr;
+            break;
+        }
+    }
+    if (options.path)
+        return true;
+    std::cerr << "Usage: " << argv[0] << " [--timing=fast|original] [--headless] TRACE" << std::endl;
+    return false;
+}
+
+// The context the trace is played into.
+class ReplayContext {
+public:
+    ReplayContext();
+    ~ReplayContext();
+
+    bool create(const TraceHeader& header, const ReplayOptions& options);
+    void setSwapInterval(int interval);
+    void swap();
+
+private:
+    ReplayContext(const ReplayContext&);
+    ReplayContext& operator=(const ReplayContext&);
+
+#ifdef USE_GLES2
+    EGLDisplay display_;
+    EGLSurface surface_;
+    EGLContext context_;
+#else
+    GLFWwindow* window_;
+#endif
+};
+
+#ifdef USE_GLES2
+ReplayContext::ReplayContext()
+    : display_(EGL_NO_DISPLAY), surface_(EGL_NO_SURFACE), context_(EGL_NO_CONTEXT) {
+}
+
+ReplayContext::~ReplayContext() {
+    if (display_ == EGL_NO_DISPLAY)
+        return;
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context_ != EGL_NO_CONTEXT)
+        eglDestroyContext(display_, context_);
+    if (surface_ != EGL_NO_SURFACE)
+        eglDestroySurface(display_, surface_);
+    eglTerminate(display_);
+}
+
+bool ReplayContext::create(const TraceHeader& header, const ReplayOptions& options) {
+    (void)options;
+    if (header.api != TraceGLES2) {
+        std::cerr << "This replayer plays GLES2 traces; use the desktop build for GL 3.3 traces" << std::endl;
+        return false;
+    }
+    display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, &major, &minor)) {
+        std::cerr << "Failed to initialize EGL" << std::endl;
+        display_ = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 16,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display_, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        std::cerr << "No EGL config for a GLES2 pbuffer" << std::endl;
+        return false;
+    }
+    EGLint surfaceAttribs[] = {
+        EGL_WIDTH, static_cast<EGLint>(std::max<uint32_t>(header.width, 1)),
+        EGL_HEIGHT, static_cast<EGLint>(std::max<uint32_t>(header.height, 1)),
+        EGL_NONE
+    };
+    surface_ = eglCreatePbufferSurface(display_, config, surfaceAttribs);
+    EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, contextAttribs);
+    if (surface_ == EGL_NO_SURFACE || context_ == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display_, surface_, surface_, context_)) {
+        std::cerr << "Failed to create a GLES2 pbuffer context" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ReplayContext::setSwapInterval(int interval) {
+    eglSwapInterval(display_, interval);
+}
+
+void ReplayContext::swap() {
+    eglSwapBuffers(display_, surface_);
+}
+#else
+ReplayContext::ReplayContext()
+    : window_(nullptr) {
+}
+
+ReplayContext::~ReplayContext() {
+    if (window_)
+        glfwDestroyWindow(window_);
+    glfwTerminate();
+}
+
+bool ReplayContext::create(const TraceHeader& header, const ReplayOptions& options) {
+    if (header.api != TraceGL33) {
+        std::cerr << "This replayer plays GL 3.3 traces; build it with USE_GLES2 for GLES2 traces" << std::endl;
+        return false;
+    }
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return false;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    if (options.headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window_ = glfwCreateWindow(std::max<uint32_t>(header.width, 1), std::max<uint32_t>(header.height, 1),
+                               "GL trace replay", NULL, NULL);
+    if (!window_) {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return false;
+    }
+    glfwMakeContextCurrent(window_);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        std::cerr << "Failed to initialize GLEW" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ReplayContext::setSwapInterval(int interval) {
+    glfwSwapInterval(interval);
+}
+
+void ReplayContext::swap() {
+    glfwSwapBuffers(window_);
+    glfwPollEvents();
+}
+#endif
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ReplayOptions options;
+    if (!parseArguments(argc, argv, options))
+        return -1;
+
+    TracePlayer player;
+    if (!player.open(options.path))
+        return -1;
+    const TraceHeader& header = player.header();
+
+    ReplayContext context;
+    if (!context.create(header, options))
+        return -1;
+    context.setSwapInterval(options.originalTiming ? 1 : 0);
+    std::cout << "Replaying " << options.path << " (" << header.width << "x" << header.height << ") on "
+              << glGetString(GL_RENDERER) << ", " << (options.originalTiming ? "original" : "fast")
+              << " timing" << std::endl;
+
+    std::vector<double> frameMs;
+    uint64_t startNs = monotonicNowNs();
+    uint64_t frameStartNs = startNs;
+    uint64_t swapNs = 0;
+    while (player.playFrame(swapNs)) {
+        if (options.originalTiming) {
+            uint64_t dueNs = startNs + swapNs;
+            uint64_t now = monotonicNowNs();
+            if (dueNs > now)
+                sleepForNs(dueNs - now);
+        }
+        context.swap();
+        uint64_t now = monotonicNowNs();
+        frameMs.push_back(nsToMs(now - frameStartNs));
+        frameStartNs = now;
+    }
+    glFinish();
+    double totalMs = nsToMs(monotonicNowNs() - startNs);
+    if (player.failed())
+        return -1;
+
+    std::sort(frameMs.begin(), frameMs.end());
+    std::cout << "Replayed " << frameMs.size() << " frames, " << player.callsPlayed() << " calls in "
+              << totalMs << " ms (" << (totalMs > 0.0 ? frameMs.size() * 1000.0 / totalMs : 0.0)
+              << " fps)" << std::endl;
+    if (!frameMs.empty()) {
+        std::cout << "Frame time: p50 " << percentile(frameMs, 0.5) << " ms, p99 "
+                  << percentile(frameMs, 0.99) << " ms, max " << frameMs.back() << " ms" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "gpu_reset.h"
+#include "async_log.h"
+
+#include <cstring>
+
+namespace {
+
+#ifdef USE_GLES2
+const GLenum kGuiltyReset = GL_GUILTY_CONTEXT_RESET_EXT;
+const GLenum kInnocentReset = GL_INNOCENT_CONTEXT_RESET_EXT;
+#else
+const GLenum kGuiltyReset = GL_GUILTY_CONTEXT_RESET;
+const GLenum kInnocentReset = GL_INNOCENT_CONTEXT_RESET;
+#endif
+
+const char* resetCause(GLenum status) {
+    if (status == kGuiltyReset)
+        return "caused by this context";
+    if (status == kInnocentReset)
+        return "caused elsewhere";
+    return "cause unknown";
+}
+
+#ifdef USE_GLES2
+bool hasGlExtension(const char* name) {
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    return extensions && strstr(extensions, name);
+}
+#endif
+
+} // namespace
+
+GpuResetDetector::GpuResetDetector()
+    : resetStatus_(nullptr), lost_(false) {
+    GLint strategy = 0;
+#ifdef USE_GLES2
+    if (hasGlExtension("GL_EXT_robustness")) {
+        resetStatus_ = reinterpret_cast<ResetStatusFn>(eglGetProcAddress("glGetGraphicsResetStatusEXT"));
+    } else if (hasGlExtension("GL_KHR_robustness")) {
+        resetStatus_ = reinterpret_cast<ResetStatusFn>(eglGetProcAddress("glGetGraphicsResetStatusKHR"));
+    }
+    if (resetStatus_)
+        glGetIntegerv(GL_RESET_NOTIFICATION_STRATEGY_EXT, &strategy);
+    if (strategy != GL_LOSE_CONTEXT_ON_RESET_EXT)
+        resetStatus_ = nullptr;
+#else
+    if (GLEW_VERSION_4_5 || GLEW_KHR_robustness) {
+        resetStatus_ = glGetGraphicsResetStatus;
+        glGetIntegerv(GL_RESET_NOTIFICATION_STRATEGY, &strategy);
+    } else if (GLEW_ARB_robustness) {
+        resetStatus_ = glGetGraphicsResetStatusARB;
+        glGetIntegerv(GL_RESET_NOTIFICATION_STRATEGY_ARB, &strategy);
+    }
+    if (strategy != GL_LOSE_CONTEXT_ON_RESET)
+        resetStatus_ = nullptr;
+#endif
+    if (!resetStatus_)
+        LogLine(LogInfo) << "GPU reset notification unavailable, resets are not recovered from";
+}
+
+bool GpuResetDetector::contextLost() {
+    if (lost_ || !resetStatus_)
+        return lost_;
+    GLenum status = resetStatus_();
+    if (status == GL_NO_ERROR)
+        return false;
+    lost_ = true;
+    LogLine(LogError) << "GPU reset (" << resetCause(status) << "), context lost";
+    return true;
+}
+
+#ifdef USE_GLES2
+EGLContext createRobustContext(EGLDisplay display, EGLConfig config) {
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    bool robust = extensions && strstr(extensions, "EGL_EXT_create_context_robustness");
+    EGLint attribs[] = {
+        EGL_CONTEXT_CLIENT_VERSION, 2,
+        EGL_NONE, EGL_NONE,
+        EGL_NONE
+    };
+    if (robust) {
+        attribs[2] = EGL_CONTEXT_OPENGL_RESET_NOTIFICATION_STRATEGY_EXT;
+        attribs[3] = EGL_LOSE_CONTEXT_ON_RESET_EXT;
+    }
+    return eglCreateContext(display, config, EGL_NO_CONTEXT, attribs);
+}
+#endif
@@ -0,0 +1,49 @@
+#ifndef GPU_RESET_H
+#define GPU_RESET_H
+
+#include "gl_platform.h"
+
+// Tells the render loop that the GPU was reset and the context is lost.
+// A context created with the lose-context-on-reset strategy stops working
+// after a reset, and glGetGraphicsResetStatus says so: from then on every
+// GL call is a no-op and the only way forward is a new context with all
+// objects created again.
+//
+// The query comes from GL_EXT_robustness or GL_KHR_robustness on GLES2,
+// and from GL 4.5, KHR_robustness or ARB_robustness on desktop GL. Without
+// it, or on a context that was not created for reset notification, the
+// detector stays inactive and a reset goes unnoticed, as it did before.
+class GpuResetDetector {
+public:
+    // Looks up the query for the current context.
+    GpuResetDetector();
+
+    bool active() const { return resetStatus_ != nullptr; }
+
+    // Whether the context has been lost to a reset. Cheap enough to call
+    // every loop iteration; the first time it returns true it logs whether
+    // this context caused the reset.
+    bool contextLost();
+
+private:
+    GpuResetDetector(const GpuResetDetector&);
+    GpuResetDetector& operator=(const GpuResetDetector&);
+
+#ifdef USE_GLES2
+    typedef GLenum (GL_APIENTRYP ResetStatusFn)(void);
+#else
+    typedef GLenum (GLAPIENTRY* ResetStatusFn)(void);
+#endif
+
+    ResetStatusFn resetStatus_;
+    bool lost_;
+};
+
+#ifdef USE_GLES2
+// Creates a GLES2 context that is lost on a GPU reset, and so can tell the
+// render loop about it, where the display has
+// EGL_EXT_create_context_robustness; a plain context otherwise.
+EGLContext createRobustContext(EGLDisplay display, EGLConfig config);
+#endif
+
+#endif // GPU_RESET_H
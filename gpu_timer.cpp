@@ -0,0 +1,58 @@
+#include "gpu_timer.h"
+
+GpuTimer::GpuTimer()
+    : available_(false), head_(0), pending_(0) {
+#ifndef USE_GLES2
+    // Timer queries are core in GL 3.3.
+    glGenQueries(kQueries, queries_);
+    available_ = true;
+#endif
+}
+
+GpuTimer::~GpuTimer() {
+#ifndef USE_GLES2
+    glDeleteQueries(kQueries, queries_);
+#endif
+}
+
+void GpuTimer::begin() {
+#ifndef USE_GLES2
+    // Drop the oldest result rather than overwrite a query in flight.
+    if (pending_ == kQueries) {
+        double discarded;
+        if (!poll(discarded))
+            return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries_[head_]);
+#endif
+}
+
+void GpuTimer::end() {
+#ifndef USE_GLES2
+    if (pending_ == kQueries)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    head_ = (head_ + 1) % kQueries;
+    ++pending_;
+#endif
+}
+
+bool GpuTimer::poll(double& ms) {
+#ifndef USE_GLES2
+    if (pending_ == 0)
+        return false;
+    GLuint query = queries_[(head_ - pending_ + kQueries) % kQueries];
+    GLint ready = 0;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &ready);
+    if (!ready)
+        return false;
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+    --pending_;
+    ms = ns / 1.0e6;
+    return true;
+#else
+    (void)ms;
+    return false;
+#endif
+}
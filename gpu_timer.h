@@ -0,0 +1,38 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "gl_platform.h"
+
+// Measures GPU execution time of a span of commands with GL_TIME_ELAPSED
+// queries. Results are collected a few frames later from a small ring of
+// queries, so reading them never stalls the pipeline.
+//
+// GLES2 has no timer queries in core; there available() is false and the
+// caller has to fall back to CPU-side timing.
+class GpuTimer {
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    bool available() const { return available_; }
+
+    void begin();
+    void end();
+
+    // Retrieves the oldest finished measurement, in milliseconds.
+    // Returns false when no result is ready yet.
+    bool poll(double& ms);
+
+private:
+    GpuTimer(const GpuTimer&);
+    GpuTimer& operator=(const GpuTimer&);
+
+    static const int kQueries = 4;
+
+    bool available_;
+    GLuint queries_[kQueries];
+    int head_;     // next query to begin
+    int pending_;  // queries issued but not yet read back
+};
+
+#endif // GPU_TIMER_H
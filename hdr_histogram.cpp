@@ -0,0 +1,125 @@
+#include "hdr_histogram.h"
+
+#include <cmath>
+
+namespace {
+
+// Position of the highest set bit plus one; value must be non-zero.
+int bitLength(uint64_t value) {
+    return 64 - __builtin_clzll(value);
+}
+
+} // namespace
+
+HdrHistogram::HdrHistogram(uint64_t highestValue, int significantDigits)
+    : highestValue_(highestValue < 2 ? 2 : highestValue),
+      totalCount_(0), min_(UINT64_MAX), max_(0), sum_(0.0) {
+    if (significantDigits < 1)
+        significantDigits = 1;
+    if (significantDigits > 5)
+        significantDigits = 5;
+
+    // Enough sub-buckets to tell 10^digits values apart at any magnitude.
+    uint64_t largestSingleUnitResolution = 2;
+    for (int i = 0; i < significantDigits; ++i)
+        largestSingleUnitResolution *= 10;
+    int subBucketCountMagnitude = bitLength(largestSingleUnitResolution - 1);
+    subBucketHalfCountMagnitude_ = subBucketCountMagnitude - 1;
+    uint64_t subBucketCount = 1ull << subBucketCountMagnitude;
+    subBucketHalfCount_ = subBucketCount / 2;
+    subBucketMask_ = subBucketCount - 1;
+
+    // Each bucket covers twice the range of the one before it.
+    int bucketCount = 1;
+    uint64_t trackable = subBucketCount;
+    while (trackable <= highestValue_) {
+        if (trackable > (UINT64_MAX >> 1)) {
+            ++bucketCount;
+            break;
+        }
+        trackable <<= 1;
+        ++bucketCount;
+    }
+    counts_.assign((bucketCount + 1) * subBucketHalfCount_, 0);
+}
+
+size_t HdrHistogram::countsIndex(uint64_t value) const {
+    int bucketIndex = bitLength(value | subBucketMask_) - (subBucketHalfCountMagnitude_ + 1);
+    uint64_t subBucketIndex = value >> bucketIndex;
+    return (static_cast<size_t>(bucketIndex + 1) << subBucketHalfCountMagnitude_) +
+           static_cast<size_t>(subBucketIndex - subBucketHalfCount_);
+}
+
+uint64_t HdrHistogram::valueFromIndex(size_t index) const {
+    int bucketIndex = static_cast<int>(index >> subBucketHalfCountMagnitude_) - 1;
+    uint64_t subBucketIndex = (index & (subBucketHalfCount_ - 1)) + subBucketHalfCount_;
+    if (bucketIndex < 0) {
+        subBucketIndex -= subBucketHalfCount_;
+        bucketIndex = 0;
+    }
+    return subBucketIndex << bucketIndex;
+}
+
+uint64_t HdrHistogram::highestEquivalentValue(uint64_t value) const {
+    // The bucket containing value is 2^bucketIndex wide.
+    int bucketIndex = bitLength(value | subBucketMask_) - (subBucketHalfCountMagnitude_ + 1);
+    uint64_t lowest = (value >> bucketIndex) << bucketIndex;
+    return lowest + (1ull << bucketIndex) - 1;
+}
+
+void HdrHistogram::record(uint64_t value) {
+    if (value > highestValue_)
+        value = highestValue_;
+    ++counts_[countsIndex(value)];
+    ++totalCount_;
+    sum_ += static_cast<double>(value);
+    if (value < min_)
+        min_ = value;
+    if (value > max_)
+        max_ = value;
+}
+
+void HdrHistogram::reset() {
+    for (size_t i = 0; i < counts_.size(); ++i)
+        counts_[i] = 0;
+    totalCount_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+    sum_ = 0.0;
+}
+
+void HdrHistogram::add(const HdrHistogram& other) {
+    if (other.counts_.size() != counts_.size())
+        return;
+    for (size_t i = 0; i < counts_.size(); ++i)
+        counts_[i] += other.counts_[i];
+    totalCount_ += other.totalCount_;
+    sum_ += other.sum_;
+    if (other.totalCount_ && other.min_ < min_)
+        min_ = other.min_;
+    if (other.max_ > max_)
+        max_ = other.max_;
+}
+
+double HdrHistogram::mean() const {
+    return totalCount_ ? sum_ / totalCount_ : 0.0;
+}
+
+uint64_t HdrHistogram::valueAtPercentile(double percentile) const {
+    if (!totalCount_)
+        return 0;
+    if (percentile > 100.0)
+        percentile = 100.0;
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * totalCount_));
+    if (target < 1)
+        target = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= target) {
+            uint64_t value = highestEquivalentValue(valueFromIndex(i));
+            return value < max_ ? value : max_;
+        }
+    }
+    return max_;
+}
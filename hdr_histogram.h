@@ -0,0 +1,50 @@
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// High dynamic range histogram of non-negative integer values, after Gil
+// Tene's HdrHistogram. Values are grouped into buckets whose width grows
+// with the value, so every recorded value keeps the given number of
+// significant decimal digits from 1 up to highestValue. Recording is a
+// few bit operations and an increment. Memory is allocated once by the
+// constructor. Values above highestValue are clamped to it.
+class HdrHistogram {
+public:
+    HdrHistogram(uint64_t highestValue, int significantDigits);
+
+    void record(uint64_t value);
+    void reset();
+
+    // Adds every count of other, which must have the same layout.
+    void add(const HdrHistogram& other);
+
+    uint64_t count() const { return totalCount_; }
+    uint64_t min() const { return totalCount_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const;
+
+    // Smallest value that at least percentile (0-100) percent of the
+    // recorded values are equal to or below, to the histogram's precision.
+    uint64_t valueAtPercentile(double percentile) const;
+
+private:
+    size_t countsIndex(uint64_t value) const;
+    uint64_t valueFromIndex(size_t index) const;
+    uint64_t highestEquivalentValue(uint64_t value) const;
+
+    uint64_t highestValue_;
+    int subBucketHalfCountMagnitude_;
+    uint64_t subBucketHalfCount_;
+    uint64_t subBucketMask_;
+
+    std::vector<uint64_t> counts_;
+    uint64_t totalCount_;
+    uint64_t min_;
+    uint64_t max_;
+    double sum_;
+};
+
+#endif // HDR_HISTOGRAM_H
@@ -0,0 +1,15 @@
+#ifndef INPUT_EVENT_H
+#define INPUT_EVENT_H
+
+#include <stdint.h>
+
+// Key event forwarded from the event thread to the render thread. Resizes
+// and lost window contents are state rather than events and are passed
+// alongside the queue, so only the latest of them is kept.
+struct InputEvent {
+    int key;               // GLFW key code
+    int action;            // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+    uint64_t timestampNs;  // monotonicNowNs() when the event was received
+};
+
+#endif // INPUT_EVENT_H
@@ -0,0 +1,207 @@
+#include "job_system.h"
+#include "allocation_guard.h"
+#include "async_log.h"
+#include "platform_timer.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// Rounds of failed steal attempts before an idle worker goes to sleep.
+const int kSpinRounds = 2000;
+
+// Worker index of the current thread in the job system it belongs to.
+thread_local const void* tlsSystem = nullptr;
+thread_local int tlsWorker = -1;
+
+} // namespace
+
+JobSystem::JobSystem(int threads)
+    : stopping_(false), queued_(0), sleeping_(0) {
+    if (threads < 1)
+        threads = 1;
+    for (int i = 0; i < threads; ++i) {
+        // Workers hold cache-line aligned deques, which plain new does not
+        // guarantee before C++17.
+        void* storage = nullptr;
+        if (posix_memalign(&storage, alignof(Worker), sizeof(Worker)) != 0)
+            throw std::bad_alloc();
+        Worker* worker = new (storage) Worker();
+        worker->system = this;
+        worker->index = i;
+        workers_.push_back(worker);
+    }
+    tlsSystem = this;
+    tlsWorker = 0;
+
+    int cpus = cpuCount();
+    for (int i = 1; i < threads; ++i) {
+        std::ostringstream name;
+        name << "tJobWorker" << i;
+        // Keep CPU 0 free of workers when there are enough cores. The
+        // render thread is not pinned, but can always run there.
+        int cpu = cpus > 1 ? 1 + (i - 1) % (cpus - 1) : -1;
+        if (!workers_[i]->thread.start(name.str().c_str(), workerMain, workers_[i], cpu))
+            std::cerr << "Failed to start job worker " << i << std::endl;
+    }
+    std::cout << "Job system: " << threads << " threads on " << cpus << " CPUs" << std::endl;
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_.store(true);
+    }
+    wakeCondition_.notify_all();
+    for (size_t i = 1; i < workers_.size(); ++i)
+        workers_[i]->thread.join();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->~Worker();
+        free(workers_[i]);
+    }
+    if (tlsSystem == this) {
+        tlsSystem = nullptr;
+        tlsWorker = -1;
+    }
+}
+
+int JobSystem::currentWorker() const {
+    return tlsSystem == this ? tlsWorker : -1;
+}
+
+void JobSystem::run(JobFn fn, void* data, size_t begin, size_t end, JobCounter& counter) {
+    int index = currentWorker();
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    if (index < 0) {
+        // Not one of ours; nothing to queue on, so run it here.
+        LogLine(LogError) << "JobSystem::run called from a foreign thread";
+        executeInline(nullptr, fn, data, begin, end, counter);
+        return;
+    }
+
+    // The ring wraps onto slots of jobs that may still be queued or not
+    // yet copied out by a thief. Such a slot is never reused; with all
+    // kMaxJobs in flight the job runs here.
+    Worker& self = *workers_[index];
+    Job* job = &self.jobs[self.nextJob & (kMaxJobs - 1)];
+    if (job->inUse.load(std::memory_order_acquire)) {
+        executeInline(&self, fn, data, begin, end, counter);
+        return;
+    }
+    ++self.nextJob;
+    job->fn = fn;
+    job->data = data;
+    job->begin = begin;
+    job->end = end;
+    job->counter = &counter;
+    job->inUse.store(true, std::memory_order_relaxed);
+    if (!self.deque.push(job)) {
+        job->inUse.store(false, std::memory_order_relaxed);
+        executeInline(&self, fn, data, begin, end, counter);
+        return;
+    }
+
+    queued_.fetch_add(1);
+    if (sleeping_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        wakeCondition_.notify_one();
+    }
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    int index = currentWorker();
+    int idleRounds = 0;
+    while (counter.pending.load(std::memory_order_acquire) > 0) {
+        if (index >= 0 && runOne(*workers_[index])) {
+            idleRounds = 0;
+        } else if (++idleRounds < kSpinRounds) {
+            cpuRelax();
+        } else {
+            // The remaining jobs are running elsewhere; let their threads
+            // have this core if they share it.
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::execute(Worker& self, Job* job) {
+    // The slot is handed back before the job runs, so its owner can
+    // queue more work while this one is still going.
+    JobFn fn = job->fn;
+    void* data = job->data;
+    size_t begin = job->begin;
+    size_t end = job->end;
+    JobCounter& counter = *job->counter;
+    job->inUse.store(false, std::memory_order_release);
+    executeInline(&self, fn, data, begin, end, counter);
+}
+
+void JobSystem::executeInline(Worker* self, JobFn fn, void* data, size_t begin, size_t end, JobCounter& counter) {
+    fn(data, begin, end);
+    if (self)
+        self->executed.fetch_add(1, std::memory_order_relaxed);
+    counter.pending.fetch_sub(1, std::memory_order_release);
+}
+
+bool JobSystem::runOne(Worker& self) {
+    Job* job = nullptr;
+    if (self.deque.pop(job)) {
+        queued_.fetch_sub(1);
+        execute(self, job);
+        return true;
+    }
+    // Start with the next worker so thieves spread over victims.
+    size_t count = workers_.size();
+    for (size_t i = 1; i < count; ++i) {
+        Worker& victim = *workers_[(self.index + i) % count];
+        if (victim.deque.steal(job)) {
+            queued_.fetch_sub(1);
+            self.stolen.fetch_add(1, std::memory_order_relaxed);
+            execute(self, job);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::sleep() {
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    sleeping_.fetch_add(1);
+    while (!stopping_.load() && queued_.load() <= 0)
+        wakeCondition_.wait(lock);
+    sleeping_.fetch_sub(1);
+}
+
+void JobSystem::workerMain(void* arg) {
+    Worker& self = *static_cast<Worker*>(arg);
+    JobSystem& system = *self.system;
+    tlsSystem = &system;
+    tlsWorker = self.index;
+    // Jobs run in the render loop, so they are held to the same rule.
+    guardThreadAllocations();
+
+    int idleRounds = 0;
+    while (!system.stopping_.load(std::memory_order_relaxed)) {
+        if (system.runOne(self)) {
+            idleRounds = 0;
+        } else if (++idleRounds < kSpinRounds) {
+            cpuRelax();
+        } else {
+            system.sleep();
+            idleRounds = 0;
+        }
+    }
+}
+
+void JobSystem::logStats() {
+    LogLine line(LogInfo);
+    line << "Job system:";
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        line << " [" << i << "] " << workers_[i]->executed.exchange(0, std::memory_order_relaxed)
+             << " jobs, " << workers_[i]->stolen.exchange(0, std::memory_order_relaxed) << " stolen";
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include "platform_thread.h"
+#include "work_stealing_deque.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Counts a group of jobs that have not finished yet. Wait on it with
+// JobSystem::wait(); jobs started after a wait() returns can depend on
+// everything the counter covered.
+struct JobCounter {
+    JobCounter() : pending(0) {}
+
+    std::atomic<int> pending;
+
+private:
+    JobCounter(const JobCounter&);
+    JobCounter& operator=(const JobCounter&);
+};
+
+// Runs the items [begin, end) of a job.
+typedef void (*JobFn)(void* data, size_t begin, size_t end);
+
+// Fixed pool of worker threads sharing CPU work through per-thread
+// work-stealing deques. The thread that creates the system is worker 0
+// and helps run jobs while it waits; the others are pinned to CPUs 1 to
+// N-1, keeping CPU 0 free of workers. The creating thread itself is not
+// pinned, so the scheduler may still put it on a worker's core; CPU 0 is
+// only where it can always run without competing with them. Idle workers
+// spin briefly before sleeping, so dispatching to a busy frame costs
+// microseconds.
+//
+// run() and wait() may only be called from worker threads, which includes
+// jobs themselves. Each thread has kMaxJobs job slots; a job queued while
+// its next slot is still in flight runs on the spot instead.
+class JobSystem {
+public:
+    static const size_t kMaxJobs = 4096;
+
+    // threads counts the calling thread.
+    explicit JobSystem(int threads);
+    ~JobSystem();
+
+    int threadCount() const { return static_cast<int>(workers_.size()); }
+
+    // Queues fn(data, begin, end) and adds it to counter.
+    void run(JobFn fn, void* data, size_t begin, size_t end, JobCounter& counter);
+
+    // Runs queued jobs until counter drops to zero.
+    void wait(JobCounter& counter);
+
+    // Calls body(begin, end) over [0, count) in ranges of about grain
+    // items, spread across the workers, and returns when all are done.
+    template <typename Body>
+    void parallelFor(size_t count, size_t grain, const Body& body) {
+        if (count == 0)
+            return;
+        if (grain < 1)
+            grain = 1;
+        JobCounter counter;
+        void* data = const_cast<void*>(static_cast<const void*>(&body));
+        // Queue all but the first range, which this thread runs directly.
+        for (size_t begin = grain; begin < count; begin += grain)
+            run(&callBody<Body>, data, begin, begin + grain < count ? begin + grain : count, counter);
+        body(static_cast<size_t>(0), grain < count ? grain : count);
+        wait(counter);
+    }
+
+    // Logs and clears the job and steal counts.
+    void logStats();
+
+private:
+    JobSystem(const JobSystem&);
+    JobSystem& operator=(const JobSystem&);
+
+    struct Job {
+        Job() : fn(nullptr), data(nullptr), begin(0), end(0), counter(nullptr), inUse(false) {}
+
+        JobFn fn;
+        void* data;
+        size_t begin;
+        size_t end;
+        JobCounter* counter;
+        std::atomic<bool> inUse;  // from run() until a worker has taken it
+    };
+
+    struct Worker {
+        Worker() : nextJob(0), executed(0), stolen(0), system(nullptr), index(0) {}
+
+        WorkStealingDeque<Job*, kMaxJobs> deque;
+        Job jobs[kMaxJobs];  // ring the worker's jobs are allocated from
+        size_t nextJob;
+        std::atomic<uint64_t> executed;
+        std::atomic<uint64_t> stolen;
+        PlatformThread thread;
+        JobSystem* system;
+        int index;
+    };
+
+    template <typename Body>
+    static void callBody(void* data, size_t begin, size_t end) {
+        (*static_cast<const Body*>(data))(begin, end);
+    }
+
+    static void workerMain(void* worker);
+
+    int currentWorker() const;
+    bool runOne(Worker& self);
+    void execute(Worker& self, Job* job);
+    void executeInline(Worker* self, JobFn fn, void* data, size_t begin, size_t end, JobCounter& counter);
+    void sleep();
+
+    std::vector<Worker*> workers_;
+    std::atomic<bool> stopping_;
+
+    // Jobs queued but not yet taken, and workers blocked waiting for one.
+    std::atomic<int> queued_;
+    std::atomic<int> sleeping_;
+    std::mutex sleepMutex_;
+    std::condition_variable wakeCondition_;
+};
+
+#endif // JOB_SYSTEM_H
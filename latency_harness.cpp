@@ -0,0 +1,164 @@
+#include "latency_harness.h"
+#include "async_log.h"
+#include "platform_timer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+void printDistribution(const char* name, std::vector<double> values) {
+    if (values.empty())
+        return;
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    std::cout << "  " << name
+              << ": min " << values[0]
+              << " p50 " << values[n / 2]
+              << " p90 " << values[std::min(n - 1, n * 9 / 10)]
+              << " p99 " << values[std::min(n - 1, n * 99 / 100)]
+              << " max " << values[n - 1] << " ms" << std::endl;
+}
+
+} // namespace
+
+const int LatencyHarness::kReadbacks;
+
+LatencyHarness::LatencyHarness(int samples)
+    : targetSamples_(samples), head_(0), pending_(0), gpuClockOffsetNs_(0),
+      frameBeginNs_(0), pendingInput_(false), inputFrameIssued_(false),
+      eventNs_(0), pickupNs_(0), haveBaseline_(false) {
+    samples_.reserve(samples);
+    memset(baseline_, 0, sizeof(baseline_));
+
+    // One glGen* call per object type for the whole ring
+    GlNamePool<GlBufferTraits> buffers(kReadbacks);
+    GlNamePool<GlQueryTraits> queries(2 * kReadbacks);
+    for (int i = 0; i < kReadbacks; ++i) {
+        Readback& r = readbacks_[i];
+        r.buffer = buffers.acquire();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.buffer.get());
+        glBufferData(GL_PIXEL_PACK_BUFFER, 4, nullptr, GL_STREAM_READ);
+        r.frameStartQuery = queries.acquire();
+        r.doneQuery = queries.acquire();
+        r.frameBeginNs = 0;
+        r.swapNs = 0;
+        r.measured = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Map GPU timestamps onto the monotonic CPU clock.
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuClockOffsetNs_ = static_cast<int64_t>(monotonicNowNs()) - gpuNow;
+
+    std::cout << "Latency harness: measuring " << samples << " input events" << std::endl;
+}
+
+void LatencyHarness::inputReceived(uint64_t eventNs, uint64_t pickupNs) {
+    // Without a baseline there is nothing to detect the change against.
+    if (pendingInput_ || !haveBaseline_ || finished())
+        return;
+    pendingInput_ = true;
+    inputFrameIssued_ = false;
+    eventNs_ = eventNs;
+    pickupNs_ = pickupNs;
+}
+
+void LatencyHarness::frameBegin() {
+    frameBeginNs_ = monotonicNowNs();
+    if (pending_ == kReadbacks)
+        poll();
+    if (pending_ == kReadbacks)
+        return;
+    Readback& r = readbacks_[(head_ + pending_) % kReadbacks];
+    glQueryCounter(r.frameStartQuery.get(), GL_TIMESTAMP);
+    r.frameBeginNs = frameBeginNs_;
+}
+
+void LatencyHarness::frameSubmitted(uint64_t swapNs, int x, int y) {
+    if (pending_ == kReadbacks)
+        return;
+    Readback& r = readbacks_[(head_ + pending_) % kReadbacks];
+    if (r.frameBeginNs != frameBeginNs_)
+        return;  // frameBegin() had no free slot for this frame
+
+    // The frame just swapped to the front buffer is what is being shown.
+    glReadBuffer(GL_FRONT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, r.buffer.get());
+    glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glQueryCounter(r.doneQuery.get(), GL_TIMESTAMP);
+    r.fence.reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    r.swapNs = swapNs;
+    r.measured = pendingInput_ && !inputFrameIssued_;
+    if (r.measured)
+        inputFrameIssued_ = true;
+    ++pending_;
+}
+
+void LatencyHarness::poll() {
+    while (pending_ > 0) {
+        Readback& r = readbacks_[head_];
+        if (glClientWaitSync(r.fence.get(), 0, 0) == GL_TIMEOUT_EXPIRED)
+            return;
+        r.fence.reset();
+        head_ = (head_ + 1) % kReadbacks;
+        --pending_;
+
+        unsigned char pixel[4] = { 0, 0, 0, 0 };
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.buffer.get());
+        void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4, GL_MAP_READ_BIT);
+        if (mapped) {
+            memcpy(pixel, mapped, 4);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (r.measured) {
+            pendingInput_ = false;
+            if (memcmp(pixel, baseline_, 3) == 0) {
+                LogLine(LogError) << "Latency harness: change not visible in the presented frame, sample dropped";
+            } else {
+                GLuint64 gpuStart = 0, gpuDone = 0;
+                glGetQueryObjectui64v(r.frameStartQuery.get(), GL_QUERY_RESULT, &gpuStart);
+                glGetQueryObjectui64v(r.doneQuery.get(), GL_QUERY_RESULT, &gpuDone);
+                uint64_t startNs = gpuToCpuNs(gpuStart);
+                uint64_t doneNs = gpuToCpuNs(gpuDone);
+
+                Sample s;
+                s.queueMs = nsToMs(pickupNs_ - eventNs_);
+                s.cpuMs = nsToMs(r.swapNs - pickupNs_);
+                s.driverMs = startNs > r.frameBeginNs ? nsToMs(startNs - r.frameBeginNs) : 0.0;
+                s.gpuMs = nsToMs(gpuDone - gpuStart);
+                s.presentMs = doneNs > eventNs_ ? nsToMs(doneNs - eventNs_) : 0.0;
+                samples_.push_back(s);
+            }
+        }
+        memcpy(baseline_, pixel, sizeof(baseline_));
+        haveBaseline_ = true;
+    }
+}
+
+void LatencyHarness::report() const {
+    std::vector<double> queue, cpu, driver, gpu, present;
+    for (size_t i = 0; i < samples_.size(); ++i) {
+        queue.push_back(samples_[i].queueMs);
+        cpu.push_back(samples_[i].cpuMs);
+        driver.push_back(samples_[i].driverMs);
+        gpu.push_back(samples_[i].gpuMs);
+        present.push_back(samples_[i].presentMs);
+    }
+    std::cout << "Input-to-present latency over " << samples_.size() << " samples:" << std::endl;
+    printDistribution("queue  ", queue);
+    printDistribution("cpu    ", cpu);
+    printDistribution("driver ", driver);
+    printDistribution("gpu    ", gpu);
+    printDistribution("present", present);
+}
+
+uint64_t LatencyHarness::gpuToCpuNs(GLuint64 gpuNs) const {
+    return static_cast<uint64_t>(static_cast<int64_t>(gpuNs) + gpuClockOffsetNs_);
+}
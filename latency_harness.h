@@ -0,0 +1,88 @@
+#ifndef LATENCY_HARNESS_H
+#define LATENCY_HARNESS_H
+
+#include "gl_handle.h"
+#include "gl_platform.h"
+
+#include <stdint.h>
+#include <vector>
+
+// Measures input-to-present latency on the render thread of the desktop
+// build. Synthetic key presses are stamped on the event thread when they
+// are injected; the resulting colour change is detected by reading one
+// pixel of the front buffer back after every swap. Readbacks go through
+// pixel buffer objects and are polled with fences, so the render loop is
+// never stalled waiting for them.
+//
+// Each sample is split into phases:
+//   queue   - event thread timestamp to pickup by the render thread
+//   cpu     - pickup to the swap call of the frame showing the change
+//   driver  - start of that frame on the CPU to start of it on the GPU
+//   gpu     - GPU execution from frame start to readback completion
+//   present - event to readback completion, i.e. the change is visible
+// GPU times come from GL_TIMESTAMP queries, mapped onto the CPU clock with
+// an offset calibrated at startup.
+class LatencyHarness {
+public:
+    explicit LatencyHarness(int samples);
+
+    bool finished() const { return static_cast<int>(samples_.size()) >= targetSamples_; }
+
+    // An input event that changes the image was picked up by the render
+    // thread. Ignored while a sample is already being measured.
+    void inputReceived(uint64_t eventNs, uint64_t pickupNs);
+
+    // Call before the first GL command of a frame.
+    void frameBegin();
+
+    // Call right after the swap, with the window pixel to watch.
+    void frameSubmitted(uint64_t swapNs, int x, int y);
+
+    // Collects completed readbacks.
+    void poll();
+
+    void report() const;
+
+private:
+    LatencyHarness(const LatencyHarness&);
+    LatencyHarness& operator=(const LatencyHarness&);
+
+    struct Sample {
+        double queueMs;
+        double cpuMs;
+        double driverMs;
+        double gpuMs;
+        double presentMs;
+    };
+
+    struct Readback {
+        GlBuffer buffer;
+        GlQuery frameStartQuery;
+        GlQuery doneQuery;
+        GlFence fence;
+        uint64_t frameBeginNs;
+        uint64_t swapNs;
+        bool measured;  // first frame after the pending input
+    };
+
+    static const int kReadbacks = 4;
+
+    uint64_t gpuToCpuNs(GLuint64 gpuNs) const;
+
+    int targetSamples_;
+    std::vector<Sample> samples_;
+    Readback readbacks_[kReadbacks];
+    int head_;
+    int pending_;
+    int64_t gpuClockOffsetNs_;
+
+    uint64_t frameBeginNs_;
+    bool pendingInput_;
+    bool inputFrameIssued_;
+    uint64_t eventNs_;
+    uint64_t pickupNs_;
+    bool haveBaseline_;
+    unsigned char baseline_[4];
+};
+
+#endif // LATENCY_HARNESS_H
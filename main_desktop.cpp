@@ -1,161 +1,688 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "allocation_guard.h"
+#include "async_log.h"
+#include "color_error.h"
+#include "damage_tracker.h"
+#include "draw_batcher.h"
+#include "dynamic_resolution.h"
+#include "frame_arena.h"
+#include "frame_limiter.h"
+#include "frame_pacer.h"
+#include "frame_telemetry.h"
+#include "geometry_streamer.h"
+#include "gl_handle.h"
+#include "gl_trace.h"
+#include "gpu_reset.h"
+#include "gpu_timer.h"
+#include "input_event.h"
+#include "job_system.h"
+#include "latency_harness.h"
+#include "mesh_optimizer.h"
+#include "perf_counters.h"
+#include "platform_timer.h"
+#include "program_binary_cache.h"
+#include "render_options.h"
+#include "scene_file.h"
+#include "shader_library.h"
+#include "shader_manager.h"
+#include "spsc_queue.h"
 
-// Vertex Shader source code
-const char* vertexShaderSource = R"(
-    #version 330 core
-    layout (location = 0) in vec3 aPos;
-    layout (location = 1) in vec3 aColor;
-    out vec3 ourColor;
-    void main() {
-        gl_Position = vec4(aPos, 1.0);
-        ourColor = aColor;
-    }
-)";
-
-// Fragment Shader source code
-const char* fragmentShaderSource = R"(
-    #version 330 core
-    out vec4 FragColor;
-    in vec3 ourColor;
-    void main() {
-        FragColor = vec4(ourColor, 1.0);
-    }
-)";
+// Combined vertex data (position and color)
+const SceneVertex triangleVertices[] = {
+    // positions              // colors
+    { {  0.0f,  0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f } },  // top, red
+    { { -0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f } },  // bottom left, green
+    { {  0.5f, -0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } }   // bottom right, blue
+};
+
+// White background
+const GLfloat backgroundColor[] = { 1.0f, 1.0f, 1.0f };
+
+// How often an idle render thread wakes to look for a GPU reset and to
+// export telemetry
+const int kIdleResetCheckSeconds = 1;
 
 // Error callback for GLFW
 void error_callback(int error, const char* description) {
     fprintf(stderr, "Error: %s\n", description);
 }
 
-int main() {
-    glfwSetErrorCallback(error_callback);
+// State shared between the event thread, which owns the window, and the
+// render thread, which owns the GL context. The window user pointer refers
+// to it so the GLFW callbacks can forward events.
+struct SharedState {
+    SharedState()
+        : resize(0), refresh(false), running(true), quitRequested(false), setupFailed(false), contextLost(false) {}
 
-    // Initialize GLFW
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
-        return -1;
-    }
+    SpscQueue<InputEvent, 1024> events;
+    std::atomic<uint64_t> resize;     // latest framebuffer size, see pack_size()
+    std::atomic<bool> refresh;        // window contents were lost
+    std::atomic<bool> running;        // cleared by the event thread on close
+    std::atomic<bool> quitRequested;  // set by the render thread
+    std::atomic<bool> setupFailed;    // set by the render thread before it quits
+    std::atomic<bool> contextLost;    // set by the render thread on a GPU reset
 
-    // Set GLFW window hints for OpenGL 3.3 Core Profile
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // Lets an idle render thread sleep until the next event arrives. Only
+    // taken when waking the render thread, never around the queue itself.
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+};
 
-    // Create a windowed mode window and its OpenGL context
-    GLFWwindow* window = glfwCreateWindow(800, 600, "OpenGL Triangle", NULL, NULL);
-    if (!window) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+// What outlives a window and its GL context. A GLFW context belongs to its
+// window, so after a GPU reset the window is created again in the same
+// place, and its render thread rebuilds from here rather than from the
+// file system and the shader compiler: the scene stays mapped for its
+// vertex buffers to be uploaded again and programs come back from their
+// binaries. The render thread only touches it while it runs.
+struct RetainedState {
+    RetainedState()
+        : lostNs(0), recovering(false), recoveries(0),
+          windowX(0), windowY(0), windowWidth(800), windowHeight(600), windowPlaced(false) {}
+
+    SceneFile sceneFile;
+    ProgramBinaryCache programs;
+    uint64_t lostNs;  // when the context was last lost
+    bool recovering;  // until the first frame on the new context is presented
+    unsigned long recoveries;
+
+    int windowX;
+    int windowY;
+    int windowWidth;
+    int windowHeight;
+    bool windowPlaced;  // whether windowX and windowY are known
+};
+
+// A framebuffer size for SharedState::resize. The top bit marks it as
+// pending, so that a minimized window's 0x0 is not mistaken for none.
+const uint64_t kResizePending = 1ull << 63;
+
+uint64_t pack_size(int width, int height) {
+    return kResizePending | static_cast<uint64_t>(static_cast<uint32_t>(width)) << 32 |
+           static_cast<uint32_t>(height);
+}
+
+void wake_render_thread(SharedState* shared) {
+    std::lock_guard<std::mutex> lock(shared->wakeMutex);
+    shared->wake.notify_one();
+}
+
+// Called on the event thread from the GLFW callbacks. Key presses are never
+// dropped: if the render thread is so far behind that the queue is full,
+// the event thread waits for room, unless the render thread has stopped
+// taking events.
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    SharedState* shared = static_cast<SharedState*>(glfwGetWindowUserPointer(window));
+    InputEvent event = InputEvent();
+    event.key = key;
+    event.action = action;
+    event.timestampNs = monotonicNowNs();
+    while (!shared->events.push(event)) {
+        if (shared->quitRequested || shared->contextLost)
+            return;
+        wake_render_thread(shared);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
+    wake_render_thread(shared);
+}
 
-    // Make the window's context current
-    glfwMakeContextCurrent(window);
+// Resizing invalidates the whole framebuffer. Only the latest size matters,
+// so it replaces any the render thread has not picked up yet.
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    SharedState* shared = static_cast<SharedState*>(glfwGetWindowUserPointer(window));
+    shared->resize = pack_size(width, height);
+    wake_render_thread(shared);
+}
+
+// The window system lost our contents (e.g. the window was uncovered)
+void window_refresh_callback(GLFWwindow* window) {
+    SharedState* shared = static_cast<SharedState*>(glfwGetWindowUserPointer(window));
+    shared->refresh = true;
+    wake_render_thread(shared);
+}
+
+// Ends a render thread that could not set up, so that main() fails. A
+// trace started before the failure is closed.
+void fail_setup(SharedState* shared) {
+    stopGlTrace();
+    shared->setupFailed = true;
+    shared->quitRequested = true;
+    glfwPostEmptyEvent();
+}
+
+// Owns the GL context: sets up GL state, renders until the event thread
+// asks to stop or the context is lost, and releases GL resources before
+// returning.
+void render_thread(GLFWwindow* window, const RenderOptions& options, SharedState* shared,
+                   RetainedState* retained) {
+    // Make the window's context current. It is released on every return,
+    // after the GL objects declared below have been destroyed.
+    struct CurrentContext {
+        explicit CurrentContext(GLFWwindow* window) { glfwMakeContextCurrent(window); }
+        ~CurrentContext() { glfwMakeContextCurrent(NULL); }
+    } currentContext(window);
 
     // Initialize GLEW
     if (glewInit() != GLEW_OK) {
         std::cerr << "Failed to initialize GLEW" << std::endl;
-        return -1;
+        fail_setup(shared);
+        return;
     }
 
-    // --- Shader Compilation ---
-    // Vertex Shader
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    // Check for shader compile errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    // Optional GL call trace. It starts before any GL object is created,
+    // so it can be replayed without the application. A trace replays into
+    // one context, so only the first window is traced.
+    if (!options.glTracePath.empty() && retained->recoveries == 0 &&
+        !startGlTrace(options.glTracePath.c_str(), options.glTraceFrames)) {
+        fail_setup(shared);
+        return;
     }
 
-    // Fragment Shader
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    // Check for shader compile errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+    GpuResetDetector resets;
 
-    // Link shaders into a shader program
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    // Check for linking errors
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    // --- Shader Compilation ---
+    // Every variant is submitted up front and built by the driver while
+    // the scene loads. The render loop waits only for the programs of the
+    // first frame. After a reset they are loaded from the binaries saved
+    // by the first context instead.
+    ShaderManager shaders(&retained->programs);
+    ShaderVariantCache variants(shaders);
+    int triangleProgram = variants.requestAll(kTriangleShader, options.shaderFeatures);
+
+    // Optional colour accuracy check of the built-in triangle, reduced on
+    // the GPU so that only a few bytes per checked frame are read back.
+    // Its chain is sized on the first resize. It needs every frame drawn.
+    std::unique_ptr<ColorErrorMonitor> colorCheck;
+    if (options.colorCheckInterval > 0) {
+        if (!options.scenePath.empty() || options.fieldTriangles > 0) {
+            LogLine(LogError) << "Color check needs the built-in triangle, disabled";
+        } else if (options.dynamicResolutionBudgetMs > 0.0) {
+            LogLine(LogError) << "Color check needs native resolution, disabled";
+        } else {
+            colorCheck.reset(new ColorErrorMonitor(shaders, variants, triangleVertices, backgroundColor,
+                                                   options.colorCheckInterval));
+        }
     }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
 
     // --- Vertex Data and Buffers ---
-    // Combined vertex data (position and color)
-    float vertices[] = {
-        // positions         // colors
-         0.0f,  0.5f, 0.0f,  1.0f, 0.0f, 0.0f,   // top, red
-        -0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 0.0f,   // bottom left, green
-         0.5f, -0.5f, 0.0f,  0.0f, 0.0f, 1.0f    // bottom right, blue
-    };
+    // Either the built-in triangle or a scene file, which is memory mapped
+    // and uploaded straight from the mapping. The mapping is kept for the
+    // next context.
+    // Scenes larger than GPU memory can instead be streamed in chunks.
+    SceneBuffers scene = SceneBuffers();
+    std::unique_ptr<GeometryStreamer> streamer;
+    if (!options.scenePath.empty() && options.streamBuffers > 0) {
+        streamer.reset(new GeometryStreamer(options.streamBuffers));
+        if (!streamer->open(options.scenePath.c_str())) {
+            fail_setup(shared);
+            return;
+        }
+    } else if (!options.scenePath.empty()) {
+        uint64_t loadStart = monotonicNowNs();
+        SceneFile& sceneFile = retained->sceneFile;
+        if ((!sceneFile.isOpen() && !sceneFile.open(options.scenePath.c_str())) || !uploadScene(sceneFile, scene)) {
+            fail_setup(shared);
+            return;
+        }
+        glFinish();
+        double loadMs = nsToMs(monotonicNowNs() - loadStart);
+        double megabytes = (sceneFile.vertexBytes() + sceneFile.indexBytes()) / (1024.0 * 1024.0);
+        std::cout << "Loaded scene " << options.scenePath << ": " << scene.vertexCount << " vertices, "
+                  << scene.indexCount << " indices in " << loadMs << " ms ("
+                  << megabytes * 1000.0 / loadMs << " MiB/s)" << std::endl;
+    } else {
+        scene.vertexCount = 3;
+        glGenBuffers(1, &scene.vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, scene.vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(triangleVertices), triangleVertices, GL_STATIC_DRAW);
+    }
 
-    unsigned int VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    GlVertexArray VAO = GlVertexArray::generate();
 
     // Bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
-    glBindVertexArray(VAO);
+    glBindVertexArray(VAO.get());
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // Points the bound VAO's attributes at a vertex buffer
+    auto bindVertexBuffer = [](GLuint buffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
 
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+        // Position and color attributes, at the locations of the shader
+        SceneVertexLayout::bind();
+    };
+    if (scene.vertexBuffer)
+        bindVertexBuffer(scene.vertexBuffer);
 
     // Unbind the VBO and VAO
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
+    // Optional job system for per-frame CPU work. This thread is worker 0
+    // and helps while it waits, so jobs are dispatched from here.
+    std::unique_ptr<JobSystem> jobs;
+    if (options.jobThreads > 1)
+        jobs.reset(new JobSystem(options.jobThreads));
+
+    // Scratch memory for the current frame, released after every swap
+    FrameArena frameArena(static_cast<size_t>(options.frameArenaKb) * 1024);
+
+    // Optional test scene of many small triangle draws
+    std::unique_ptr<TriangleField> field;
+    if (options.fieldTriangles > 0)
+        field.reset(new TriangleField(options.fieldTriangles, options.batching, jobs.get(), &frameArena));
+
+    auto drawGeometry = [&]() {
+        if (field) {
+            field->draw(bindVertexBuffer);
+        } else if (streamer) {
+            streamer->draw([&](GLuint buffer, GLsizei vertexCount) {
+                bindVertexBuffer(buffer);
+                glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+            });
+        } else {
+            drawSceneBuffers(scene);
+        }
+    };
+
+    if (!shaders.waitForRequired()) {
+        fail_setup(shared);
+        return;
+    }
+    GLuint shaderProgram = shaders.program(triangleProgram);
+
+    // Space toggles between the gradient and its inverse, giving input a
+    // visible effect for the latency harness to detect.
+    GLint invertLoc = glGetUniformLocation(shaderProgram, "u_invert");
+    bool inverted = false;
+
+    // Track damage so that a static scene is not redrawn every frame. GLFW
+    // does not expose the buffer age or a swap-with-damage entry point, so
+    // any damage repaints the whole (undefined) back buffer and presents it
+    // with a full swap. The initial size is posted before this thread starts.
+    DamageTracker damage;
+    int width = 0, height = 0;
+
+    // Optional dynamic resolution: render offscreen at a scale chosen from
+    // the measured GPU time of the scene, then blit it up to the window.
+    // This redraws every frame.
+    bool dynamicResolution = options.dynamicResolutionBudgetMs > 0.0;
+    ResolutionController resolution(options.dynamicResolutionBudgetMs);
+    ScaledRenderTarget scaledTarget;
+    GpuTimer sceneTimer;
+
+    // Optional CPU frame pacing for displays without usable vsync. Like
+    // dynamic resolution it redraws every frame.
+    bool pacing = options.frameRateHz > 0.0;
+    FramePacer pacer(pacing ? options.frameRateHz : 60.0);
+    if (pacing)
+        glfwSwapInterval(0);
+    // Optional input-to-present latency measurement. Readbacks are only
+    // collected on later frames, so this also redraws every frame.
+    std::unique_ptr<LatencyHarness> latency;
+    if (options.latencySamples > 0)
+        latency.reset(new LatencyHarness(options.latencySamples));
+
+    // Streamed chunks arrive over several frames, so keep drawing.
+    bool continuousRendering = dynamicResolution || pacing || latency || streamer || colorCheck;
+
+    // Optional bound on how far the CPU may run ahead of the GPU
+    FrameLimiter frameLimiter(options.maxFramesInFlight);
+
+    // Frame, GPU and swap time histograms, always recorded and exported
+    // when a sink is configured. Dynamic resolution already times the
+    // scene on the GPU; otherwise the whole frame gets its own timer, as
+    // timer queries cannot nest.
+    FrameTelemetry telemetry(options.telemetrySink, options.telemetryIntervalSeconds);
+    GpuTimer frameTimer;
+
+    // Optional hardware counters per phase of the loop. The waits for the
+    // frame limiter and the pacer are left out of every phase.
+    PhaseCounters phases(options.perfCounters);
+
+    // Bookkeeping after each swap: release the frame's scratch memory and,
+    // in the zero-allocation test mode, arm the allocation guard once the
+    // warmup frames are done. The first frame after a reset completes the
+    // recovery.
+    unsigned long framesPresented = 0;
+    auto framePresented = [&]() {
+        frameArena.reset();
+        if (++framesPresented == static_cast<unsigned long>(options.allocationCheckFrames)) {
+            LogLine(LogInfo) << "Allocation guard armed after " << framesPresented << " frames";
+            armAllocationGuard();
+        }
+        if (retained->recovering) {
+            LogLine(LogInfo) << "GPU reset: recovered in " << nsToMs(monotonicNowNs() - retained->lostNs)
+                             << " ms (" << shaders.loadedFromBinary() << " of " << shaders.programs()
+                             << " programs from cached binaries)";
+            retained->recovering = false;
+        }
+    };
+
     // Render loop
-    while (!glfwWindowShouldClose(window)) {
+    while (shared->running) {
+        // After a reset every GL call is a no-op; the event thread carries
+        // on with a new window.
+        if (resets.contextLost()) {
+            retained->lostNs = monotonicNowNs();
+            shared->contextLost = true;
+            glfwPostEmptyEvent();
+            break;
+        }
+
         // Input
-        if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-            glfwSetWindowShouldClose(window, true);
+        bool resized = false;
+        uint64_t size = shared->resize.exchange(0);
+        if (size & kResizePending) {
+            width = static_cast<int>((size >> 32) & 0x7fffffff);
+            height = static_cast<int>(static_cast<uint32_t>(size));
+            glViewport(0, 0, width, height);
+            damage.resize(width, height);
+            resized = true;
+        }
+        if (shared->refresh.exchange(false))
+            damage.addFull();
+        InputEvent event;
+        while (shared->events.pop(event)) {
+            if (event.key == GLFW_KEY_ESCAPE && event.action == GLFW_PRESS) {
+                shared->quitRequested = true;
+                glfwPostEmptyEvent();
+            } else if (event.key == GLFW_KEY_SPACE && event.action == GLFW_PRESS) {
+                inverted = !inverted;
+                damage.addFull();
+                if (latency)
+                    latency->inputReceived(event.timestampNs, monotonicNowNs());
+            }
+        }
 
-        // Rendering commands here
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // White background
-        glClear(GL_COLOR_BUFFER_BIT);
+        if (dynamicResolution && resized && !scaledTarget.create(width, height)) {
+            LogLine(LogError) << "Dynamic resolution unavailable, rendering at native size";
+            dynamicResolution = false;
+        }
+        if (colorCheck && resized && !colorCheck->create(width, height)) {
+            LogLine(LogError) << "Color check unavailable";
+            colorCheck.reset();
+        }
+        if (continuousRendering)
+            damage.addFull();
+
+        if (damage.empty()) {
+            // Nothing changed; sleep until the event thread has news for us,
+            // waking now and then to look for a reset and export telemetry.
+            {
+                std::unique_lock<std::mutex> lock(shared->wakeMutex);
+                shared->wake.wait_for(lock, std::chrono::seconds(kIdleResetCheckSeconds), [shared]() {
+                    return !shared->events.empty() || shared->resize.load() || shared->refresh.load() ||
+                           !shared->running;
+                });
+            }
+            telemetry.tick(monotonicNowNs());
+            continue;
+        }
 
-        // Draw the triangle
+        uint64_t frameStartNs = monotonicNowNs();
+        frameLimiter.waitForSlot();
+        if (latency) {
+            phases.begin(ReadbackPhase);
+            latency->poll();
+            latency->frameBegin();
+            phases.end(ReadbackPhase);
+        }
+        if (colorCheck) {
+            phases.begin(ReadbackPhase);
+            colorCheck->poll();
+            phases.end(ReadbackPhase);
+        }
+
+        phases.begin(SetupPhase);
+        shaders.poll();
+        if (streamer)
+            streamer->update();
+
+        // Rendering commands here
+        glClearColor(backgroundColor[0], backgroundColor[1], backgroundColor[2], 1.0f);
         glUseProgram(shaderProgram);
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glUniform1f(invertLoc, inverted ? 1.0f : 0.0f);
+        glBindVertexArray(VAO.get());
+        phases.end(SetupPhase);
+
+        phases.begin(SubmitPhase);
+        if (dynamicResolution) {
+            double sceneMs;
+            while (sceneTimer.poll(sceneMs)) {
+                resolution.update(sceneMs);
+                telemetry.recordGpuMs(sceneMs);
+            }
+
+            scaledTarget.begin(resolution.scale());
+            sceneTimer.begin();
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawGeometry();
+            sceneTimer.end();
+            scaledTarget.present();
+        } else {
+            double frameMs;
+            while (frameTimer.poll(frameMs))
+                telemetry.recordGpuMs(frameMs);
+
+            frameTimer.begin();
+            const std::vector<DamageRect>& repaint = damage.repaintRects(0);
+            for (size_t i = 0; i < repaint.size(); ++i) {
+                scissorToDamage(&repaint[i]);
+                glClear(GL_COLOR_BUFFER_BIT);
+
+                // Draw the triangle
+                drawGeometry();
+            }
+            scissorToDamage(nullptr);
+            frameTimer.end();
+        }
+        phases.end(SubmitPhase);
+
+        if (colorCheck) {
+            phases.begin(ReadbackPhase);
+            colorCheck->frameDrawn(inverted ? 1.0f : 0.0f);
+            phases.end(ReadbackPhase);
+        }
+
+        if (pacing)
+            pacer.wait();
 
         // Swap front and back buffers
+        phases.begin(SwapPhase);
+        uint64_t swapNs = monotonicNowNs();
         glfwSwapBuffers(window);
+        phases.end(SwapPhase);
+        traceSwap();
+        telemetry.framePresented(frameStartNs, swapNs, monotonicNowNs());
+        frameLimiter.frameSubmitted();
+        damage.endFrame();
+        framePresented();
 
-        // Poll for and process events
-        glfwPollEvents();
+        if (latency) {
+            // Watch the centroid of the triangle
+            phases.begin(ReadbackPhase);
+            latency->frameSubmitted(swapNs, width / 2, height * 5 / 12);
+            phases.end(ReadbackPhase);
+            if (latency->finished()) {
+                disarmAllocationGuard();
+                latency->report();
+                latency.reset();
+                shared->quitRequested = true;
+                glfwPostEmptyEvent();
+            }
+        }
+        phases.frameEnd();
     }
 
     // Cleanup
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteProgram(shaderProgram);
+    disarmAllocationGuard();
+    phases.report();
+    field.reset();
+    streamer.reset();
+    colorCheck.reset();
+    scaledTarget.destroy();
+    VAO.reset();
+    deleteSceneBuffers(scene);
+    shaders.destroy();
+    stopGlTrace();
+}
+
+// How the window of one context was closed
+enum SessionEnd {
+    SessionClosed,      // by the user, or at the end of the latency test
+    SessionFailed,      // setup failed
+    SessionContextLost  // a GPU reset took the context
+};
+
+// Creates the window and its context where the last one was, and runs the
+// event loop until the window is closed or the context is lost.
+SessionEnd runWindow(const RenderOptions& options, RetainedState& retained) {
+    GLFWwindow* window = glfwCreateWindow(retained.windowWidth, retained.windowHeight, "OpenGL Triangle",
+                                          NULL, NULL);
+    if (!window) {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        return SessionFailed;
+    }
+    if (retained.windowPlaced)
+        glfwSetWindowPos(window, retained.windowX, retained.windowY);
+
+    // This thread only handles windowing; events are forwarded to the
+    // render thread, which owns the context, so a stalled event loop (e.g.
+    // during a window drag) does not stall frames.
+    SharedState shared;
+    glfwSetWindowUserPointer(window, &shared);
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    framebuffer_size_callback(window, width, height);
+
+    std::thread renderer(render_thread, window, std::cref(options), &shared, &retained);
+
+    // Event loop. For the latency harness, synthetic Space presses are
+    // injected here, at irregular intervals so that they do not lock onto
+    // the frame phase, just as if they had come from the window system.
+    const double kInjectWarmupSeconds = 1.0;
+    double nextInjection = glfwGetTime() + kInjectWarmupSeconds;
+    unsigned int injectionSeed = 1;
+    while (!glfwWindowShouldClose(window) && !shared.contextLost) {
+        if (options.latencySamples > 0) {
+            // GLFW rejects a negative timeout; an overdue injection polls.
+            double timeout = nextInjection - glfwGetTime();
+            if (timeout > 0.0)
+                glfwWaitEventsTimeout(timeout);
+            else
+                glfwPollEvents();
+            if (glfwGetTime() >= nextInjection) {
+                key_callback(window, GLFW_KEY_SPACE, 0, GLFW_PRESS, 0);
+                key_callback(window, GLFW_KEY_SPACE, 0, GLFW_RELEASE, 0);
+                injectionSeed = injectionSeed * 1103515245u + 12345u;
+                nextInjection = glfwGetTime() + 0.15 + (injectionSeed >> 16) % 100 / 1000.0;
+            }
+        } else {
+            glfwWaitEvents();
+        }
+        if (shared.quitRequested)
+            glfwSetWindowShouldClose(window, true);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(shared.wakeMutex);
+        shared.running = false;
+        shared.wake.notify_one();
+    }
+    renderer.join();
+
+    SessionEnd end = SessionClosed;
+    if (shared.setupFailed)
+        end = SessionFailed;
+    else if (shared.contextLost)
+        end = SessionContextLost;
+    if (end == SessionContextLost) {
+        glfwGetWindowPos(window, &retained.windowX, &retained.windowY);
+        glfwGetWindowSize(window, &retained.windowWidth, &retained.windowHeight);
+        retained.windowPlaced = true;
+    }
+    glfwDestroyWindow(window);
+    return end;
+}
+
+int main(int argc, char* argv[]) {
+    RenderOptions options;
+    if (!parseRenderOptions(argc, argv, options))
+        return -1;
+
+    // Import stage: index, deduplicate and cache-optimize the built-in
+    // triangle or the given scene, write the result and exit.
+    if (!options.exportScenePath.empty()) {
+        bool written;
+        if (!options.scenePath.empty()) {
+            SceneFile source;
+            if (!source.open(options.scenePath.c_str()))
+                return -1;
+            const SceneHeader& h = source.header();
+            written = importScene(static_cast<const float*>(source.vertices()), h.vertexCount,
+                                  source.indices(), h.indexCount, h.indexSize,
+                                  options.exportScenePath.c_str());
+        } else {
+            written = importScene(triangleVertices[0].position, 3, nullptr, 0, 0,
+                                  options.exportScenePath.c_str());
+        }
+        return written ? 0 : -1;
+    }
+
+    // Messages from the render loop are queued and written by a background
+    // thread, so logging never stalls a frame.
+    if (!startAsyncLog(options.logPath.empty() ? nullptr : options.logPath.c_str()))
+        return -1;
+
+    glfwSetErrorCallback(error_callback);
+
+    // Initialize GLFW
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+
+    // Set GLFW window hints for OpenGL 3.3 Core Profile. The context is
+    // lost on a GPU reset, so that the render thread hears about it.
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_CONTEXT_ROBUSTNESS, GLFW_LOSE_CONTEXT_ON_RESET);
+
+    // Each window gets a new context. When a GPU reset loses it, the
+    // window is created again and its render thread rebuilds everything
+    // from what RetainedState kept. A context lost again before a frame was
+    // presented on it is not recovered from.
+    RetainedState retained;
+    int result = 0;
+    for (;;) {
+        SessionEnd end = runWindow(options, retained);
+        if (end == SessionFailed)
+            result = -1;
+        if (end != SessionContextLost)
+            break;
+        if (retained.recovering) {
+            std::cerr << "GPU reset again before recovering, giving up" << std::endl;
+            result = -1;
+            break;
+        }
+        retained.recovering = true;
+        ++retained.recoveries;
+        LogLine(LogInfo) << "GPU reset: creating a new window, recovery " << retained.recoveries;
+    }
 
     glfwTerminate();
-    return 0;
+    stopAsyncLog();
+    return result;
 }
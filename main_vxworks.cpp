@@ -1,92 +1,427 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
+#include <atomic>
 #include <iostream>
 #include <cstring>
+#include <memory>
+#include <vector>
+#include "allocation_guard.h"
+#include "async_log.h"
+#include "color_error.h"
+#include "damage_tracker.h"
+#include "display_self_test.h"
+#include "draw_batcher.h"
+#include "dynamic_resolution.h"
+#include "egl_present.h"
+#include "frame_arena.h"
+#include "frame_limiter.h"
+#include "frame_pacer.h"
+#include "frame_telemetry.h"
+#include "geometry_streamer.h"
+#include "gl_handle.h"
+#include "gl_trace.h"
+#include "gpu_reset.h"
+#include "job_system.h"
+#include "mesh_optimizer.h"
+#include "perf_counters.h"
+#include "platform_timer.h"
+#include "program_binary_cache.h"
+#include "render_options.h"
+#include "scene_file.h"
+#include "shader_library.h"
+#include "shader_manager.h"
 // For VxWorks, you may need taskLib for taskDelay
 #include <taskLib.h> 
 
-// Vertex shader with color attribute
-const char* vertexShaderSrc = R"(
-attribute vec4 a_position;
-attribute vec3 a_color;
-varying vec3 v_color;
-void main() {
-    gl_Position = a_position;
-    v_color = a_color;
-}
-)";
+// Triangle vertices (centered, normalized device coordinates) with a
+// color gradient (RGB per vertex)
+const SceneVertex triangleVertices[] = {
+    { {  0.0f,  0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f } },  // Top vertex, red
+    { { -0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f } },  // Bottom left, green
+    { {  0.5f, -0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } }   // Bottom right, blue
+};
 
-// Fragment shader with color gradient
-const char* fragmentShaderSrc = R"(
-precision mediump float;
-varying vec3 v_color;
-void main() {
-    gl_FragColor = vec4(v_color, 1.0);
-}
-)";
+// White background
+const GLfloat backgroundColor[] = { 1.0f, 1.0f, 1.0f };
 
-GLuint loadShader(GLenum type, const char* source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, nullptr);
-    glCompileShader(shader);
-    
-    GLint compiled;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-    if (!compiled) {
-        GLint infoLen = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
-        if (infoLen > 1) {
-            char* infoLog = new char[infoLen];
-            glGetShaderInfoLog(shader, infoLen, nullptr, infoLog);
-            std::cerr << "Error compiling shader:\n" << infoLog << std::endl;
-            delete[] infoLog;
-        }
-        glDeleteShader(shader);
-        return 0;
-    }
-    return shader;
+// Set by vx_stop() to make the render loop return.
+std::atomic<bool> stopRequested(false);
+
+// Call from the target shell to leave the render loop. vx_main() then
+// releases everything it created and returns, and can be started again.
+extern "C" void vx_stop() {
+    stopRequested = true;
 }
 
-GLuint createProgram(const char* vtxSrc, const char* fragSrc) {
-    GLuint vtxShader = loadShader(GL_VERTEX_SHADER, vtxSrc);
-    GLuint fragShader = loadShader(GL_FRAGMENT_SHADER, fragSrc);
+// How a render session ended
+enum SessionEnd {
+    SessionStopped,     // vx_stop() was called
+    SessionFailed,      // setup failed
+    SessionContextLost  // a GPU reset took the context
+};
+
+// What outlives the GL context of a render session. After a GPU reset the
+// next session rebuilds from here rather than from the file system and the
+// shader compiler: the scene stays mapped for its vertex buffers to be
+// uploaded again, programs come back from their binaries, and the
+// self-test keeps the signature it has learned.
+struct RetainedState {
+    SceneFile sceneFile;
+    ProgramBinaryCache programs;
+    uint32_t selfTestSignature;
+    bool hasSelfTestSignature;
+    uint64_t lostNs;  // when the context was last lost
+    bool recovering;  // until the first frame on the new context is presented
+    unsigned long recoveries;
+
+    RetainedState()
+        : selfTestSignature(0), hasSelfTestSignature(false), lostNs(0), recovering(false), recoveries(0) {}
+};
+
+// Creates every GL object on the current context and renders until
+// vx_stop() is called or the context is lost.
+SessionEnd renderSession(const RenderOptions& options, EGLDisplay display, EGLSurface surface,
+                         RetainedState& retained) {
+    // Get surface dimensions
+    EGLint width, height;
+    eglQuerySurface(display, surface, EGL_WIDTH, &width);
+    eglQuerySurface(display, surface, EGL_HEIGHT, &height);
+    std::cout << "Surface size: " << width << "x" << height << std::endl;
+    
+    // Optional GL call trace, started before any GL object is created.
+    // Traces from here replay on Linux with the GLES2 build of
+    // gl_trace_replay. A trace replays into one context, so only the
+    // first session is traced.
+    if (!options.glTracePath.empty() && retained.recoveries == 0 &&
+        !startGlTrace(options.glTracePath.c_str(), options.glTraceFrames))
+        return SessionFailed;
+    
+    GpuResetDetector resets;
     
-    if (!vtxShader || !fragShader) {
-        return 0;
+    // Start building the shader programs, every variant included. The
+    // driver compiles them while the scene loads; the first frame waits
+    // only for the ones it draws with. After a reset they are loaded from
+    // the binaries saved by the first session instead.
+    ShaderManager shaders(&retained.programs);
+    ShaderVariantCache variants(shaders);
+    int triangleProgram = variants.requestAll(kTriangleShader, options.shaderFeatures);
+    
+    // Optional colour accuracy check of the built-in triangle, reduced on
+    // the GPU so that only a few bytes per checked frame are read back.
+    std::unique_ptr<ColorErrorMonitor> colorCheck;
+    if (options.colorCheckInterval > 0) {
+        if (!options.scenePath.empty() || options.fieldTriangles > 0) {
+            LogLine(LogError) << "Color check needs the built-in triangle, disabled";
+        } else if (options.dynamicResolutionBudgetMs > 0.0) {
+            LogLine(LogError) << "Color check needs native resolution, disabled";
+        } else {
+            colorCheck.reset(new ColorErrorMonitor(shaders, variants, triangleVertices, backgroundColor,
+                                                   options.colorCheckInterval));
+        }
+    }
+    
+    // Optional periodic self-test of the GPU with a known pattern, drawn
+    // offscreen whatever the scene is.
+    std::unique_ptr<DisplaySelfTest> selfTest;
+    if (options.selfTestInterval > 0) {
+        selfTest.reset(new DisplaySelfTest(shaders, variants, options.selfTestInterval,
+                                           retained.selfTestSignature, retained.hasSelfTestSignature));
+    }
+    
+    // Optionally render a scene file instead. It is memory mapped and
+    // uploaded straight from the mapping into a vertex buffer, or streamed
+    // in chunks through a fixed set of buffers if it is too large for that.
+    // The mapping is kept for the next session.
+    SceneBuffers scene = SceneBuffers();
+    std::unique_ptr<GeometryStreamer> streamer;
+    if (!options.scenePath.empty() && options.streamBuffers > 0) {
+        streamer.reset(new GeometryStreamer(options.streamBuffers));
+        if (!streamer->open(options.scenePath.c_str())) {
+            std::cerr << "Failed to open scene for streaming" << std::endl;
+            return SessionFailed;
+        }
+    } else if (!options.scenePath.empty()) {
+        uint64_t loadStart = monotonicNowNs();
+        SceneFile& sceneFile = retained.sceneFile;
+        if ((!sceneFile.isOpen() && !sceneFile.open(options.scenePath.c_str())) || !uploadScene(sceneFile, scene)) {
+            std::cerr << "Failed to load scene" << std::endl;
+            return SessionFailed;
+        }
+        glFinish();
+        double loadMs = nsToMs(monotonicNowNs() - loadStart);
+        std::cout << "Loaded scene " << options.scenePath << ": " << scene.vertexCount << " vertices, "
+                  << scene.indexCount << " indices in " << loadMs << " ms" << std::endl;
+    }
+    
+    if (!shaders.waitForRequired()) {
+        std::cerr << "Failed to create shader program" << std::endl;
+        return SessionFailed;
     }
+    GLuint program = shaders.program(triangleProgram);
+    
+    // Get attribute locations, in SceneVertexLayout order
+    const GLint attribLocations[] = {
+        glGetAttribLocation(program, "a_position"),
+        glGetAttribLocation(program, "a_color")
+    };
+    
+    // Set viewport
+    glViewport(0, 0, width, height);
+    
+    glClearColor(backgroundColor[0], backgroundColor[1], backgroundColor[2], 1.0f);
+    
+    if (colorCheck && !colorCheck->create(width, height)) {
+        std::cerr << "Color check unavailable" << std::endl;
+        colorCheck.reset();
+    }
+    
+    // The self-test was asked for by the safety case, so rendering without
+    // it is not an option.
+    if (selfTest && !selfTest->create(width, height)) {
+        std::cerr << "Failed to start display self-test" << std::endl;
+        return SessionFailed;
+    }
+    
+    // Client-side arrays are re-specified per draw because the upscale pass
+    // of the dynamic resolution target shares attribute slots with us.
+    auto bindVertexBuffer = [&](GLuint buffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        SceneVertexLayout::bind(attribLocations);
+    };
+    
+    // Optional job system for per-frame CPU work. This thread is worker 0
+    // and helps while it waits, so jobs are dispatched from here.
+    std::unique_ptr<JobSystem> jobs;
+    if (options.jobThreads > 1)
+        jobs.reset(new JobSystem(options.jobThreads));
+    
+    // Scratch memory for the current frame, released after every swap
+    FrameArena frameArena(static_cast<size_t>(options.frameArenaKb) * 1024);
+    
+    // Optional test scene of many small triangle draws
+    std::unique_ptr<TriangleField> field;
+    if (options.fieldTriangles > 0)
+        field.reset(new TriangleField(options.fieldTriangles, options.batching, jobs.get(), &frameArena));
+    
+    auto drawTriangle = [&]() {
+        glUseProgram(program);
+        
+        if (field) {
+            field->draw(bindVertexBuffer);
+        } else if (streamer) {
+            streamer->draw([&](GLuint buffer, GLsizei vertexCount) {
+                bindVertexBuffer(buffer);
+                glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+            });
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        } else if (scene.vertexBuffer) {
+            bindVertexBuffer(scene.vertexBuffer);
+            drawSceneBuffers(scene);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        } else {
+            SceneVertexLayout::bind(attribLocations, triangleVertices);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        
+        SceneVertexLayout::disable(attribLocations);
+    };
+    
+    // Only the damaged part of the surface is repainted and presented. The
+    // first frame damages everything; after that the scene is static and
+    // nothing is redrawn until something adds damage.
+    DamageTracker damage;
+    damage.resize(width, height);
+    EglPresenter presenter(display, surface);
+    
+    // Optional dynamic resolution: render offscreen at a scale chosen to fit
+    // the frame budget, then upscale to the surface. This redraws every
+    // frame, paced by eglSwapBuffers.
+    bool dynamicResolution = options.dynamicResolutionBudgetMs > 0.0;
+    ResolutionController resolution(options.dynamicResolutionBudgetMs);
+    ScaledRenderTarget scaledTarget;
+    if (dynamicResolution && !scaledTarget.create(width, height)) {
+        std::cerr << "Dynamic resolution unavailable, rendering at native size" << std::endl;
+        dynamicResolution = false;
+    }
+    
+    // Optional CPU frame pacing. taskDelay() only resolves whole system
+    // ticks, so the pacer sleeps most of the period and spins the rest.
+    bool pacing = options.frameRateHz > 0.0;
+    FramePacer pacer(pacing ? options.frameRateHz : 60.0);
+    if (pacing)
+        eglSwapInterval(display, 0);
+    // The colour check also needs every frame drawn in full.
+    bool continuousRendering = dynamicResolution || pacing || streamer || colorCheck;
+    
+    // Optional bound on how far the CPU may run ahead of the GPU
+    FrameLimiter frameLimiter(options.maxFramesInFlight);
+    
+    // Frame, GPU and swap time histograms, always recorded and exported
+    // when a sink is configured. Without timer queries, GPU time is only
+    // known from the glFinish-based measurement of dynamic resolution.
+    FrameTelemetry telemetry(options.telemetrySink, options.telemetryIntervalSeconds);
+    
+    // Optional per-phase counters. perf_event_open is Linux only, so here
+    // they measure wall time. The limiter and pacer waits are left out.
+    PhaseCounters phases(options.perfCounters);
+    
+    // Bookkeeping after each swap: release the frame's scratch memory and,
+    // in the zero-allocation test mode, arm the allocation guard once the
+    // warmup frames are done.
+    // The first frame after a reset completes the recovery.
+    unsigned long framesPresented = 0;
+    auto framePresented = [&]() {
+        frameArena.reset();
+        if (++framesPresented == static_cast<unsigned long>(options.allocationCheckFrames)) {
+            LogLine(LogInfo) << "Allocation guard armed after " << framesPresented << " frames";
+            armAllocationGuard();
+        }
+        if (retained.recovering) {
+            LogLine(LogInfo) << "GPU reset: recovered in " << nsToMs(monotonicNowNs() - retained.lostNs) << " ms ("
+                             << shaders.loadedFromBinary() << " of " << shaders.programs()
+                             << " programs from cached binaries)";
+            retained.recovering = false;
+        }
+    };
+    
+    std::cout << "Rendering triangle. Call vx_stop() from the target shell to exit..." << std::endl;
     
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vtxShader);
-    glAttachShader(program, fragShader);
-    glLinkProgram(program);
-    
-    GLint linked;
-    glGetProgramiv(program, GL_LINK_STATUS, &linked);
-    if (!linked) {
-        GLint infoLen = 0;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLen);
-        if (infoLen > 1) {
-            char* infoLog = new char[infoLen];
-            glGetProgramInfoLog(program, infoLen, nullptr, infoLog);
-            std::cerr << "Error linking program:\n" << infoLog << std::endl;
-            delete[] infoLog;
-        }
-        glDeleteProgram(program);
-        return 0;
+    // Keep running until stopped (in real application, you'd have a proper event loop)
+    SessionEnd end = SessionStopped;
+    bool swapLost = false;
+    while (!stopRequested) {
+        // After a reset every GL call is a no-op; vx_main() carries on
+        // with a new context.
+        if (swapLost || resets.contextLost()) {
+            retained.lostNs = monotonicNowNs();
+            if (swapLost)
+                LogLine(LogError) << "EGL context lost on swap";
+            end = SessionContextLost;
+            break;
+        }
+        
+        // Idle iterations run the self-test too, so faults are still found
+        // while nothing is redrawn.
+        if (selfTest)
+            selfTest->update();
+        
+        if (continuousRendering)
+            damage.addFull();
+        
+        if (damage.empty()) {
+            taskDelay(60);  // VxWorks sleep for ~1 second (assuming 60 ticks/sec)
+            telemetry.tick(monotonicNowNs());
+            continue;
+        }
+        
+        uint64_t frameStartNs = monotonicNowNs();
+        frameLimiter.waitForSlot();
+        phases.begin(SetupPhase);
+        shaders.poll();
+        if (streamer)
+            streamer->update();
+        phases.end(SetupPhase);
+        if (colorCheck) {
+            phases.begin(ReadbackPhase);
+            colorCheck->poll();
+            phases.end(ReadbackPhase);
+        }
+        
+        if (dynamicResolution) {
+            // GLES2 has no timer queries, so the frame cost is measured on
+            // the CPU up to a glFinish. That excludes the vsync wait in
+            // eglSwapBuffers, which would otherwise hide any headroom.
+            uint64_t start = monotonicNowNs();
+            phases.begin(SubmitPhase);
+            scaledTarget.begin(resolution.scale());
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawTriangle();
+            scaledTarget.present();
+            glFinish();
+            phases.end(SubmitPhase);
+            double frameMs = nsToMs(monotonicNowNs() - start);
+            resolution.update(frameMs);
+            telemetry.recordGpuMs(frameMs);
+            
+            if (pacing)
+                pacer.wait();
+            phases.begin(SwapPhase);
+            uint64_t swapNs = monotonicNowNs();
+            swapLost = !eglSwapBuffers(display, surface) && eglGetError() == EGL_CONTEXT_LOST;
+            phases.end(SwapPhase);
+            traceSwap();
+            telemetry.framePresented(frameStartNs, swapNs, monotonicNowNs());
+            frameLimiter.frameSubmitted();
+            damage.endFrame();
+            framePresented();
+            phases.frameEnd();
+            continue;
+        }
+        
+        phases.begin(SetupPhase);
+        const std::vector<DamageRect>& repaint = damage.repaintRects(presenter.bufferAge());
+        presenter.setDamageRegion(repaint);
+        phases.end(SetupPhase);
+        phases.begin(SubmitPhase);
+        for (size_t i = 0; i < repaint.size(); ++i) {
+            scissorToDamage(&repaint[i]);
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawTriangle();
+        }
+        scissorToDamage(nullptr);
+        phases.end(SubmitPhase);
+        
+        if (colorCheck) {
+            phases.begin(ReadbackPhase);
+            colorCheck->frameDrawn(0.0f);
+            phases.end(ReadbackPhase);
+        }
+        
+        if (pacing)
+            pacer.wait();
+        phases.begin(SwapPhase);
+        uint64_t swapNs = monotonicNowNs();
+        swapLost = !presenter.swap(damage.frameRects()) && eglGetError() == EGL_CONTEXT_LOST;
+        phases.end(SwapPhase);
+        traceSwap();
+        telemetry.framePresented(frameStartNs, swapNs, monotonicNowNs());
+        frameLimiter.frameSubmitted();
+        damage.endFrame();
+        framePresented();
+        phases.frameEnd();
     }
     
-    glDeleteShader(vtxShader);
-    glDeleteShader(fragShader);
+    // Cleanup. GL objects not released here are released by their owners
+    // on return; on a lost context, deleting them does nothing.
+    disarmAllocationGuard();
+    phases.report();
+    field.reset();
+    streamer.reset();
+    colorCheck.reset();
+    if (selfTest && selfTest->hasSignature()) {
+        retained.selfTestSignature = selfTest->signature();
+        retained.hasSelfTestSignature = true;
+    }
+    selfTest.reset();
+    deleteSceneBuffers(scene);
+    shaders.destroy();
+    stopGlTrace();
     
-    return program;
+    return end;
 }
 
 // Entry point for VxWorks is often not 'main', but a function with a specific signature.
 // Renaming to 'vx_main' for clarity, but you should adjust to your RTP's entry point.
-int vx_main() {
-    // EGL initialization
-    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
-    if (display == EGL_NO_DISPLAY) {
+int vx_main(const RenderOptions& options) {
+    stopRequested = false;
+    
+    // EGL initialization. The handles release the display, surface and
+    // contexts on every return, so vx_main() can be called again to restart
+    // rendering without leaking them.
+    EglDisplay eglDisplay(eglGetDisplay(EGL_DEFAULT_DISPLAY));
+    EGLDisplay display = eglDisplay.get();
+    if (!eglDisplay) {
         std::cerr << "Failed to get EGL display" << std::endl;
         return -1;
     }
@@ -120,96 +455,45 @@ int vx_main() {
     
     // Create window surface (uses Vivante framebuffer on i.MX6)
     EGLNativeWindowType nativeWindow = 0; // VxWorks/Vivante uses NULL for default FB
-    EGLSurface surface = eglCreateWindowSurface(display, config, nativeWindow, nullptr);
-    if (surface == EGL_NO_SURFACE) {
+    EglSurface surface(display, eglCreateWindowSurface(display, config, nativeWindow, nullptr));
+    if (!surface) {
         std::cerr << "Failed to create EGL surface" << std::endl;
         return -1;
     }
     
-    // Create OpenGL ES 2.0 context
-    EGLint contextAttribs[] = {
-        EGL_CONTEXT_CLIENT_VERSION, 2,
-        EGL_NONE
-    };
-    
-    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
-    if (context == EGL_NO_CONTEXT) {
-        std::cerr << "Failed to create EGL context" << std::endl;
-        return -1;
-    }
-    
-    if (!eglMakeCurrent(display, surface, surface, context)) {
-        std::cerr << "Failed to make EGL context current" << std::endl;
-        return -1;
-    }
-    
-    // Get surface dimensions
-    EGLint width, height;
-    eglQuerySurface(display, surface, EGL_WIDTH, &width);
-    eglQuerySurface(display, surface, EGL_HEIGHT, &height);
-    std::cout << "Surface size: " << width << "x" << height << std::endl;
-    
-    // Create shader program
-    GLuint program = createProgram(vertexShaderSrc, fragmentShaderSrc);
-    if (!program) {
-        std::cerr << "Failed to create shader program" << std::endl;
-        return -1;
-    }
-    
-    // Get attribute locations
-    GLint positionLoc = glGetAttribLocation(program, "a_position");
-    GLint colorLoc = glGetAttribLocation(program, "a_color");
-    
-    // Triangle vertices (centered, normalized device coordinates)
-    GLfloat vertices[] = {
-         0.0f,  0.5f, 0.0f,  // Top vertex
-        -0.5f, -0.5f, 0.0f,  // Bottom left
-         0.5f, -0.5f, 0.0f   // Bottom right
-    };
-    
-    // Color gradient (RGB per vertex)
-    GLfloat colors[] = {
-        1.0f, 0.0f, 0.0f,  // Red
-        0.0f, 1.0f, 0.0f,  // Green
-        0.0f, 0.0f, 1.0f   // Blue
-    };
-    
-    // Set viewport
-    glViewport(0, 0, width, height);
-    
-    // Rendering loop (render once for this example)
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);  // White background
-    glClear(GL_COLOR_BUFFER_BIT);
-    
-    glUseProgram(program);
-    
-    glVertexAttribPointer(positionLoc, 3, GL_FLOAT, GL_FALSE, 0, vertices);
-    glEnableVertexAttribArray(positionLoc);
-    
-    glVertexAttribPointer(colorLoc, 3, GL_FLOAT, GL_FALSE, 0, colors);
-    glEnableVertexAttribArray(colorLoc);
-    
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-    
-    glDisableVertexAttribArray(positionLoc);
-    glDisableVertexAttribArray(colorLoc);
-    
-    eglSwapBuffers(display, surface);
-    
-    std::cout << "Triangle rendered. Press Ctrl+C in host shell to exit..." << std::endl;
-    
-    // Keep running (in real application, you'd have a proper event loop)
-    while (true) {
-        taskDelay(60);  // VxWorks sleep for ~1 second (assuming 60 ticks/sec)
+    // Each render session gets its own OpenGL ES 2.0 context. When a GPU
+    // reset loses it, the context is created again on the same surface and
+    // the next session rebuilds everything from what RetainedState kept.
+    // A context lost again before a frame was presented on it is not
+    // recovered from.
+    RetainedState retained;
+    retained.selfTestSignature = options.selfTestSignature;
+    retained.hasSelfTestSignature = options.hasSelfTestSignature;
+    for (;;) {
+        EglContext context(display, createRobustContext(display, config));
+        if (!context) {
+            std::cerr << "Failed to create EGL context" << std::endl;
+            return -1;
+        }
+        
+        if (!eglMakeCurrent(display, surface.get(), surface.get(), context.get())) {
+            std::cerr << "Failed to make EGL context current" << std::endl;
+            return -1;
+        }
+        
+        SessionEnd end = renderSession(options, display, surface.get(), retained);
+        if (end == SessionStopped)
+            return 0;
+        if (end == SessionFailed)
+            return -1;
+        if (retained.recovering) {
+            std::cerr << "GPU reset again before recovering, giving up" << std::endl;
+            return -1;
+        }
+        retained.recovering = true;
+        ++retained.recoveries;
+        LogLine(LogInfo) << "GPU reset: creating a new context, recovery " << retained.recoveries;
     }
-    
-    // Cleanup (won't reach here without proper signal handling)
-    glDeleteProgram(program);
-    eglDestroySurface(display, surface);
-    eglDestroyContext(display, context);
-    eglTerminate(display);
-    
-    return 0;
 }
 
 // In many VxWorks systems, 'main' is not the entry point for a Real-Time Process (RTP).
@@ -217,5 +501,35 @@ int vx_main() {
 // If your system does use 'main', you can just rename 'vx_main' to 'main'.
 int main(int argc, char *argv[])
 {
-    return vx_main();
+    RenderOptions options;
+    if (!parseRenderOptions(argc, argv, options))
+        return -1;
+    
+    // Import stage: index, deduplicate and cache-optimize the built-in
+    // triangle or the given scene, write the result and exit.
+    if (!options.exportScenePath.empty()) {
+        bool written;
+        if (!options.scenePath.empty()) {
+            SceneFile source;
+            if (!source.open(options.scenePath.c_str()))
+                return -1;
+            const SceneHeader& h = source.header();
+            written = importScene(static_cast<const float*>(source.vertices()), h.vertexCount,
+                                  source.indices(), h.indexCount, h.indexSize,
+                                  options.exportScenePath.c_str());
+        } else {
+            written = importScene(triangleVertices[0].position, 3, nullptr, 0, 0,
+                                  options.exportScenePath.c_str());
+        }
+        return written ? 0 : -1;
+    }
+    
+    // Messages from the render loop are queued and written to the console
+    // by a low-priority task, so logging never stalls a frame.
+    if (!startAsyncLog(options.logPath.empty() ? nullptr : options.logPath.c_str()))
+        return -1;
+    
+    int result = vx_main(options);
+    stopAsyncLog();
+    return result;
 }
@@ -0,0 +1,228 @@
+#include "mesh_optimizer.h"
+#include "platform_timer.h"
+#include "scene_file.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const size_t kFloatsPerVertex = kSceneVertexStride / sizeof(float);
+const uint32_t kEmpty = 0xffffffffu;
+
+uint64_t hashVertex(const float* v) {
+    // FNV-1a over the raw bytes, so only bit-identical vertices collide.
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(v);
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < kSceneVertexStride; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Next vertex to fan around once the candidates are exhausted: the most
+// recently touched vertex that still has triangles, else the next one in
+// input order.
+int skipDeadEnd(const std::vector<uint32_t>& live, std::vector<uint32_t>& deadEnd,
+                size_t& cursor, size_t vertexCount) {
+    while (!deadEnd.empty()) {
+        uint32_t d = deadEnd.back();
+        deadEnd.pop_back();
+        if (live[d] > 0)
+            return static_cast<int>(d);
+    }
+    while (cursor < vertexCount) {
+        if (live[cursor] > 0)
+            return static_cast<int>(cursor++);
+        ++cursor;
+    }
+    return -1;
+}
+
+} // namespace
+
+size_t IndexedMesh::vertexCount() const {
+    return vertices.size() / kFloatsPerVertex;
+}
+
+void deduplicateVertices(const float* vertices, size_t vertexCount,
+                         const uint32_t* indices, size_t indexCount,
+                         IndexedMesh& mesh) {
+    size_t tableSize = 16;
+    while (tableSize < vertexCount * 2)
+        tableSize *= 2;
+    std::vector<uint32_t> table(tableSize, kEmpty);
+    std::vector<uint32_t> remap(vertexCount);
+
+    mesh.vertices.clear();
+    mesh.vertices.reserve(vertexCount * kFloatsPerVertex);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* v = vertices + i * kFloatsPerVertex;
+        size_t slot = hashVertex(v) & (tableSize - 1);
+        while (table[slot] != kEmpty &&
+               memcmp(&mesh.vertices[table[slot] * kFloatsPerVertex], v, kSceneVertexStride) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+        if (table[slot] == kEmpty) {
+            table[slot] = static_cast<uint32_t>(mesh.vertices.size() / kFloatsPerVertex);
+            mesh.vertices.insert(mesh.vertices.end(), v, v + kFloatsPerVertex);
+        }
+        remap[i] = table[slot];
+    }
+
+    size_t count = indices ? indexCount : vertexCount;
+    mesh.indices.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        mesh.indices[i] = remap[indices ? indices[i] : i];
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Vertex-triangle adjacency as offsets into one flat array.
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++live[indices[i]];
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + live[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k)
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+    int fan = 0;
+    while (fan >= 0) {
+        candidates.clear();
+        for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+            uint32_t t = adjacency[a];
+            if (emitted[t])
+                continue;
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cacheTime[v] > static_cast<uint32_t>(cacheSize))
+                    cacheTime[v] = time++;
+            }
+            emitted[t] = true;
+        }
+
+        // Prefer the candidate that will still be in the cache after its
+        // remaining triangles are emitted, and among those the oldest.
+        int best = -1;
+        int bestPriority = -1;
+        for (size_t c = 0; c < candidates.size(); ++c) {
+            uint32_t v = candidates[c];
+            if (live[v] == 0)
+                continue;
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= static_cast<uint32_t>(cacheSize))
+                priority = static_cast<int>(time - cacheTime[v]);
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = static_cast<int>(v);
+            }
+        }
+        fan = best >= 0 ? best : skipDeadEnd(live, deadEnd, cursor, vertexCount);
+    }
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(IndexedMesh& mesh) {
+    size_t vertexCount = mesh.vertexCount();
+    std::vector<uint32_t> remap(vertexCount, kEmpty);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+    uint32_t next = 0;
+    for (size_t i = 0; i < mesh.indices.size(); ++i) {
+        uint32_t& index = mesh.indices[i];
+        if (remap[index] == kEmpty) {
+            remap[index] = next++;
+            const float* v = &mesh.vertices[index * kFloatsPerVertex];
+            vertices.insert(vertices.end(), v, v + kFloatsPerVertex);
+        }
+        index = remap[index];
+    }
+    // Vertices no triangle refers to are dropped.
+    mesh.vertices.swap(vertices);
+}
+
+double computeAcmr(const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize) {
+    if (indexCount < 3)
+        return 0.0;
+    // FIFO cache simulated with insertion timestamps.
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    size_t clock = cacheSize + 1;
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t v = indices[i];
+        if (clock - insertedAt[v] > static_cast<size_t>(cacheSize)) {
+            insertedAt[v] = clock++;
+            ++misses;
+        }
+    }
+    return static_cast<double>(misses) / (indexCount / 3);
+}
+
+bool importScene(const float* vertices, uint64_t vertexCount,
+                 const void* indices, uint64_t indexCount, uint32_t indexSize,
+                 const char* outputPath) {
+    if (vertexCount < 3 || (indices && indexCount < 3)) {
+        std::cerr << "Nothing to import" << std::endl;
+        return false;
+    }
+    uint64_t start = monotonicNowNs();
+
+    std::vector<uint32_t> wideIndices;
+    if (indices) {
+        wideIndices.resize(indexCount);
+        for (uint64_t i = 0; i < indexCount; ++i) {
+            wideIndices[i] = indexSize == 2 ? static_cast<const uint16_t*>(indices)[i]
+                                            : static_cast<const uint32_t*>(indices)[i];
+            // Deduplication and the ACMR count index per-vertex tables.
+            if (wideIndices[i] >= vertexCount) {
+                std::cerr << "Index " << i << " refers to vertex " << wideIndices[i] << " of " << vertexCount
+                          << ", not imported" << std::endl;
+                return false;
+            }
+        }
+    }
+    double inputAcmr = indices ? computeAcmr(&wideIndices[0], indexCount, vertexCount) : 3.0;
+
+    IndexedMesh mesh;
+    deduplicateVertices(vertices, vertexCount, indices ? &wideIndices[0] : nullptr, indexCount, mesh);
+    double dedupAcmr = computeAcmr(&mesh.indices[0], mesh.indices.size(), mesh.vertexCount());
+
+    optimizeVertexCache(mesh.indices, mesh.vertexCount());
+    optimizeVertexFetch(mesh);
+    double optimizedAcmr = computeAcmr(&mesh.indices[0], mesh.indices.size(), mesh.vertexCount());
+
+    std::cout << "Imported " << mesh.indices.size() / 3 << " triangles: " << vertexCount << " -> "
+              << mesh.vertexCount() << " vertices, ACMR " << inputAcmr << " (input), "
+              << dedupAcmr << " (indexed), " << optimizedAcmr << " (optimized) in "
+              << nsToMs(monotonicNowNs() - start) << " ms" << std::endl;
+
+    if (mesh.vertexCount() <= 0x10000) {
+        std::vector<uint16_t> narrow(mesh.indices.begin(), mesh.indices.end());
+        return writeSceneFile(outputPath, &mesh.vertices[0], mesh.vertexCount(),
+                              &narrow[0], narrow.size(), sizeof(uint16_t));
+    }
+    return writeSceneFile(outputPath, &mesh.vertices[0], mesh.vertexCount(),
+                          &mesh.indices[0], mesh.indices.size(), sizeof(uint32_t));
+}
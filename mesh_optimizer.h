@@ -0,0 +1,43 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Import-time preparation of triangle meshes for indexed drawing.
+
+// Indexed triangle list with the scene file's interleaved vertex layout.
+struct IndexedMesh {
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+
+    size_t vertexCount() const;
+};
+
+// Builds an indexed mesh in which bit-identical vertices are shared.
+// indices may be null, in which case the input is a plain triangle list.
+// Every index must be less than vertexCount, here and below.
+void deduplicateVertices(const float* vertices, size_t vertexCount,
+                         const uint32_t* indices, size_t indexCount,
+                         IndexedMesh& mesh);
+
+// Reorders triangles for post-transform cache locality using Tipsify
+// (Sander, Nehab and Barczak, 2007), which runs in linear time.
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 16);
+
+// Renumbers vertices in order of first use so fetches walk memory forwards.
+void optimizeVertexFetch(IndexedMesh& mesh);
+
+// Average cache miss ratio: vertex shader invocations per triangle for a
+// FIFO post-transform cache of the given size. 3.0 is the worst case.
+double computeAcmr(const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize = 16);
+
+// Runs the whole import stage on a scene and writes it as an indexed scene
+// file, with 16-bit indices when the vertex count allows. indexSize is 0
+// for non-indexed input. Reports the ACMR before and after.
+bool importScene(const float* vertices, uint64_t vertexCount,
+                 const void* indices, uint64_t indexCount, uint32_t indexSize,
+                 const char* outputPath);
+
+#endif // MESH_OPTIMIZER_H
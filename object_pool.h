@@ -0,0 +1,76 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <cstdlib>
+#include <new>
+#include <stddef.h>
+
+// Fixed-capacity pool for long-lived objects that come and go at run time.
+// Storage for every object is allocated once by the constructor; acquire()
+// and release() only move slots on and off an intrusive free list, so a
+// steady state never reaches the heap. acquire() returns nullptr instead of
+// growing when the pool is empty. Not thread-safe; callers that share a
+// pool across threads must lock around it.
+template <typename T>
+class ObjectPool {
+public:
+    explicit ObjectPool(size_t capacity)
+        : slots_(nullptr), free_(nullptr), capacity_(capacity), available_(0) {
+        if (capacity_ == 0)
+            return;
+        slots_ = static_cast<Slot*>(malloc(capacity_ * sizeof(Slot)));
+        if (!slots_) {
+            capacity_ = 0;
+            return;
+        }
+        for (size_t i = capacity_; i-- > 0;) {
+            slots_[i].next = free_;
+            free_ = &slots_[i];
+        }
+        available_ = capacity_;
+    }
+
+    // Objects still acquired are not destroyed.
+    ~ObjectPool() {
+        free(slots_);
+    }
+
+    // Default-constructs an object in a free slot.
+    T* acquire() {
+        if (!free_)
+            return nullptr;
+        Slot* slot = free_;
+        free_ = slot->next;
+        --available_;
+        return new (slot->storage) T();
+    }
+
+    void release(T* object) {
+        if (!object)
+            return;
+        object->~T();
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = free_;
+        free_ = slot;
+        ++available_;
+    }
+
+    size_t capacity() const { return capacity_; }
+    size_t available() const { return available_; }
+
+private:
+    ObjectPool(const ObjectPool&);
+    ObjectPool& operator=(const ObjectPool&);
+
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    Slot* slots_;
+    Slot* free_;
+    size_t capacity_;
+    size_t available_;
+};
+
+#endif // OBJECT_POOL_H
@@ -0,0 +1,185 @@
+#include "perf_counters.h"
+
+#include "async_log.h"
+#include "platform_timer.h"
+
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const unsigned long kLogInterval = 300;
+
+const char* const kPhaseNames[kRenderPhaseCount] = {
+    "setup   ",
+    "submit  ",
+    "swap    ",
+    "readback"
+};
+
+#ifdef __linux__
+const uint64_t kEventConfigs[] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+// Layout of a PERF_FORMAT_GROUP read with both time fields.
+struct GroupRead {
+    uint64_t count;
+    uint64_t enabledNs;
+    uint64_t runningNs;
+    uint64_t values[4];
+};
+
+int openEvent(uint64_t config, int groupFd, bool excludeKernel) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // The leader starts disabled so the whole group is enabled at once.
+    attr.disabled = groupFd < 0 ? 1 : 0;
+    attr.exclude_kernel = excludeKernel ? 1 : 0;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+#endif
+
+} // namespace
+
+PhaseCounters::PhaseCounters(bool enabled)
+    : enabled_(enabled), groupFd_(-1), eventCount_(0), frames_(0) {
+    for (int e = 0; e < kEventCount; ++e) {
+        fds_[e] = -1;
+        slot_[e] = -1;
+    }
+    memset(&start_, 0, sizeof(start_));
+    memset(totals_, 0, sizeof(totals_));
+    if (!enabled_)
+        return;
+
+#ifdef __linux__
+    // Time spent in the kernel half of the driver counts too, but with
+    // perf_event_paranoid >= 2 only user space may be measured.
+    bool excludeKernel = false;
+    groupFd_ = openEvent(kEventConfigs[Cycles], -1, excludeKernel);
+    if (groupFd_ < 0 && (errno == EACCES || errno == EPERM)) {
+        excludeKernel = true;
+        groupFd_ = openEvent(kEventConfigs[Cycles], -1, excludeKernel);
+    }
+    if (groupFd_ < 0) {
+        LogLine(LogInfo) << "Performance counters unavailable (" << strerror(errno)
+                         << "), measuring wall time only";
+        return;
+    }
+    fds_[Cycles] = groupFd_;
+    slot_[Cycles] = eventCount_++;
+    for (int e = Cycles + 1; e < kEventCount; ++e) {
+        fds_[e] = openEvent(kEventConfigs[e], groupFd_, excludeKernel);
+        if (fds_[e] >= 0)
+            slot_[e] = eventCount_++;
+    }
+    ioctl(groupFd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(groupFd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    LogLine(LogInfo) << "Performance counters: " << eventCount_ << " of " << static_cast<int>(kEventCount)
+                     << " events" << (excludeKernel ? ", user space only" : "");
+#else
+    LogLine(LogInfo) << "Performance counters unavailable on this platform, measuring wall time only";
+#endif
+}
+
+PhaseCounters::~PhaseCounters() {
+#ifdef __linux__
+    // Members first, the leader last.
+    for (int e = kEventCount - 1; e >= 0; --e) {
+        if (fds_[e] >= 0)
+            close(fds_[e]);
+    }
+#endif
+}
+
+void PhaseCounters::read(Reading& reading) const {
+    reading.wallNs = monotonicNowNs();
+#ifdef __linux__
+    if (groupFd_ < 0)
+        return;
+    GroupRead group;
+    if (::read(groupFd_, &group, sizeof(group)) < static_cast<ssize_t>(3 * sizeof(uint64_t)))
+        return;
+    reading.enabledNs = group.enabledNs;
+    reading.runningNs = group.runningNs;
+    for (int e = 0; e < kEventCount; ++e) {
+        if (slot_[e] >= 0)
+            reading.values[e] = group.values[slot_[e]];
+    }
+#endif
+}
+
+void PhaseCounters::begin(RenderPhase phase) {
+    (void)phase;
+    if (enabled_)
+        read(start_);
+}
+
+void PhaseCounters::end(RenderPhase phase) {
+    if (!enabled_)
+        return;
+    Reading now = start_;
+    read(now);
+
+    Totals& totals = totals_[phase];
+    totals.wallNs += now.wallNs - start_.wallNs;
+    ++totals.samples;
+    if (eventCount_ == 0)
+        return;
+
+    // When more events are enabled than the PMU has counters, the kernel
+    // time-slices the group; extrapolate to the full interval.
+    uint64_t enabled = now.enabledNs - start_.enabledNs;
+    uint64_t running = now.runningNs - start_.runningNs;
+    if (running == 0)
+        return;
+    double scale = running < enabled ? static_cast<double>(enabled) / running : 1.0;
+    for (int e = 0; e < kEventCount; ++e)
+        totals.values[e] += (now.values[e] - start_.values[e]) * scale;
+}
+
+void PhaseCounters::frameEnd() {
+    if (enabled_ && ++frames_ % kLogInterval == 0)
+        report();
+}
+
+void PhaseCounters::report() const {
+    if (frames_ == 0)
+        return;
+    LogLine(LogInfo) << "Render phases, per frame over " << frames_ << " frames:";
+    for (int p = 0; p < kRenderPhaseCount; ++p) {
+        const Totals& totals = totals_[p];
+        if (totals.samples == 0)
+            continue;
+        LogLine line(LogInfo);
+        line << "  " << kPhaseNames[p] << " " << nsToMs(totals.wallNs) / frames_ << " ms";
+        if (slot_[Cycles] >= 0)
+            line << ", " << totals.values[Cycles] / frames_ << " cycles";
+        if (slot_[Instructions] >= 0) {
+            line << ", " << totals.values[Instructions] / frames_ << " instructions";
+            if (totals.values[Cycles] > 0.0)
+                line << " (IPC " << totals.values[Instructions] / totals.values[Cycles] << ")";
+        }
+        if (slot_[CacheMisses] >= 0)
+            line << ", " << totals.values[CacheMisses] / frames_ << " cache misses";
+        if (slot_[BranchMisses] >= 0)
+            line << ", " << totals.values[BranchMisses] / frames_ << " branch misses";
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+// Phases of one iteration of the render loop.
+enum RenderPhase {
+    SetupPhase,     // input, streaming, per-frame state
+    SubmitPhase,    // clears and draw calls
+    SwapPhase,      // the buffer swap call
+    ReadbackPhase,  // readbacks and verification of presented frames
+    kRenderPhaseCount
+};
+
+// Hardware performance counters per render-loop phase, to tell whether
+// the CPU side of the driver is bound by cache misses, branch misses or
+// plain instruction count.
+//
+// On Linux the calling thread gets one perf_event_open group of cycles,
+// instructions, cache misses and branch misses, read with a single
+// syscall at each phase boundary. Counters the kernel or the PMU refuse
+// (perf_event_paranoid, virtual machines) are left out, and multiplexed
+// counts are scaled by enabled over running time. Elsewhere, or with no
+// counters at all, only wall time is measured.
+//
+// Everything must be called from the thread that constructed the object,
+// as the counters only follow that thread. Phases must not nest. When
+// constructed disabled, every call returns immediately.
+class PhaseCounters {
+public:
+    explicit PhaseCounters(bool enabled);
+    ~PhaseCounters();
+
+    bool enabled() const { return enabled_; }
+
+    // True when at least the cycle counter could be opened.
+    bool hardwareCounters() const { return eventCount_ > 0; }
+
+    void begin(RenderPhase phase);
+    void end(RenderPhase phase);
+
+    // Counts one frame and periodically logs the per-frame averages.
+    void frameEnd();
+
+    // Logs the per-frame averages of each phase over the whole run.
+    void report() const;
+
+private:
+    PhaseCounters(const PhaseCounters&);
+    PhaseCounters& operator=(const PhaseCounters&);
+
+    enum Event {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        kEventCount
+    };
+
+    // Raw counter values as read at one point in time.
+    struct Reading {
+        uint64_t wallNs;
+        uint64_t enabledNs;
+        uint64_t runningNs;
+        uint64_t values[kEventCount];
+    };
+
+    struct Totals {
+        uint64_t wallNs;
+        double values[kEventCount];
+        unsigned long samples;
+    };
+
+    void read(Reading& reading) const;
+
+    bool enabled_;
+    int groupFd_;
+    int fds_[kEventCount];
+    int slot_[kEventCount];  // position in the group read, or -1
+    int eventCount_;
+
+    Reading start_;
+    Totals totals_[kRenderPhaseCount];
+    unsigned long frames_;
+};
+
+#endif // PERF_COUNTERS_H
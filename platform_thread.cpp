@@ -0,0 +1,150 @@
+#include "platform_thread.h"
+
+#include <iostream>
+
+#ifdef __VXWORKS__
+#include <cpuset.h>
+#include <taskLib.h>
+#include <vxCpuLib.h>
+#else
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace {
+
+#ifdef __VXWORKS__
+const size_t kStackBytes = 64 * 1024;
+// Close to the bottom of the 0 (highest) to 255 range, above only idle work.
+const int kLowTaskPriority = 250;
+#else
+// Nice value for low-priority threads.
+const int kLowNice = 10;
+#endif
+
+} // namespace
+
+PlatformThread::PlatformThread()
+    : fn_(nullptr), arg_(nullptr), priority_(NormalPriority), started_(false) {
+}
+
+PlatformThread::~PlatformThread() {
+    join();
+}
+
+void* PlatformThread::run(void* self) {
+    PlatformThread* thread = static_cast<PlatformThread*>(self);
+#if defined(__linux__) && !defined(__VXWORKS__)
+    // Linux applies nice values per thread.
+    if (thread->priority_ == LowPriority)
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), kLowNice);
+#endif
+    thread->fn_(thread->arg_);
+    return nullptr;
+}
+
+#ifdef __VXWORKS__
+
+int PlatformThread::taskEntry(long self) {
+    PlatformThread* thread = reinterpret_cast<PlatformThread*>(self);
+    run(thread);
+    semGive(thread->exited_);
+    return 0;
+}
+
+bool PlatformThread::start(const char* name, EntryFn fn, void* arg, int cpu, Priority priority) {
+    fn_ = fn;
+    arg_ = arg;
+    priority_ = priority;
+    SEM_ID exited = semBCreate(SEM_Q_FIFO, SEM_EMPTY);
+    if (!exited)
+        return false;
+
+    // Normal threads get the creator's priority, so workers compete fairly
+    // with it.
+    int taskPriority = kLowTaskPriority;
+    if (priority == NormalPriority)
+        taskPriorityGet(taskIdSelf(), &taskPriority);
+    TASK_ID task = taskCreate(const_cast<char*>(name), taskPriority, VX_FP_TASK, kStackBytes,
+                              reinterpret_cast<FUNCPTR>(taskEntry), reinterpret_cast<long>(this),
+                              0, 0, 0, 0, 0, 0, 0, 0, 0);
+    if (task == TASK_ID_ERROR) {
+        semDelete(exited);
+        return false;
+    }
+    if (cpu >= 0) {
+        cpuset_t affinity;
+        CPUSET_ZERO(affinity);
+        CPUSET_SET(affinity, cpu);
+        if (taskCpuAffinitySet(task, affinity) != OK)
+            std::cerr << "Could not pin " << name << " to CPU " << cpu << std::endl;
+    }
+    exited_ = exited;
+    started_ = true;
+    taskActivate(task);
+    return true;
+}
+
+void PlatformThread::join() {
+    if (!started_)
+        return;
+    semTake(exited_, WAIT_FOREVER);
+    semDelete(exited_);
+    started_ = false;
+}
+
+int cpuCount() {
+    return static_cast<int>(vxCpuConfiguredGet());
+}
+
+#else
+
+bool PlatformThread::start(const char* name, EntryFn fn, void* arg, int cpu, Priority priority) {
+    fn_ = fn;
+    arg_ = arg;
+    priority_ = priority;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+#ifdef __linux__
+    if (cpu >= 0) {
+        cpu_set_t affinity;
+        CPU_ZERO(&affinity);
+        CPU_SET(cpu, &affinity);
+        if (pthread_attr_setaffinity_np(&attr, sizeof(affinity), &affinity) != 0)
+            std::cerr << "Could not pin " << name << " to CPU " << cpu << std::endl;
+    }
+#else
+    (void)cpu;
+#endif
+    int result = pthread_create(&thread_, &attr, run, this);
+    pthread_attr_destroy(&attr);
+    if (result != 0)
+        return false;
+#ifdef __linux__
+    // Thread names are limited to 15 characters.
+    char shortName[16] = {};
+    for (int i = 0; i < 15 && name[i]; ++i)
+        shortName[i] = name[i];
+    pthread_setname_np(thread_, shortName);
+#endif
+    started_ = true;
+    return true;
+}
+
+void PlatformThread::join() {
+    if (!started_)
+        return;
+    pthread_join(thread_, nullptr);
+    started_ = false;
+}
+
+int cpuCount() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? static_cast<int>(count) : 1;
+}
+
+#endif
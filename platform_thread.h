@@ -0,0 +1,53 @@
+#ifndef PLATFORM_THREAD_H
+#define PLATFORM_THREAD_H
+
+#ifdef __VXWORKS__
+#include <semLib.h>
+#else
+#include <pthread.h>
+#endif
+
+// Minimal thread layer over pthreads, or taskLib on VxWorks, for threads
+// that need a name and a CPU affinity.
+class PlatformThread {
+public:
+    typedef void (*EntryFn)(void* arg);
+
+    enum Priority {
+        NormalPriority,  // same as the creating thread
+        LowPriority      // background work that must not compete with frames
+    };
+
+    PlatformThread();
+    ~PlatformThread();
+
+    // Starts fn(arg) on a new thread pinned to cpu, or unpinned if cpu is
+    // negative. Returns false if the thread could not be created.
+    bool start(const char* name, EntryFn fn, void* arg, int cpu, Priority priority = NormalPriority);
+
+    // Waits for the thread to return from its entry function.
+    void join();
+
+private:
+    PlatformThread(const PlatformThread&);
+    PlatformThread& operator=(const PlatformThread&);
+
+    static void* run(void* self);
+
+    EntryFn fn_;
+    void* arg_;
+    Priority priority_;
+    bool started_;
+#ifdef __VXWORKS__
+    static int taskEntry(long self);
+
+    SEM_ID exited_;  // given when the task returns
+#else
+    pthread_t thread_;
+#endif
+};
+
+// Number of CPUs threads can be pinned to.
+int cpuCount();
+
+#endif // PLATFORM_THREAD_H
@@ -0,0 +1,41 @@
+#include "platform_timer.h"
+
+#include <errno.h>
+#include <time.h>
+
+#ifdef __VXWORKS__
+#include <sysLib.h>
+#endif
+
+uint64_t monotonicNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void sleepForNs(uint64_t ns) {
+    struct timespec request;
+    request.tv_sec = static_cast<time_t>(ns / 1000000000ull);
+    request.tv_nsec = static_cast<long>(ns % 1000000000ull);
+    struct timespec remaining;
+    while (nanosleep(&request, &remaining) != 0 && errno == EINTR)
+        request = remaining;
+}
+
+uint64_t sleepGranularityNs() {
+#ifdef __VXWORKS__
+    // nanosleep() rounds up to the next tick and may wake up to a tick late.
+    return 2000000000ull / sysClkRateGet();
+#else
+    // Default timer slack is 50us; leave room for wake-up latency as well.
+    return 200000ull;
+#endif
+}
+
+void cpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
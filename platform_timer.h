@@ -0,0 +1,28 @@
+#ifndef PLATFORM_TIMER_H
+#define PLATFORM_TIMER_H
+
+#include <stdint.h>
+
+// Portable monotonic clock and sleep primitives for Linux and VxWorks.
+// Both are built on the POSIX clock API; what differs is how coarse the
+// sleep is. On VxWorks every sleep is rounded up to whole system clock
+// ticks, on Linux it is limited by timer slack and scheduler latency.
+
+// Current time of the monotonic clock in nanoseconds.
+uint64_t monotonicNowNs();
+
+// Sleeps for at least the given number of nanoseconds.
+void sleepForNs(uint64_t ns);
+
+// Expected worst-case overshoot of sleepForNs(), used as the initial
+// margin before switching from sleeping to spinning.
+uint64_t sleepGranularityNs();
+
+// Hint to the CPU that we are busy-waiting.
+void cpuRelax();
+
+inline double nsToMs(uint64_t ns) {
+    return ns / 1.0e6;
+}
+
+#endif // PLATFORM_TIMER_H
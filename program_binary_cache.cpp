@@ -0,0 +1,76 @@
+#include "program_binary_cache.h"
+
+#include <cstring>
+
+ProgramBinaryCache::ProgramBinaryCache()
+#ifdef USE_GLES2
+    : getProgramBinary_(nullptr), programBinary_(nullptr)
+#endif
+{
+}
+
+bool ProgramBinaryCache::attach() {
+#ifdef USE_GLES2
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (!extensions || !strstr(extensions, "GL_OES_get_program_binary"))
+        return false;
+    getProgramBinary_ = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(eglGetProcAddress("glGetProgramBinaryOES"));
+    programBinary_ = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(eglGetProcAddress("glProgramBinaryOES"));
+    if (!getProgramBinary_ || !programBinary_)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+#else
+    if (!GLEW_ARB_get_program_binary)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+#endif
+    return formats > 0;
+}
+
+void ProgramBinaryCache::prepare(GLuint program) const {
+#ifdef USE_GLES2
+    (void)program;
+#else
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+}
+
+void ProgramBinaryCache::store(uint64_t key, GLuint program) {
+    GLint length = 0;
+#ifdef USE_GLES2
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+#else
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+#endif
+    if (length <= 0)
+        return;
+    Binary& binary = binaries_[key];
+    binary.data.resize(length);
+#ifdef USE_GLES2
+    getProgramBinary_(program, length, &length, &binary.format, &binary.data[0]);
+#else
+    glGetProgramBinary(program, length, &length, &binary.format, &binary.data[0]);
+#endif
+    if (length <= 0)
+        binaries_.erase(key);
+    else
+        binary.data.resize(length);
+}
+
+bool ProgramBinaryCache::load(uint64_t key, GLuint program) const {
+    std::unordered_map<uint64_t, Binary>::const_iterator it = binaries_.find(key);
+    if (it == binaries_.end())
+        return false;
+    const Binary& binary = it->second;
+    GLsizei length = static_cast<GLsizei>(binary.data.size());
+#ifdef USE_GLES2
+    programBinary_(program, binary.format, &binary.data[0], length);
+#else
+    glProgramBinary(program, binary.format, &binary.data[0], length);
+#endif
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
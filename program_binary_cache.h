@@ -0,0 +1,56 @@
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include "gl_platform.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+// Linked programs kept in memory as driver binaries, keyed by a hash of
+// their sources, so that a new context after a GPU reset gets its
+// programs back without compiling them again. The binaries are plain
+// bytes that outlive the context they came from; ShaderManager saves
+// every program it links and loads from here first. This needs
+// GL_OES_get_program_binary on GLES2 and ARB_get_program_binary on
+// desktop GL with at least one binary format. A binary the driver rejects,
+// e.g. after a driver update, is compiled from source as before.
+class ProgramBinaryCache {
+public:
+    ProgramBinaryCache();
+
+    // Whether the current context can save and load binaries. Call on
+    // every new context, before prepare(), store() or load().
+    bool attach();
+
+    // Asks the driver to keep the binary of a program that is about to
+    // be linked; desktop GL drops it otherwise.
+    void prepare(GLuint program) const;
+
+    // Saves the binary of a linked program under key.
+    void store(uint64_t key, GLuint program);
+
+    // Loads the binary saved under key into program and returns whether it
+    // linked.
+    bool load(uint64_t key, GLuint program) const;
+
+    size_t size() const { return binaries_.size(); }
+
+private:
+    ProgramBinaryCache(const ProgramBinaryCache&);
+    ProgramBinaryCache& operator=(const ProgramBinaryCache&);
+
+    struct Binary {
+        GLenum format;
+        std::vector<unsigned char> data;
+    };
+
+#ifdef USE_GLES2
+    PFNGLGETPROGRAMBINARYOESPROC getProgramBinary_;
+    PFNGLPROGRAMBINARYOESPROC programBinary_;
+#endif
+    std::unordered_map<uint64_t, Binary> binaries_;
+};
+
+#endif // PROGRAM_BINARY_CACHE_H
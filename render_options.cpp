@@ -0,0 +1,183 @@
+#include "render_options.h"
+#include "allocation_guard.h"
+#include "shader_variants.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Only the VxWorks version runs the display self-test, and only the
+// desktop version has the latency harness.
+#ifdef USE_GLES2
+const bool kHaveSelfTest = true;
+const bool kHaveLatencyHarness = false;
+#else
+const bool kHaveSelfTest = false;
+const bool kHaveLatencyHarness = true;
+#endif
+
+// Matches "--name=value" and returns a pointer to value, or nullptr.
+const char* optionValue(const char* arg, const char* name) {
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=')
+        return nullptr;
+    return arg + len + 1;
+}
+
+bool parseDouble(const char* text, double& out) {
+    char* end = nullptr;
+    double value = strtod(text, &end);
+    if (end == text || *end != '\0' || value < 0.0)
+        return false;
+    out = value;
+    return true;
+}
+
+bool parseInt(const char* text, int minValue, int maxValue, int& out) {
+    char* end = nullptr;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < minValue || value > maxValue)
+        return false;
+    out = static_cast<int>(value);
+    return true;
+}
+
+bool parseHex32(const char* text, uint32_t& out) {
+    char* end = nullptr;
+    unsigned long long value = strtoull(text, &end, 16);
+    if (end == text || *end != '\0' || *text == '-' || value > 0xFFFFFFFFull)
+        return false;
+    out = static_cast<uint32_t>(value);
+    return true;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --dynamic-resolution=MS   scale render resolution to fit a frame budget of MS milliseconds\n"
+              << "  --frame-rate=HZ           pace presentation to HZ frames per second without vsync\n"
+              << "  --max-frames-in-flight=N  let the CPU queue at most N (1-3) frames ahead of the GPU\n"
+              << "  --latency-test=N          measure input-to-present latency of N synthetic key presses (desktop)\n"
+              << "  --scene=PATH              render the triangles of a binary scene file\n"
+              << "  --stream-buffers=N        stream the scene through N chunk-sized GPU buffers\n"
+              << "  --triangles=N             draw N small independent triangles instead of the scene\n"
+              << "  --batching=0|1            merge small draws into as few draw calls as possible (default 1)\n"
+              << "  --job-threads=N           run CPU work such as draw recording on N threads (default 1)\n"
+              << "  --frame-arena=KB          per-frame scratch memory reset at every swap (default 4096)\n"
+              << "  --alloc-check=N           abort on heap allocation in the render loop after N frames (ALLOC_CHECK builds)\n"
+              << "  --perf-counters=0|1       report hardware counters per render-loop phase (default 0)\n"
+              << "  --shader-features=LIST    draw with the shader variant for LIST, of dither and highp\n"
+              << "  --gl-trace=PATH           record GL calls for gl_trace_replay (GL_TRACE builds)\n"
+              << "  --gl-trace-frames=N       stop recording after N frames (default 0, until exit)\n"
+              << "  --telemetry=SINK          export frame-time histograms to file:PATH, udp:HOST:PORT or unix:PATH\n"
+              << "  --telemetry-interval=S    seconds (0.1-86400) between telemetry snapshots (default 10)\n"
+              << "  --log-file=PATH           append log messages to PATH instead of the console\n"
+              << "  --export-scene=PATH       index and cache-optimize the scene (or built-in triangle), write it and exit\n"
+              << "  --color-check=N           check colour accuracy on the GPU every N frames (default 0, off)\n"
+              << "  --self-test=N             draw and check a test pattern every N loop iterations (VxWorks)\n"
+              << "  --self-test-signature=HEX expected CRC-32C of the test pattern (default: the first one)\n";
+}
+
+} // namespace
+
+RenderOptions::RenderOptions()
+    : dynamicResolutionBudgetMs(0.0),
+      frameRateHz(0.0),
+      maxFramesInFlight(0),
+      latencySamples(0),
+      streamBuffers(0),
+      fieldTriangles(0),
+      batching(true),
+      jobThreads(1),
+      frameArenaKb(4096),
+      allocationCheckFrames(0),
+      perfCounters(false),
+      shaderFeatures(0),
+      glTraceFrames(0),
+      telemetryIntervalSeconds(10.0),
+      colorCheckInterval(0),
+      selfTestInterval(0),
+      selfTestSignature(0),
+      hasSelfTestSignature(false) {
+}
+
+bool parseRenderOptions(int argc, char* argv[], RenderOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value;
+        bool ok = false;
+        if ((value = optionValue(arg, "--dynamic-resolution")) != nullptr) {
+            ok = parseDouble(value, options.dynamicResolutionBudgetMs);
+        } else if ((value = optionValue(arg, "--frame-rate")) != nullptr) {
+            // Tiny or infinite rates overflow the pacer's integer period
+            // and log interval. NaN fails the comparisons as well.
+            ok = parseDouble(value, options.frameRateHz) &&
+                 (options.frameRateHz == 0.0 || (options.frameRateHz >= 1.0 && options.frameRateHz <= 10000.0));
+        } else if ((value = optionValue(arg, "--max-frames-in-flight")) != nullptr) {
+            ok = parseInt(value, 0, 3, options.maxFramesInFlight);
+        } else if ((value = optionValue(arg, "--latency-test")) != nullptr) {
+            ok = kHaveLatencyHarness && parseInt(value, 0, 1000000, options.latencySamples);
+        } else if ((value = optionValue(arg, "--scene")) != nullptr) {
+            options.scenePath = value;
+            ok = !options.scenePath.empty();
+        } else if ((value = optionValue(arg, "--stream-buffers")) != nullptr) {
+            ok = parseInt(value, 0, 4096, options.streamBuffers);
+        } else if ((value = optionValue(arg, "--triangles")) != nullptr) {
+            ok = parseInt(value, 0, 10000000, options.fieldTriangles);
+        } else if ((value = optionValue(arg, "--batching")) != nullptr) {
+            int enabled = 0;
+            ok = parseInt(value, 0, 1, enabled);
+            options.batching = enabled != 0;
+        } else if ((value = optionValue(arg, "--job-threads")) != nullptr) {
+            ok = parseInt(value, 1, 64, options.jobThreads);
+        } else if ((value = optionValue(arg, "--frame-arena")) != nullptr) {
+            ok = parseInt(value, 0, 1024 * 1024, options.frameArenaKb);
+        } else if ((value = optionValue(arg, "--alloc-check")) != nullptr) {
+            ok = parseInt(value, 0, 1000000000, options.allocationCheckFrames);
+            if (ok && options.allocationCheckFrames > 0 && !allocationGuardAvailable()) {
+                std::cerr << "The allocation guard is not compiled in; configure with -DALLOC_CHECK=ON" << std::endl;
+                ok = false;
+            }
+        } else if ((value = optionValue(arg, "--perf-counters")) != nullptr) {
+            int enabled = 0;
+            ok = parseInt(value, 0, 1, enabled);
+            options.perfCounters = enabled != 0;
+        } else if ((value = optionValue(arg, "--shader-features")) != nullptr) {
+            // Quantized inputs need quantized geometry, which no scene has yet
+            ok = parseShaderFeatures(value, options.shaderFeatures) &&
+                 !(options.shaderFeatures & ShaderQuantizedInputs);
+        } else if ((value = optionValue(arg, "--gl-trace")) != nullptr) {
+            options.glTracePath = value;
+            ok = !options.glTracePath.empty();
+        } else if ((value = optionValue(arg, "--gl-trace-frames")) != nullptr) {
+            ok = parseInt(value, 0, 1000000000, options.glTraceFrames);
+        } else if ((value = optionValue(arg, "--telemetry")) != nullptr) {
+            options.telemetrySink = value;
+            ok = !options.telemetrySink.empty();
+        } else if ((value = optionValue(arg, "--telemetry-interval")) != nullptr) {
+            // The interval is kept in integer nanoseconds; NaN fails too.
+            ok = parseDouble(value, options.telemetryIntervalSeconds) &&
+                 options.telemetryIntervalSeconds >= 0.1 && options.telemetryIntervalSeconds <= 86400.0;
+        } else if ((value = optionValue(arg, "--log-file")) != nullptr) {
+            options.logPath = value;
+            ok = !options.logPath.empty();
+        } else if ((value = optionValue(arg, "--export-scene")) != nullptr) {
+            options.exportScenePath = value;
+            ok = !options.exportScenePath.empty();
+        } else if ((value = optionValue(arg, "--color-check")) != nullptr) {
+            ok = parseInt(value, 0, 1000000, options.colorCheckInterval);
+        } else if ((value = optionValue(arg, "--self-test")) != nullptr) {
+            ok = kHaveSelfTest && parseInt(value, 0, 1000000, options.selfTestInterval);
+        } else if ((value = optionValue(arg, "--self-test-signature")) != nullptr) {
+            ok = kHaveSelfTest && parseHex32(value, options.selfTestSignature);
+            options.hasSelfTestSignature = ok;
+        }
+        if (!ok) {
+            std::cerr << "Invalid argument: " << arg << std::endl;
+            printUsage(argc > 0 ? argv[0] : "opengl_triangle");
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,104 @@
+#ifndef RENDER_OPTIONS_H
+#define RENDER_OPTIONS_H
+
+#include <stdint.h>
+#include <string>
+
+// Runtime switches shared by the desktop and VxWorks render loops.
+struct RenderOptions {
+    RenderOptions();
+
+    // Frame-time budget in milliseconds for dynamic resolution scaling.
+    // 0 renders straight to the window at native resolution.
+    double dynamicResolutionBudgetMs;
+
+    // Target presentation rate in Hz (1 to 10000), paced on the CPU with
+    // vsync off. 0 leaves pacing to the swap interval.
+    double frameRateHz;
+
+    // Maximum number of frames the CPU may run ahead of the GPU (1-3).
+    // 0 leaves queuing to the driver.
+    int maxFramesInFlight;
+
+    // Number of synthetic input events to measure input-to-present latency
+    // for before exiting. 0 disables the harness. Desktop build only; the
+    // VxWorks build rejects the option.
+    int latencySamples;
+
+    // Scene file to render instead of the built-in triangle.
+    std::string scenePath;
+
+    // Number of GPU buffers to stream the scene through. 0 uploads the
+    // whole scene up front.
+    int streamBuffers;
+
+    // Draws this many small independent triangles instead of the scene,
+    // each submitted as its own draw. 0 disables the test scene.
+    int fieldTriangles;
+
+    // Whether small draws are merged by the draw batcher.
+    bool batching;
+
+    // Threads in the job system, including the render thread. The batched
+    // test scene records its draws on them each frame. 1 disables the job
+    // system and submits prebuilt triangles directly.
+    int jobThreads;
+
+    // Size of the per-frame scratch arena in KB.
+    int frameArenaKb;
+
+    // Aborts on any C++ heap allocation by the render thread or the job
+    // system workers after this many presented frames. Needs a build with
+    // ALLOC_CHECK. 0 disables the check.
+    int allocationCheckFrames;
+
+    // Count cycles, instructions, cache misses and branch misses per
+    // render-loop phase, or wall time where no counters are available.
+    bool perfCounters;
+
+    // ShaderFeature flags of the shader variant to draw with. All other
+    // variants are still built at startup to check that they compile.
+    unsigned shaderFeatures;
+
+    // File to record GL calls into, for gl_trace_replay. Needs a build
+    // with GL_TRACE. Empty disables recording.
+    std::string glTracePath;
+
+    // Frames to record; 0 records until exit.
+    int glTraceFrames;
+
+    // Where frame telemetry is exported: "file:PATH", "udp:HOST:PORT" or
+    // "unix:PATH". Empty records without exporting.
+    std::string telemetrySink;
+
+    // Seconds between telemetry snapshots, 0.1 to 86400.
+    double telemetryIntervalSeconds;
+
+    // File that log messages are appended to. Empty logs to stdout and
+    // stderr, the console on VxWorks.
+    std::string logPath;
+
+    // Runs the import stage (vertex deduplication and cache optimization)
+    // on --scene, or the built-in triangle, writes the result to this path
+    // and exits.
+    std::string exportScenePath;
+
+    // Checks the colour accuracy of every this many frames of the built-in
+    // triangle on the GPU. 0 disables the check.
+    int colorCheckInterval;
+
+    // Draws and checks the display self-test pattern every this many render
+    // loop iterations. 0 disables the self-test. VxWorks build only.
+    int selfTestInterval;
+
+    // Expected CRC-32C of the self-test pattern on this GPU and driver. If
+    // not set, the first pattern drawn becomes the reference.
+    uint32_t selfTestSignature;
+    bool hasSelfTestSignature;
+};
+
+// Parses "--name=value" style arguments. Prints usage and returns false on
+// an unknown or malformed argument.
+bool parseRenderOptions(int argc, char* argv[], RenderOptions& options);
+
+#endif // RENDER_OPTIONS_H
@@ -0,0 +1,221 @@
+#include "scene_file.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kSceneMagic[4] = { 'T', 'R', 'I', 'S' };
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool writePadding(FILE* file, uint64_t from, uint64_t to) {
+    static const char zeros[64] = { 0 };
+    while (from < to) {
+        size_t chunk = static_cast<size_t>(to - from < sizeof(zeros) ? to - from : sizeof(zeros));
+        if (fwrite(zeros, 1, chunk, file) != chunk)
+            return false;
+        from += chunk;
+    }
+    return true;
+}
+
+// Whether every index is below limit. The largest index is found first,
+// which keeps the loop free of branches.
+template <typename Index>
+bool indicesBelow(const Index* indices, uint64_t count, uint64_t limit) {
+    Index largest = 0;
+    for (uint64_t i = 0; i < count; ++i)
+        largest = indices[i] > largest ? indices[i] : largest;
+    return largest < limit;
+}
+
+#ifdef USE_GLES2
+bool hasGlExtension(const char* name) {
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    return extensions && strstr(extensions, name);
+}
+#endif
+
+} // namespace
+
+SceneFile::SceneFile()
+    : base_(nullptr), size_(0), header_(nullptr) {
+}
+
+SceneFile::~SceneFile() {
+    close();
+}
+
+bool SceneFile::open(const char* path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open scene " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < sizeof(SceneHeader)) {
+        std::cerr << "Scene " << path << " is too small" << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map scene " << path << std::endl;
+        return false;
+    }
+#ifdef MADV_SEQUENTIAL
+    // The upload reads each section once, front to back. Advice values
+    // are not flags, so each takes its own call.
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    madvise(mapping, size, MADV_WILLNEED);
+#endif
+
+    base_ = static_cast<const unsigned char*>(mapping);
+    size_ = size;
+    header_ = reinterpret_cast<const SceneHeader*>(base_);
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SceneFile::close() {
+    if (base_)
+        munmap(const_cast<unsigned char*>(base_), size_);
+    base_ = nullptr;
+    size_ = 0;
+    header_ = nullptr;
+}
+
+bool SceneFile::validate(const char* path) const {
+    const SceneHeader& h = *header_;
+    const char* problem = nullptr;
+    if (memcmp(h.magic, kSceneMagic, sizeof(kSceneMagic)) != 0)
+        problem = "not a scene file";
+    else if (h.version != kSceneVersion)
+        problem = "unsupported version";
+    else if (h.vertexStride != kSceneVertexStride)
+        problem = "unsupported vertex layout";
+    else if (h.indexSize != 0 && h.indexSize != 2 && h.indexSize != 4)
+        problem = "unsupported index size";
+    else if (h.vertexOffset % kSceneSectionAlignment != 0 || h.indexOffset % kSceneSectionAlignment != 0)
+        problem = "misaligned section";
+    else if (h.vertexOffset > size_ || vertexBytes() > size_ - h.vertexOffset)
+        problem = "truncated vertex section";
+    else if (h.indexCount && (h.indexOffset > size_ || indexBytes() > size_ - h.indexOffset))
+        problem = "truncated index section";
+    else if (h.vertexCount > 0x7fffffff || h.indexCount > 0x7fffffff)
+        problem = "too many elements";
+    // The indices go to glDrawElements as they are, so one past the vertex
+    // section would have the GPU read out of bounds.
+    else if (h.indexSize == 2 && !indicesBelow(static_cast<const uint16_t*>(indices()), h.indexCount, h.vertexCount))
+        problem = "index out of range";
+    else if (h.indexSize == 4 && !indicesBelow(static_cast<const uint32_t*>(indices()), h.indexCount, h.vertexCount))
+        problem = "index out of range";
+
+    if (problem) {
+        std::cerr << "Invalid scene " << path << ": " << problem << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool writeSceneFile(const char* path, const float* vertices, uint64_t vertexCount,
+                    const void* indices, uint64_t indexCount, uint32_t indexSize) {
+    SceneHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kSceneMagic, sizeof(kSceneMagic));
+    header.version = kSceneVersion;
+    header.vertexStride = kSceneVertexStride;
+    header.indexSize = indices ? indexSize : 0;
+    header.vertexCount = vertexCount;
+    header.vertexOffset = alignUp(sizeof(SceneHeader), kSceneSectionAlignment);
+    header.indexCount = indices ? indexCount : 0;
+    header.indexOffset = header.indexCount
+        ? alignUp(header.vertexOffset + vertexCount * kSceneVertexStride, kSceneSectionAlignment)
+        : 0;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Failed to create scene " << path << std::endl;
+        return false;
+    }
+    uint64_t vertexBytes = vertexCount * kSceneVertexStride;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              writePadding(file, sizeof(header), header.vertexOffset) &&
+              fwrite(vertices, 1, vertexBytes, file) == vertexBytes;
+    if (ok && header.indexCount) {
+        uint64_t indexBytes = indexCount * indexSize;
+        ok = writePadding(file, header.vertexOffset + vertexBytes, header.indexOffset) &&
+             fwrite(indices, 1, indexBytes, file) == indexBytes;
+    }
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+        std::cerr << "Failed to write scene " << path << std::endl;
+    return ok;
+}
+
+bool uploadScene(const SceneFile& scene, SceneBuffers& buffers) {
+    const SceneHeader& h = scene.header();
+    buffers.vertexBuffer = 0;
+    buffers.indexBuffer = 0;
+    buffers.vertexCount = static_cast<GLsizei>(h.vertexCount);
+    buffers.indexCount = static_cast<GLsizei>(h.indexCount);
+    buffers.indexType = h.indexSize == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+
+#ifdef USE_GLES2
+    if (h.indexSize == 4 && !hasGlExtension("GL_OES_element_index_uint")) {
+        std::cerr << "Scene uses 32-bit indices, which this GLES2 driver does not support" << std::endl;
+        return false;
+    }
+#endif
+
+    // The driver copies straight out of the file mapping; page faults pull
+    // the data in as it goes, so the upload runs at I/O speed.
+    glGenBuffers(1, &buffers.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(scene.vertexBytes()), scene.vertices(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (h.indexCount) {
+        glGenBuffers(1, &buffers.indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(scene.indexBytes()), scene.indices(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    return true;
+}
+
+void deleteSceneBuffers(SceneBuffers& buffers) {
+    if (buffers.vertexBuffer)
+        glDeleteBuffers(1, &buffers.vertexBuffer);
+    if (buffers.indexBuffer)
+        glDeleteBuffers(1, &buffers.indexBuffer);
+    buffers.vertexBuffer = 0;
+    buffers.indexBuffer = 0;
+}
+
+void drawSceneBuffers(const SceneBuffers& buffers) {
+    if (buffers.indexCount) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBuffer);
+        glDrawElements(GL_TRIANGLES, buffers.indexCount, buffers.indexType, nullptr);
+    } else {
+        glDrawArrays(GL_TRIANGLES, 0, buffers.vertexCount);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include "gl_platform.h"
+#include "vertex_layout.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary triangle scene, version 1. All fields are little-endian, matching
+// every target we build for, so sections can be handed to GL as they are.
+//
+//   offset 0      SceneHeader (64 bytes)
+//   vertexOffset  vertexCount * kSceneVertexStride bytes of interleaved
+//                 vec3 position, vec3 colour (float32)
+//   indexOffset   indexCount * indexSize bytes of uint16 or uint32 indices,
+//                 each less than vertexCount
+//
+// Section offsets are multiples of kSceneSectionAlignment so that a mapped
+// file yields page-aligned pointers that the driver can copy from directly.
+struct SceneHeader {
+    char magic[4];          // "TRIS"
+    uint32_t version;
+    uint32_t vertexStride;  // bytes per vertex
+    uint32_t indexSize;     // 0 (non-indexed), 2 or 4
+    uint64_t vertexCount;
+    uint64_t vertexOffset;
+    uint64_t indexCount;
+    uint64_t indexOffset;
+    uint64_t reserved[2];
+};
+
+const uint32_t kSceneVersion = 1;
+const uint32_t kSceneVertexStride = 6 * sizeof(float);
+const uint64_t kSceneSectionAlignment = 4096;
+
+// One vertex of the vertex section, and its attribute layout: position
+// in attribute 0 and colour in attribute 1.
+struct SceneVertex {
+    GLfloat position[3];
+    GLfloat color[3];
+};
+
+typedef VertexLayout<SceneVertex,
+                     VERTEX_ATTRIBUTE(SceneVertex, position, false),
+                     VERTEX_ATTRIBUTE(SceneVertex, color, false)> SceneVertexLayout;
+
+static_assert(sizeof(SceneVertex) == kSceneVertexStride, "SceneVertex must match the file's vertex stride");
+
+// Read-only view of a scene file. The file is memory mapped and the
+// section pointers point straight into the mapping, so nothing is copied
+// on the way to the GL buffer upload.
+class SceneFile {
+public:
+    SceneFile();
+    ~SceneFile();
+
+    bool open(const char* path);
+    void close();
+    bool isOpen() const { return base_ != nullptr; }
+
+    const SceneHeader& header() const { return *header_; }
+    const void* vertices() const { return base_ + header_->vertexOffset; }
+    uint64_t vertexBytes() const { return header_->vertexCount * header_->vertexStride; }
+    const void* indices() const { return header_->indexCount ? base_ + header_->indexOffset : nullptr; }
+    uint64_t indexBytes() const { return header_->indexCount * header_->indexSize; }
+
+private:
+    SceneFile(const SceneFile&);
+    SceneFile& operator=(const SceneFile&);
+
+    bool validate(const char* path) const;
+
+    const unsigned char* base_;
+    size_t size_;
+    const SceneHeader* header_;
+};
+
+// Writes a scene file. indices may be null for a non-indexed scene.
+bool writeSceneFile(const char* path, const float* vertices, uint64_t vertexCount,
+                    const void* indices, uint64_t indexCount, uint32_t indexSize);
+
+// GL buffers holding an uploaded scene.
+struct SceneBuffers {
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    GLsizei vertexCount;
+    GLsizei indexCount;
+    GLenum indexType;
+};
+
+// Uploads the scene straight from the mapping. Returns false if the scene
+// cannot be drawn on this context (e.g. 32-bit indices on plain GLES2).
+bool uploadScene(const SceneFile& scene, SceneBuffers& buffers);
+void deleteSceneBuffers(SceneBuffers& buffers);
+
+// Issues the draw call; vertex attributes must already be set up.
+void drawSceneBuffers(const SceneBuffers& buffers);
+
+#endif // SCENE_FILE_H
@@ -0,0 +1,251 @@
+#include "shader_library.h"
+
+namespace {
+
+const char* triangleVertexSrc = R"(
+layout(location = 0) attribute vec3 a_position;
+layout(location = 1) attribute vec3 a_color;
+varying vec3 v_color;
+#ifdef QUANTIZED
+uniform vec3 u_positionScale;
+#endif
+void main() {
+#ifdef QUANTIZED
+    gl_Position = vec4(a_position * u_positionScale, 1.0);
+#else
+    gl_Position = vec4(a_position, 1.0);
+#endif
+    v_color = a_color;
+}
+)";
+
+const char* triangleFragmentSrc = R"(
+varying vec3 v_color;
+uniform float u_invert;
+void main() {
+    vec3 color = mix(v_color, 1.0 - v_color, u_invert);
+#ifdef DITHER
+    // Interleaved gradient noise of one 8-bit step breaks up banding
+    float noise = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    color += (noise - 0.5) / 255.0;
+#endif
+    gl_FragColor = vec4(color, 1.0);
+}
+)";
+
+// Covers the viewport with one triangle, for the colour error passes and
+// the self-test pattern.
+// v_position runs from 0 to 1 across the viewport.
+const char* fullScreenVertexSrc = R"(
+layout(location = 0) attribute vec2 a_position;
+varying vec2 v_position;
+void main() {
+    v_position = a_position * 0.5 + 0.5;
+    gl_Position = vec4(a_position, 0.0, 1.0);
+}
+)";
+
+// Cells of the colour error reduction hold the largest error, the mean
+// error and the fraction of pixels over the tolerance of a block of the
+// frame, the mean and fraction taken over the whole block. GLSL 3.30
+// renders them into RGBA32F. On ES a cell is two RGBA8 texels, the first
+// holding the maximum and the mean as 16 bits, the second the fraction as
+// 24 bits, enough to count single pixels of a 4K frame; packing needs
+// highp. Fragments find their cell from
+// v_position rather than gl_FragCoord, which is only mediump in GLSL ES
+// 1.00 and too coarse for wide levels. Both passes carry their own copy
+// of the encoding.
+const char* colorErrorFragmentSrc = R"(
+varying vec2 v_position;
+uniform vec2 u_targetSize;
+vec2 targetTexel() {
+    return floor(v_position * u_targetSize);
+}
+#ifdef GLSL_ES
+vec2 encode16(float value) {
+    float v = floor(clamp(value, 0.0, 1.0) * 65535.0 + 0.5);
+    float high = floor(v / 256.0);
+    return vec2(high, v - high * 256.0) / 255.0;
+}
+vec3 encode24(float value) {
+    // The + 0.5 rounds to 2^24 near 1, past what fits.
+    float v = min(floor(clamp(value, 0.0, 1.0) * 16777215.0 + 0.5), 16777215.0);
+    float high = floor(v / 65536.0);
+    v -= high * 65536.0;
+    float middle = floor(v / 256.0);
+    return vec3(high, middle, v - middle * 256.0) / 255.0;
+}
+vec2 cellCoord() {
+    vec2 texel = targetTexel();
+    return vec2(floor(texel.x * 0.5), texel.y);
+}
+vec4 encodeCell(float maxError, float mean, float fraction) {
+    float second = mod(targetTexel().x, 2.0);
+    return mix(vec4(maxError, encode16(mean), 1.0), vec4(encode24(fraction), 1.0), second);
+}
+#else
+vec2 cellCoord() {
+    return targetTexel();
+}
+vec4 encodeCell(float maxError, float mean, float fraction) {
+    return vec4(maxError, mean, fraction, 0.0);
+}
+#endif
+uniform sampler2D u_frame;
+uniform vec2 u_frameSize;
+uniform vec3 u_weights[3];
+uniform vec3 u_heights;
+uniform vec3 u_colors[3];
+uniform vec3 u_background;
+uniform float u_invert;
+uniform float u_tolerance;
+void main() {
+    // Coverage of pixels this close to an edge depends on the rasterizer,
+    // so they are not checked.
+    const float kEdgeMargin = 1.0;
+    vec2 cell = cellCoord();
+    float maxError = 0.0;
+    float sumError = 0.0;
+    float count = 0.0;
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            vec2 pixel = cell * 4.0 + vec2(float(i), float(j)) + 0.5;
+            vec3 observed = texture2D(u_frame, pixel / u_frameSize).rgb;
+            vec3 p = vec3(pixel, 1.0);
+            vec3 weights = vec3(dot(u_weights[0], p), dot(u_weights[1], p), dot(u_weights[2], p));
+            vec3 distances = weights * u_heights;
+            float nearest = min(distances.x, min(distances.y, distances.z));
+            float inside = step(kEdgeMargin, nearest);
+            float checked = (inside + step(nearest, -kEdgeMargin)) *
+                            step(pixel.x, u_frameSize.x) * step(pixel.y, u_frameSize.y);
+            vec3 color = weights.x * u_colors[0] + weights.y * u_colors[1] + weights.z * u_colors[2];
+            vec3 expected = mix(u_background, mix(color, 1.0 - color, u_invert), inside);
+            vec3 difference = abs(observed - expected);
+            float error = max(difference.r, max(difference.g, difference.b)) * checked;
+            maxError = max(maxError, error);
+            sumError += error;
+            count += 1.0 - step(error, u_tolerance);
+        }
+    }
+    gl_FragColor = encodeCell(maxError, sumError / 16.0, count / 16.0);
+}
+)";
+
+const char* colorReduceFragmentSrc = R"(
+varying vec2 v_position;
+uniform vec2 u_targetSize;
+vec2 targetTexel() {
+    return floor(v_position * u_targetSize);
+}
+#ifdef GLSL_ES
+vec2 encode16(float value) {
+    float v = floor(clamp(value, 0.0, 1.0) * 65535.0 + 0.5);
+    float high = floor(v / 256.0);
+    return vec2(high, v - high * 256.0) / 255.0;
+}
+vec3 encode24(float value) {
+    // The + 0.5 rounds to 2^24 near 1, past what fits.
+    float v = min(floor(clamp(value, 0.0, 1.0) * 16777215.0 + 0.5), 16777215.0);
+    float high = floor(v / 65536.0);
+    v -= high * 65536.0;
+    float middle = floor(v / 256.0);
+    return vec3(high, middle, v - middle * 256.0) / 255.0;
+}
+float decode16(vec2 bytes) {
+    vec2 b = floor(bytes * 255.0 + 0.5);
+    return (b.x * 256.0 + b.y) / 65535.0;
+}
+float decode24(vec3 bytes) {
+    vec3 b = floor(bytes * 255.0 + 0.5);
+    return (b.x * 65536.0 + b.y * 256.0 + b.z) / 16777215.0;
+}
+vec2 cellCoord() {
+    vec2 texel = targetTexel();
+    return vec2(floor(texel.x * 0.5), texel.y);
+}
+vec4 encodeCell(float maxError, float mean, float fraction) {
+    float second = mod(targetTexel().x, 2.0);
+    return mix(vec4(maxError, encode16(mean), 1.0), vec4(encode24(fraction), 1.0), second);
+}
+#else
+vec2 cellCoord() {
+    return targetTexel();
+}
+vec4 encodeCell(float maxError, float mean, float fraction) {
+    return vec4(maxError, mean, fraction, 0.0);
+}
+#endif
+uniform sampler2D u_source;
+uniform vec2 u_sourceSize;
+#ifdef GLSL_ES
+vec3 decodeCell(vec2 center) {
+    float width = u_sourceSize.x * 2.0;
+    float y = center.y / u_sourceSize.y;
+    vec4 first = texture2D(u_source, vec2((center.x * 2.0 - 0.5) / width, y));
+    vec4 second = texture2D(u_source, vec2((center.x * 2.0 + 0.5) / width, y));
+    return vec3(first.r, decode16(first.gb), decode24(second.rgb));
+}
+#else
+vec3 decodeCell(vec2 center) {
+    return texture2D(u_source, center / u_sourceSize).rgb;
+}
+#endif
+void main() {
+    vec2 cell = cellCoord();
+    float maxError = 0.0;
+    float mean = 0.0;
+    float fraction = 0.0;
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i) {
+            vec2 child = cell * 4.0 + vec2(float(i), float(j)) + 0.5;
+            vec3 value = decodeCell(child) * step(child.x, u_sourceSize.x) * step(child.y, u_sourceSize.y);
+            maxError = max(maxError, value.x);
+            mean += value.y;
+            fraction += value.z;
+        }
+    }
+    gl_FragColor = encodeCell(maxError, mean / 16.0, fraction / 16.0);
+}
+)";
+
+// Fixed pattern of the display self-test: ramps in red and green, a
+// checkerboard of 8x8 tiles in blue and their product in alpha, so that
+// stuck bits, swapped channels and misplaced tiles all change it.
+const char* selfTestFragmentSrc = R"(
+varying vec2 v_position;
+void main() {
+    vec2 tile = floor(v_position * 8.0);
+    float checker = mod(tile.x + tile.y, 2.0);
+    gl_FragColor = vec4(v_position, checker, 1.0 - v_position.x * v_position.y);
+}
+)";
+
+} // namespace
+
+const ShaderSource kTriangleShader = {
+    "triangle",
+    triangleVertexSrc,
+    triangleFragmentSrc,
+    ShaderHighPrecision | ShaderDither | ShaderQuantizedInputs
+};
+
+const ShaderSource kColorErrorShader = {
+    "color_error",
+    fullScreenVertexSrc,
+    colorErrorFragmentSrc,
+    ShaderHighPrecision
+};
+
+const ShaderSource kColorReduceShader = {
+    "color_reduce",
+    fullScreenVertexSrc,
+    colorReduceFragmentSrc,
+    ShaderHighPrecision
+};
+
+const ShaderSource kSelfTestShader = {
+    "self_test",
+    fullScreenVertexSrc,
+    selfTestFragmentSrc,
+    0
+};
@@ -0,0 +1,27 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include "shader_variants.h"
+
+// Shaders shared by the desktop and VxWorks renderers, in the unified
+// format of shader_variants.h.
+
+// Vertex-colored geometry with the position in attribute 0 and the color
+// in attribute 1. The u_invert uniform (0 to 1) mixes the color towards
+// its inverse. With QUANTIZED, positions are normalized integers scaled
+// by u_positionScale.
+extern const ShaderSource kTriangleShader;
+
+// Passes of the colour error reduction in color_error.h. The first
+// compares 4x4 pixel blocks of u_frame with the expected image of one
+// vertex-coloured triangle; the second reduces 4x4 cells of the previous
+// level. Both draw a full-screen triangle from attribute 0 and need
+// ShaderHighPrecision on ES.
+extern const ShaderSource kColorErrorShader;
+extern const ShaderSource kColorReduceShader;
+
+// Test pattern of the display self-test in display_self_test.h, drawn as
+// a full-screen triangle from attribute 0.
+extern const ShaderSource kSelfTestShader;
+
+#endif // SHADER_LIBRARY_H
@@ -0,0 +1,209 @@
+#include "shader_manager.h"
+
+#include "async_log.h"
+#include "platform_timer.h"
+#include "program_binary_cache.h"
+#include "shader_variants.h"
+
+#include <cstring>
+#include <utility>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+
+// Info logs longer than this are truncated, as in shader_program.cpp.
+const GLsizei kInfoLogBytes = 1024;
+
+// Lets the driver pick the number of compiler threads, up to all cores.
+const GLuint kAllCompilerThreads = 0xFFFFFFFFu;
+
+#ifdef USE_GLES2
+typedef void (GL_APIENTRYP MaxShaderCompilerThreadsFn)(GLuint count);
+
+bool hasGlExtension(const char* name) {
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    return extensions && strstr(extensions, name);
+}
+#endif
+
+// Turns on parallel compilation if the driver supports it.
+bool enableParallelCompile() {
+#ifdef USE_GLES2
+    if (!hasGlExtension("GL_KHR_parallel_shader_compile"))
+        return false;
+    MaxShaderCompilerThreadsFn maxThreads =
+        reinterpret_cast<MaxShaderCompilerThreadsFn>(eglGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+    if (maxThreads)
+        maxThreads(kAllCompilerThreads);
+    return true;
+#else
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(kAllCompilerThreads);
+        return true;
+    }
+    if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(kAllCompilerThreads);
+        return true;
+    }
+    return false;
+#endif
+}
+
+GLuint submitShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+bool shaderCompiled(GLuint shader, const std::string& name, const char* stage) {
+    GLint compiled;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled)
+        return true;
+    char infoLog[kInfoLogBytes];
+    infoLog[0] = '\0';
+    glGetShaderInfoLog(shader, kInfoLogBytes, nullptr, infoLog);
+    LogLine(LogError) << "Error compiling " << stage << " shader of " << name.c_str() << ":\n" << infoLog;
+    return false;
+}
+
+} // namespace
+
+ShaderManager::ShaderManager(ProgramBinaryCache* binaries)
+    : binaries_(binaries && binaries->attach() ? binaries : nullptr),
+      parallel_(enableParallelCompile()), pending_(0), loaded_(0), startNs_(0) {
+}
+
+ShaderManager::~ShaderManager() {
+    destroy();
+}
+
+void ShaderManager::destroy() {
+    entries_.clear();
+    pending_ = 0;
+    loaded_ = 0;
+}
+
+int ShaderManager::add(const char* name, const char* vertexSource, const char* fragmentSource, bool required) {
+    if (entries_.empty())
+        startNs_ = monotonicNowNs();
+
+    // Linking before the compile results are known is fine: a failed
+    // compile just makes the link fail, and finish() reports the compile
+    // log rather than the link log.
+    Entry entry;
+    entry.name = name;
+    entry.required = required;
+    entry.state = Building;
+    entry.binaryKey = 0;
+    if (binaries_) {
+        entry.binaryKey = shaderVariantHash(vertexSource, fragmentSource);
+        entry.program.reset(glCreateProgram());
+        if (binaries_->load(entry.binaryKey, entry.program.get())) {
+            entry.state = Ready;
+            entries_.push_back(std::move(entry));
+            ++loaded_;
+            return static_cast<int>(entries_.size() - 1);
+        }
+    }
+
+    entry.vertexShader.reset(submitShader(GL_VERTEX_SHADER, vertexSource));
+    entry.fragmentShader.reset(submitShader(GL_FRAGMENT_SHADER, fragmentSource));
+    entry.program.reset(glCreateProgram());
+    if (binaries_)
+        binaries_->prepare(entry.program.get());
+    glAttachShader(entry.program.get(), entry.vertexShader.get());
+    glAttachShader(entry.program.get(), entry.fragmentShader.get());
+    glLinkProgram(entry.program.get());
+
+    entries_.push_back(std::move(entry));
+    ++pending_;
+    return static_cast<int>(entries_.size() - 1);
+}
+
+void ShaderManager::require(int id) {
+    entries_[id].required = true;
+}
+
+bool ShaderManager::waitForRequired() {
+    bool built = true;
+    size_t required = 0;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        Entry& entry = entries_[i];
+        if (!entry.required)
+            continue;
+        ++required;
+        if (entry.state == Building)
+            finish(entry);
+        built = built && entry.state == Ready;
+    }
+    LogLine(LogInfo) << "Shaders: " << required << " required programs built in "
+                     << nsToMs(monotonicNowNs() - startNs_) << " ms, " << pending_ << " still building ("
+                     << (parallel_ ? "parallel" : "serial") << " compile, " << loaded_
+                     << " from cached binaries)";
+    return built;
+}
+
+void ShaderManager::poll() {
+    if (!pending_)
+        return;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        Entry& entry = entries_[i];
+        if (entry.state != Building || !completed(entry))
+            continue;
+        finish(entry);
+        if (!parallel_)
+            break;
+    }
+    if (!pending_) {
+        LogLine(LogInfo) << "Shaders: all " << entries_.size() << " programs built in "
+                         << nsToMs(monotonicNowNs() - startNs_) << " ms";
+    }
+}
+
+GLuint ShaderManager::program(int id) const {
+    const Entry& entry = entries_[id];
+    return entry.state == Ready ? entry.program.get() : 0;
+}
+
+bool ShaderManager::ready(int id) const {
+    return entries_[id].state == Ready;
+}
+
+bool ShaderManager::completed(const Entry& entry) const {
+    if (!parallel_)
+        return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(entry.program.get(), GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+void ShaderManager::finish(Entry& entry) {
+    bool built = shaderCompiled(entry.vertexShader.get(), entry.name, "vertex") &&
+                 shaderCompiled(entry.fragmentShader.get(), entry.name, "fragment");
+    if (built) {
+        GLint linked;
+        glGetProgramiv(entry.program.get(), GL_LINK_STATUS, &linked);
+        if (!linked) {
+            char infoLog[kInfoLogBytes];
+            infoLog[0] = '\0';
+            glGetProgramInfoLog(entry.program.get(), kInfoLogBytes, nullptr, infoLog);
+            LogLine(LogError) << "Error linking program " << entry.name.c_str() << ":\n" << infoLog;
+            built = false;
+        }
+    }
+
+    // Attached shaders live on with the program; only the names go.
+    entry.vertexShader.reset();
+    entry.fragmentShader.reset();
+    if (!built)
+        entry.program.reset();
+    else if (binaries_)
+        binaries_->store(entry.binaryKey, entry.program.get());
+    entry.state = built ? Ready : Failed;
+    --pending_;
+}
@@ -0,0 +1,107 @@
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include "gl_handle.h"
+#include "gl_platform.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ProgramBinaryCache;
+
+// Builds all shader programs of the renderer at once. add() hands every
+// compile and link to the driver up front and checks nothing; results are
+// collected later, so the driver can work on many programs together rather
+// than one after another as createProgram() does.
+//
+// Where the driver has KHR_parallel_shader_compile (or the ARB version on
+// desktop GL) it is told to use as many compiler threads as it likes, and
+// completion is polled with GL_COMPLETION_STATUS_KHR, which never blocks.
+// Without it the first status query of a program waits for that program,
+// so programs are finished one at a time in the order they were added.
+//
+// Programs marked as required are the ones the first frame draws with:
+// waitForRequired() returns once those are built and leaves the rest to
+// poll(), which the render loop calls every frame. All calls, construction
+// included, must come from the thread that owns the context.
+//
+// Given a ProgramBinaryCache that works with the current context, every
+// program linked is saved into it, and a program whose binary is already
+// there is loaded from it instead of compiled, ready at once. The cache
+// outlives the manager, so a manager built on a new context after a GPU
+// reset gets its programs back quickly.
+class ShaderManager {
+public:
+    explicit ShaderManager(ProgramBinaryCache* binaries = nullptr);
+
+    ~ShaderManager();
+
+    // Starts building a program from vertex and fragment sources and
+    // returns its id. The name only appears in log messages.
+    int add(const char* name, const char* vertexSource, const char* fragmentSource, bool required = true);
+
+    // Marks an already added program as required.
+    void require(int id);
+
+    // Blocks until every required program is built. Returns false if one
+    // of them failed to compile or link.
+    bool waitForRequired();
+
+    // Collects programs that have finished building. With parallel compile
+    // this never blocks; without it, it finishes one program per call so
+    // that the stalls are spread over several frames.
+    void poll();
+
+    // The program with the given id, or 0 while it is still building or
+    // if it failed.
+    GLuint program(int id) const;
+    bool ready(int id) const;
+
+    // Programs still building.
+    size_t pending() const { return pending_; }
+
+    // Whether the driver compiles in parallel and reports completion.
+    bool parallel() const { return parallel_; }
+
+    // Programs added, and how many of them were loaded from cached binaries.
+    size_t programs() const { return entries_.size(); }
+    size_t loadedFromBinary() const { return loaded_; }
+
+    // Deletes every program, finished or not. Call while the context is
+    // still current; the destructor does the same for what is left.
+    void destroy();
+
+private:
+    ShaderManager(const ShaderManager&);
+    ShaderManager& operator=(const ShaderManager&);
+
+    enum State {
+        Building,
+        Ready,
+        Failed
+    };
+
+    struct Entry {
+        std::string name;
+        bool required;
+        State state;
+        GlShader vertexShader;
+        GlShader fragmentShader;
+        GlProgram program;
+        uint64_t binaryKey;  // where finish() saves the binary
+    };
+
+    bool completed(const Entry& entry) const;
+    void finish(Entry& entry);
+
+    std::vector<Entry> entries_;
+    ProgramBinaryCache* binaries_;  // null without binary support
+    bool parallel_;
+    size_t pending_;
+    size_t loaded_;
+    uint64_t startNs_;  // when the first program was added
+};
+
+#endif // SHADER_MANAGER_H
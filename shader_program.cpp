@@ -0,0 +1,65 @@
+#include "shader_program.h"
+
+#include <iostream>
+
+namespace {
+
+// Info logs longer than this are truncated. A fixed buffer keeps compile
+// errors from touching the heap.
+const GLsizei kInfoLogBytes = 1024;
+
+} // namespace
+
+GLuint loadShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    
+    GLint compiled;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        GLint infoLen = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
+        if (infoLen > 1) {
+            char infoLog[kInfoLogBytes];
+            glGetShaderInfoLog(shader, kInfoLogBytes, nullptr, infoLog);
+            std::cerr << "Error compiling shader:\n" << infoLog << std::endl;
+        }
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint createProgram(const char* vtxSrc, const char* fragSrc) {
+    GLuint vtxShader = loadShader(GL_VERTEX_SHADER, vtxSrc);
+    GLuint fragShader = loadShader(GL_FRAGMENT_SHADER, fragSrc);
+    
+    if (!vtxShader || !fragShader) {
+        return 0;
+    }
+    
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vtxShader);
+    glAttachShader(program, fragShader);
+    glLinkProgram(program);
+    
+    GLint linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        GLint infoLen = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLen);
+        if (infoLen > 1) {
+            char infoLog[kInfoLogBytes];
+            glGetProgramInfoLog(program, kInfoLogBytes, nullptr, infoLog);
+            std::cerr << "Error linking program:\n" << infoLog << std::endl;
+        }
+        glDeleteProgram(program);
+        return 0;
+    }
+    
+    glDeleteShader(vtxShader);
+    glDeleteShader(fragShader);
+    
+    return program;
+}
@@ -0,0 +1,13 @@
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include "gl_platform.h"
+
+// Compiles a single shader stage. Returns 0 and logs the info log on failure.
+GLuint loadShader(GLenum type, const char* source);
+
+// Compiles and links a program from vertex and fragment sources.
+// Returns 0 and logs the info log on failure.
+GLuint createProgram(const char* vtxSrc, const char* fragSrc);
+
+#endif // SHADER_PROGRAM_H
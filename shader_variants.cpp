@@ -0,0 +1,256 @@
+#include "shader_variants.h"
+#include "async_log.h"
+#include "shader_manager.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct FeatureName {
+    ShaderFeature feature;
+    const char* option;  // as given to parseShaderFeatures()
+    const char* define;  // as tested by #ifdef in shader sources
+};
+
+const FeatureName kFeatureNames[] = {
+    { ShaderHighPrecision, "highp", "HIGHP" },
+    { ShaderDither, "dither", "DITHER" },
+    { ShaderQuantizedInputs, "quantized", "QUANTIZED" },
+};
+
+const size_t kFeatureCount = sizeof(kFeatureNames) / sizeof(kFeatureNames[0]);
+
+// Tested by sources for code that only one dialect needs.
+const char* const kEsDefine = "GLSL_ES";
+
+const uint64_t kFnvOffset = 14695981039346656037ull;
+const uint64_t kFnvPrime = 1099511628211ull;
+
+bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// An #ifdef/#ifndef block. Blocks on names this file knows are resolved
+// here; any other conditional is passed through to the driver.
+struct Conditional {
+    bool resolved;
+    bool parentActive;
+    bool condition;
+    bool active;
+};
+
+// Whether the name is defined for this variant, or -1 if the name is not
+// one that preprocessShader() resolves.
+int knownDefine(const std::string& name, ShaderDialect dialect, unsigned features) {
+    if (name == kEsDefine)
+        return dialect == GlslEs100 ? 1 : 0;
+    for (size_t i = 0; i < kFeatureCount; ++i) {
+        if (name == kFeatureNames[i].define)
+            return (features & kFeatureNames[i].feature) ? 1 : 0;
+    }
+    return -1;
+}
+
+// Renames the identifiers that differ between the unified format and
+// GLSL 3.30.
+void translateTo330(const std::string& line, ShaderStage stage, std::string& out) {
+    size_t i = 0;
+    while (i < line.size()) {
+        if (!isIdentifierChar(line[i]) || (line[i] >= '0' && line[i] <= '9')) {
+            out += line[i++];
+            continue;
+        }
+        size_t start = i;
+        while (i < line.size() && isIdentifierChar(line[i]))
+            ++i;
+        std::string word(line, start, i - start);
+        if (word == "attribute")
+            out += "in";
+        else if (word == "varying")
+            out += stage == VertexStage ? "out" : "in";
+        else if (word == "gl_FragColor")
+            out += "fragColor";
+        else if (word == "texture2D")
+            out += "texture";
+        else
+            out += word;
+    }
+}
+
+// Drops a leading layout(...) qualifier, which GLSL ES 1.00 lacks.
+void translateToEs100(const std::string& line, std::string& out) {
+    size_t start = line.find_first_not_of(" \t");
+    if (line.compare(start, 6, "layout") == 0) {
+        size_t close = line.find(')', start);
+        size_t rest = close == std::string::npos ? close : line.find_first_not_of(" \t", close + 1);
+        if (rest != std::string::npos) {
+            out.append(line, 0, start);
+            out.append(line, rest, std::string::npos);
+            return;
+        }
+    }
+    out += line;
+}
+
+} // namespace
+
+bool parseShaderFeatures(const char* list, unsigned& features) {
+    unsigned parsed = 0;
+    while (*list) {
+        const char* end = strchr(list, ',');
+        size_t length = end ? static_cast<size_t>(end - list) : strlen(list);
+        size_t i = 0;
+        while (i < kFeatureCount && (strlen(kFeatureNames[i].option) != length ||
+                                     strncmp(kFeatureNames[i].option, list, length) != 0))
+            ++i;
+        if (i == kFeatureCount)
+            return false;
+        parsed |= kFeatureNames[i].feature;
+        list += end ? length + 1 : length;
+    }
+    features = parsed;
+    return true;
+}
+
+std::string preprocessShader(const ShaderSource& source, ShaderStage stage, ShaderDialect dialect,
+                             unsigned features) {
+    features &= source.features;
+    std::string out = dialect == GlslEs100 ? "#version 100\n" : "#version 330 core\n";
+    if (stage == FragmentStage) {
+        if (dialect == Glsl330) {
+            out += "out vec4 fragColor;\n";
+        } else if (features & ShaderHighPrecision) {
+            out += "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+                   "precision highp float;\n"
+                   "#else\n"
+                   "precision mediump float;\n"
+                   "#endif\n";
+        } else {
+            out += "precision mediump float;\n";
+        }
+    }
+
+    std::vector<Conditional> conditionals;
+    const char* text = stage == VertexStage ? source.vertex : source.fragment;
+    while (*text) {
+        const char* newline = strchr(text, '\n');
+        std::string line(text, newline ? static_cast<size_t>(newline - text) : strlen(text));
+        text += line.size() + (newline ? 1 : 0);
+
+        size_t comment = line.find("//");
+        if (comment != std::string::npos)
+            line.erase(comment);
+        size_t last = line.find_last_not_of(" \t\r");
+        if (last == std::string::npos)
+            continue;
+        line.erase(last + 1);
+        bool active = conditionals.empty() || conditionals.back().active;
+
+        size_t first = line.find_first_not_of(" \t");
+        size_t wordStart = line.find_first_not_of(" \t", first + 1);
+        if (line[first] == '#' && wordStart != std::string::npos) {
+            size_t wordEnd = line.find_first_of(" \t", wordStart);
+            std::string directive(line, wordStart, wordEnd == std::string::npos ? std::string::npos
+                                                                                : wordEnd - wordStart);
+            std::string name;
+            if (wordEnd != std::string::npos) {
+                size_t nameStart = line.find_first_not_of(" \t", wordEnd);
+                name.assign(line, nameStart, line.find_first_of(" \t", nameStart) - nameStart);
+            }
+
+            if (directive == "ifdef" || directive == "ifndef" || directive == "if") {
+                int defined = directive == "if" ? -1 : knownDefine(name, dialect, features);
+                Conditional conditional;
+                conditional.resolved = defined >= 0;
+                conditional.parentActive = active;
+                conditional.condition = (defined == 1) == (directive == "ifdef");
+                conditional.active = active && (!conditional.resolved || conditional.condition);
+                conditionals.push_back(conditional);
+                if (!conditional.resolved && active)
+                    out += line + '\n';
+                continue;
+            }
+            if (!conditionals.empty() && (directive == "else" || directive == "endif")) {
+                Conditional& conditional = conditionals.back();
+                if (!conditional.resolved && conditional.parentActive)
+                    out += line + '\n';
+                if (directive == "endif")
+                    conditionals.pop_back();
+                else if (conditional.resolved)
+                    conditional.active = conditional.parentActive && !conditional.condition;
+                continue;
+            }
+        }
+        if (!active)
+            continue;
+
+        if (dialect == Glsl330)
+            translateTo330(line, stage, out);
+        else
+            translateToEs100(line, out);
+        out += '\n';
+    }
+    return out;
+}
+
+uint64_t shaderVariantHash(const std::string& vertex, const std::string& fragment) {
+    uint64_t hash = kFnvOffset;
+    for (size_t i = 0; i < vertex.size(); ++i)
+        hash = (hash ^ static_cast<unsigned char>(vertex[i])) * kFnvPrime;
+    // A separator, so that moving text between the stages changes the hash
+    hash = (hash ^ 0xFF) * kFnvPrime;
+    for (size_t i = 0; i < fragment.size(); ++i)
+        hash = (hash ^ static_cast<unsigned char>(fragment[i])) * kFnvPrime;
+    return hash;
+}
+
+ShaderVariantCache::ShaderVariantCache(ShaderManager& shaders)
+    : shaders_(shaders), hits_(0) {
+}
+
+int ShaderVariantCache::request(const ShaderSource& source, unsigned features, bool required) {
+    features &= source.features;
+    std::string vertex = preprocessShader(source, VertexStage, kNativeShaderDialect, features);
+    std::string fragment = preprocessShader(source, FragmentStage, kNativeShaderDialect, features);
+    uint64_t hash = shaderVariantHash(vertex, fragment);
+
+    std::unordered_map<uint64_t, int>::const_iterator found = programs_.find(hash);
+    if (found != programs_.end()) {
+        ++hits_;
+        if (required)
+            shaders_.require(found->second);
+        return found->second;
+    }
+
+    std::string name = source.name;
+    for (size_t i = 0; i < kFeatureCount; ++i) {
+        if (features & kFeatureNames[i].feature) {
+            name += name.size() == strlen(source.name) ? '[' : ',';
+            name += kFeatureNames[i].option;
+        }
+    }
+    if (features)
+        name += ']';
+
+    int id = shaders_.add(name.c_str(), vertex.c_str(), fragment.c_str(), required);
+    programs_[hash] = id;
+    return id;
+}
+
+int ShaderVariantCache::requestAll(const ShaderSource& source, unsigned selected) {
+    // The selected variant goes first, so the driver starts on it first.
+    size_t programsBefore = programs_.size();
+    int id = request(source, selected, true);
+    selected &= source.features;
+    unsigned variants = 1;
+    for (unsigned features = 0; features <= kShaderFeatureMask; ++features) {
+        if ((features & ~source.features) == 0 && features != selected) {
+            request(source, features, false);
+            ++variants;
+        }
+    }
+    LogLine(LogInfo) << "Shaders: " << source.name << " has " << variants << " variants in "
+                     << static_cast<unsigned long>(programs_.size() - programsBefore) << " programs";
+    return id;
+}
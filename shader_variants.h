@@ -0,0 +1,104 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+class ShaderManager;
+
+// Shaders are written once in a unified format and turned into GLSL 3.30
+// for the desktop build or GLSL ES 1.00 for the VxWorks build by
+// preprocessShader(). The unified format is GLSL ES 1.00 without version
+// or precision statements, plus:
+//
+//   - "layout(location = N)" on attribute declarations, kept for GLSL 3.30
+//     and dropped for ES, where the application looks attributes up;
+//   - "#ifdef NAME" / "#ifndef NAME" / "#else" / "#endif" on the feature
+//     names below and on GLSL_ES, which are resolved here rather than by
+//     the driver.
+//
+// For GLSL 3.30, attribute and varying become in and out, gl_FragColor
+// becomes a declared output and texture2D becomes texture. ES fragment
+// shaders get mediump float precision unless the variant asks for highp.
+// Comments and blank lines are dropped, so variants that differ only in
+// features a shader does not use come out identical.
+
+enum ShaderDialect {
+    Glsl330,    // desktop GL 3.3 core
+    GlslEs100   // OpenGL ES 2.0
+};
+
+// The dialect of this build.
+#ifdef USE_GLES2
+const ShaderDialect kNativeShaderDialect = GlslEs100;
+#else
+const ShaderDialect kNativeShaderDialect = Glsl330;
+#endif
+
+enum ShaderStage {
+    VertexStage,
+    FragmentStage
+};
+
+// Optional features a shader can be built with. Each is defined as a
+// preprocessor name of the same spelling in upper case.
+enum ShaderFeature {
+    ShaderHighPrecision   = 1 << 0,  // HIGHP: highp fragment math on ES
+    ShaderDither          = 1 << 1,  // DITHER: noise of one 8-bit step on the output
+    ShaderQuantizedInputs = 1 << 2,  // QUANTIZED: normalized integer positions
+    kShaderFeatureMask    = (1 << 3) - 1
+};
+
+// Parses a comma-separated list of feature names (highp, dither,
+// quantized) into flags. Returns false on an unknown name.
+bool parseShaderFeatures(const char* list, unsigned& features);
+
+// A shader in the unified format. features lists the ones its source
+// reacts to; variants are generated for every combination of them.
+struct ShaderSource {
+    const char* name;
+    const char* vertex;
+    const char* fragment;
+    unsigned features;
+};
+
+// Generates one stage of a variant in the given dialect. Features outside
+// source.features are ignored.
+std::string preprocessShader(const ShaderSource& source, ShaderStage stage, ShaderDialect dialect,
+                             unsigned features);
+
+// 64-bit FNV-1a hash of a generated vertex and fragment shader pair.
+uint64_t shaderVariantHash(const std::string& vertex, const std::string& fragment);
+
+// Generates variants in this build's dialect and queues them with a
+// ShaderManager, once per distinct generated code: variants whose code
+// hashes the same as an earlier one share its program.
+class ShaderVariantCache {
+public:
+    explicit ShaderVariantCache(ShaderManager& shaders);
+
+    // Queues the variant with the given features and returns its program
+    // id in the manager.
+    int request(const ShaderSource& source, unsigned features, bool required);
+
+    // Queues every variant of the source, so that all of them are checked
+    // to compile at startup. The one with the selected features is
+    // required; its program id is returned.
+    int requestAll(const ShaderSource& source, unsigned selected);
+
+    // Distinct programs queued, and requests served by an earlier one.
+    size_t programs() const { return programs_.size(); }
+    size_t hits() const { return hits_; }
+
+private:
+    ShaderVariantCache(const ShaderVariantCache&);
+    ShaderVariantCache& operator=(const ShaderVariantCache&);
+
+    ShaderManager& shaders_;
+    std::unordered_map<uint64_t, int> programs_;
+    size_t hits_;
+};
+
+#endif // SHADER_VARIANTS_H
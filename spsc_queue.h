@@ -0,0 +1,67 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity must be a power of two. push() fails instead of blocking
+// when the queue is full, so the producer never waits on the consumer.
+//
+// Each side keeps a cached copy of the other side's index and only reloads
+// it when the cache says the queue is full (or empty), which keeps the two
+// cache lines from bouncing between cores on every operation.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue() : head_(0), cachedTail_(0), tail_(0), cachedHead_(0) {}
+
+    // Producer side.
+    bool push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ == Capacity) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ == Capacity)
+                return false;
+        }
+        items_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    bool pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_)
+                return false;
+        }
+        item = items_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate; exact only when called from the consumer with the
+    // producer idle.
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    SpscQueue(const SpscQueue&);
+    SpscQueue& operator=(const SpscQueue&);
+
+    // Consumer-owned.
+    alignas(64) std::atomic<size_t> head_;
+    size_t cachedTail_;
+    // Producer-owned.
+    alignas(64) std::atomic<size_t> tail_;
+    size_t cachedHead_;
+    alignas(64) T items_[Capacity];
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,158 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include "gl_platform.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// Vertex formats described by their C++ struct. The component type, count,
+// normalization, offset and stride of every attribute are worked out at
+// compile time from the struct, and the binding code unrolls into the
+// same glVertexAttribPointer calls one would write by hand:
+//
+//     struct CompactVertex {
+//         GLshort position[4];
+//         GLubyte color[4];
+//     };
+//     typedef VertexLayout<CompactVertex,
+//                          VERTEX_ATTRIBUTE(CompactVertex, position, true),
+//                          VERTEX_ATTRIBUTE(CompactVertex, color, true)> CompactLayout;
+//
+//     CompactLayout::bind();                      // VAO: attribute i at location i
+//     CompactLayout::bind(locations, vertices);   // ES2: looked-up locations, client array
+//
+// Members are arrays of 1 to 4 components of a type GL can read as a vertex
+// attribute, or a single such component. Misaligned members, normalized
+// floats and types GL cannot read fail to compile.
+
+// GL type enum of a vertex component type.
+template <typename T> struct VertexComponentType;
+template <> struct VertexComponentType<GLfloat> { static const GLenum value = GL_FLOAT; };
+template <> struct VertexComponentType<GLbyte> { static const GLenum value = GL_BYTE; };
+template <> struct VertexComponentType<GLubyte> { static const GLenum value = GL_UNSIGNED_BYTE; };
+template <> struct VertexComponentType<GLshort> { static const GLenum value = GL_SHORT; };
+template <> struct VertexComponentType<GLushort> { static const GLenum value = GL_UNSIGNED_SHORT; };
+
+// One attribute: a member of type Member at byte Offset of the vertex.
+// Normally spelled through VERTEX_ATTRIBUTE.
+template <typename Member, size_t Offset, bool Normalized>
+struct VertexAttribute {
+    typedef typename std::remove_extent<Member>::type Component;
+
+    static const GLint size = std::extent<Member>::value ? static_cast<GLint>(std::extent<Member>::value) : 1;
+    static const GLenum type = VertexComponentType<Component>::value;
+    static const GLboolean normalized = Normalized ? GL_TRUE : GL_FALSE;
+    static const size_t offset = Offset;
+    static const size_t bytes = sizeof(Member);
+
+    static_assert(size >= 1 && size <= 4, "vertex attributes have 1 to 4 components");
+    static_assert(!Normalized || type != GL_FLOAT, "float attributes cannot be normalized");
+    static_assert(Offset % sizeof(Component) == 0, "vertex attribute is not aligned to its component type");
+};
+
+// The attribute for a member of a vertex struct.
+#define VERTEX_ATTRIBUTE(Vertex, member, normalized) \
+    VertexAttribute<decltype(Vertex::member), offsetof(Vertex, member), normalized>
+
+namespace vertex_layout_detail {
+
+inline const void* attributePointer(const void* base, size_t offset) {
+    return reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(base) + offset);
+}
+
+// Attribute Index goes to location Index, as fixed by layout qualifiers.
+struct FixedLocations {
+    bool get(GLuint index, GLuint& location) const {
+        location = index;
+        return true;
+    }
+};
+
+// Attribute i goes to locations[i]; attributes the shader does not use
+// (location -1) are skipped.
+struct LookedUpLocations {
+    explicit LookedUpLocations(const GLint* locations) : locations_(locations) {}
+    bool get(GLuint index, GLuint& location) const {
+        location = static_cast<GLuint>(locations_[index]);
+        return locations_[index] >= 0;
+    }
+    const GLint* locations_;
+};
+
+template <typename Vertex, GLuint Index, typename... Attributes>
+struct AttributeBinder {
+    template <typename Locations>
+    static void bind(const Locations&, const void*) {}
+    template <typename Locations>
+    static void disable(const Locations&) {}
+};
+
+template <typename Vertex, GLuint Index, typename First, typename... Rest>
+struct AttributeBinder<Vertex, Index, First, Rest...> {
+    static_assert(First::offset + First::bytes <= sizeof(Vertex), "vertex attribute lies outside the vertex");
+
+    template <typename Locations>
+    static void bind(const Locations& locations, const void* base) {
+        GLuint location;
+        if (locations.get(Index, location)) {
+            glVertexAttribPointer(location, First::size, First::type, First::normalized,
+                                  static_cast<GLsizei>(sizeof(Vertex)), attributePointer(base, First::offset));
+            glEnableVertexAttribArray(location);
+        }
+        AttributeBinder<Vertex, Index + 1, Rest...>::bind(locations, base);
+    }
+
+    template <typename Locations>
+    static void disable(const Locations& locations) {
+        GLuint location;
+        if (locations.get(Index, location))
+            glDisableVertexAttribArray(location);
+        AttributeBinder<Vertex, Index + 1, Rest...>::disable(locations);
+    }
+};
+
+} // namespace vertex_layout_detail
+
+// The interleaved vertex format Vertex, with the given attributes in
+// order. All functions are static; the type is the description.
+template <typename Vertex, typename... Attributes>
+class VertexLayout {
+public:
+    static_assert(std::is_standard_layout<Vertex>::value, "vertex structs need standard layout for offsetof");
+    static_assert(sizeof...(Attributes) > 0, "a vertex layout needs at least one attribute");
+
+    typedef Vertex VertexType;
+
+    static const GLsizei stride = static_cast<GLsizei>(sizeof(Vertex));
+    static const GLuint attributeCount = sizeof...(Attributes);
+
+    // Points attribute i at location i and enables it. base is the offset
+    // of the first vertex in the bound GL_ARRAY_BUFFER, or a client-side
+    // array when none is bound.
+    static void bind(const void* base = nullptr) {
+        vertex_layout_detail::AttributeBinder<Vertex, 0, Attributes...>::bind(
+            vertex_layout_detail::FixedLocations(), base);
+    }
+
+    // The same for attribute locations looked up from the program, one per
+    // attribute; negative locations are skipped.
+    static void bind(const GLint* locations, const void* base = nullptr) {
+        vertex_layout_detail::AttributeBinder<Vertex, 0, Attributes...>::bind(
+            vertex_layout_detail::LookedUpLocations(locations), base);
+    }
+
+    // Disables the attribute arrays enabled by bind().
+    static void disable() {
+        vertex_layout_detail::AttributeBinder<Vertex, 0, Attributes...>::disable(
+            vertex_layout_detail::FixedLocations());
+    }
+
+    static void disable(const GLint* locations) {
+        vertex_layout_detail::AttributeBinder<Vertex, 0, Attributes...>::disable(
+            vertex_layout_detail::LookedUpLocations(locations));
+    }
+};
+
+#endif // VERTEX_LAYOUT_H
@@ -0,0 +1,79 @@
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+// Bounded Chase-Lev work-stealing deque. The owning thread pushes and pops
+// at the bottom like a stack; any other thread may steal from the top.
+// Capacity must be a power of two. push() fails when the deque is full so
+// the owner can run the item itself instead of waiting.
+//
+// Memory ordering follows Le, Pop, Cohen and Zappa Nardelli, "Correct and
+// Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+template <typename T, size_t Capacity>
+class WorkStealingDeque {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "WorkStealingDeque capacity must be a power of two");
+
+public:
+    WorkStealingDeque() : top_(0), bottom_(0) {}
+
+    // Owner only.
+    bool push(T item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        if (b - t >= static_cast<int64_t>(Capacity))
+            return false;
+        items_[b & (Capacity - 1)].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only.
+    bool pop(T& item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        item = items_[b & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last item: race any thief for it.
+            bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread.
+    bool steal(T& item) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+        item = items_[t & (Capacity - 1)].load(std::memory_order_relaxed);
+        return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    }
+
+private:
+    WorkStealingDeque(const WorkStealingDeque&);
+    WorkStealingDeque& operator=(const WorkStealingDeque&);
+
+    // Written by thieves.
+    alignas(64) std::atomic<int64_t> top_;
+    // Written by the owner.
+    alignas(64) std::atomic<int64_t> bottom_;
+    alignas(64) std::atomic<T> items_[Capacity];
+};
+
+#endif // WORK_STEALING_DEQUE_H